@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "icmp-utils.h"
+
+// microbenchmark of the checksum versions : ns per call and GB/s, for each
+// version in_cksum() may use (forced in turn, see
+// ICMPUtils::set_cksum_impl()), unp's in_cksum_scalar() and an incremental
+// update (in_cksum_update()), over common packet sizes, aligned or not. run
+// it w/ 'make bench'.
+
+// byte summed per length, so that each one takes about as long
+#define BYTES_PER_LEN   (1ULL << 28)
+
+static const char * impls[] = { "avx2", "sse2", "scalar" };
+static const int lens[] = { 20, 64, 84, 576, 1500, 4096, 9000, 65536 };
+
+// keeps the compiler from dropping the calls
+static volatile uint16_t sink = 0;
+
+static double get_elapsed_ns(struct timespec & start) {
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double) (end.tv_sec - start.tv_sec) * 1000000000.0 + (double) (end.tv_nsec - start.tv_nsec);
+}
+
+static void print_result(const char * name, int len, int offset, uint64_t nr_calls, double ns) {
+
+    double ns_per_call = ns / nr_calls;
+
+    std::cout << std::left << std::setw(10) << name << std::right << std::setw(8) << len
+        << std::setw(8) << offset << std::fixed << std::setprecision(1) << std::setw(12)
+        << ns_per_call << std::setprecision(2) << std::setw(10) << (len / ns_per_call) << std::endl;
+}
+
+static void bench_len(const char * name, bool scalar, uint8_t * buff, int len, int offset) {
+
+    uint16_t * addr = (uint16_t *) (buff + offset);
+    uint64_t nr_calls = BYTES_PER_LEN / len;
+    uint16_t acc = 0;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // each call depends on the previous one, so that they don't overlap
+    for (uint64_t n = 0; n < nr_calls; n++) {
+        addr[0] = acc;
+        acc = (scalar ? ICMPUtils::in_cksum_scalar(addr, len) : ICMPUtils::in_cksum(addr, len));
+    }
+
+    print_result(name, len, offset, nr_calls, get_elapsed_ns(start));
+    sink = acc;
+}
+
+int main(int argc, char **argv) {
+
+    std::vector<uint8_t> buff(65536 + 64);
+
+    srand(1);
+    for (size_t i = 0; i < buff.size(); i++)
+        buff[i] = (uint8_t) rand();
+
+    std::cout << std::left << std::setw(10) << "version" << std::right << std::setw(8) << "len"
+        << std::setw(8) << "offset" << std::setw(12) << "ns/call" << std::setw(10) << "GB/s" << std::endl;
+
+    for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+
+        if (ICMPUtils::set_cksum_impl(impls[i]) < 0) {
+            std::cout << impls[i] << " : not supported by this cpu, skipped" << std::endl;
+            continue;
+        }
+
+        for (size_t k = 0; k < sizeof(lens) / sizeof(lens[0]); k++) {
+            bench_len(impls[i], false, &buff[0], lens[k], 0);
+            bench_len(impls[i], false, &buff[0], lens[k], 1);
+        }
+    }
+
+    for (size_t k = 0; k < sizeof(lens) / sizeof(lens[0]); k++) {
+        bench_len("unp", true, &buff[0], lens[k], 0);
+        bench_len("unp", true, &buff[0], lens[k], 1);
+    }
+
+    // what stamping a probe costs : a new seq number and timestamp (2 + 16
+    // byte), vs. re-summing the whole 64 byte echo request
+    uint16_t cksum = 0, seq = 0;
+    uint8_t old_ts[16] = { 0 }, new_ts[16] = { 0 };
+    uint64_t nr_calls = 20000000ULL;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (uint64_t n = 0; n < nr_calls; n++) {
+
+        new_ts[n & 15] = (uint8_t) n;
+        cksum = ICMPUtils::in_cksum_update(cksum, seq, (uint16_t) n);
+        cksum = ICMPUtils::in_cksum_update(cksum, old_ts, new_ts, sizeof(new_ts));
+        old_ts[n & 15] = (uint8_t) n;
+        seq = (uint16_t) n;
+    }
+
+    print_result("update", 18, 0, nr_calls, get_elapsed_ns(start));
+    sink = cksum;
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+#ifndef ICMP_UTILS_H
+#define ICMP_UTILS_H
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/udp.h>        // struct udphdr
+
+// Steven's unp book sets the icmp's ECHO optional data field (i.e. after the 
+// 8 byte icmp header) to 56 bytes, which yields a 84 byte ipv4 datagram:
+//  -# 20 byte ipv4 header
+//  -# 8 byte icmp header
+//  -# 56 byte for icmp optional data (pingy only uses the 1st 24 byte, for a 
+//     struct echo_payload : a timespec and a 64 bit timer handle, see 
+//     ping/include/ping-target.h)
+// traceroute sends less (see PROBE_DATA_LEN in traceroute.cpp).
+#define ICMP_DATA_LEN   56
+
+// probes in an ICMPProbePool start on a cache line boundary, and take up a 
+// whole nr. of lines, so that no 2 probes share one
+#define ICMP_PROBE_ALIGN        64
+// max. nr. of byte ICMPProbePool::stamp() copies into a probe's data
+#define ICMP_PROBE_MAX_STAMP    64
+
+class ICMPUtils {
+
+    public:
+
+        ICMPUtils() {}
+        ~ICMPUtils() {}
+
+        static int get_inner_ip_hdr(
+            char * icmp_pckt,               // array of icmp packet bytes
+            int icmp_pckt_len,              // length of icmp packet
+            struct ip * & inner_ip_hdr);
+
+        static int get_inner_icmp_hdr(
+            char * icmp_pckt, 
+            int icmp_pckt_len,
+            struct icmp * & in_icmp_hdr);
+
+        static int get_inner_udp_hdr(
+            char * icmp_pckt, 
+            int icmp_pckt_len,
+            struct udphdr * & inner_udp_hdr);
+
+        // the internet checksum (rfc 1071) of len byte at addr. uses the 
+        // fastest version the cpu supports, picked at runtime (avx2, sse2 or 
+        // plain c, see icmp-utils.cpp). all of them return the same as 
+        // in_cksum_scalar().
+        static uint16_t in_cksum(uint16_t * addr, int len);
+
+        // unp's original version, adding one 16 bit word at a time. kept as a 
+        // reference for the others.
+        static uint16_t in_cksum_scalar(uint16_t * addr, int len);
+
+        // incremental update (rfc 1624) : the checksum of a packet whose 
+        // (valid) checksum was cksum, after the 16 bit word old_word changed 
+        // to new_word. both words as they're in the packet (i.e. in network 
+        // byte order). there's no need to zero icmp_cksum or re-sum the packet.
+        static uint16_t in_cksum_update(
+            uint16_t cksum, 
+            uint16_t old_word, 
+            uint16_t new_word);
+
+        // same, for len byte changing from old_data to new_data, at an even 
+        // offset into the packet
+        static uint16_t in_cksum_update(
+            uint16_t cksum, 
+            const void * old_data, 
+            const void * new_data, 
+            int len);
+
+        // the other way around : the value to set a 16 bit word (now word) of 
+        // a packet w/ checksum cksum to, so that the checksum becomes target. 
+        // all 3 as they're in the packet. target must not be 0 or 0xFFFF, 
+        // which can't be told apart in one's complement.
+        static uint16_t in_cksum_fixup(
+            uint16_t cksum, 
+            uint16_t word, 
+            uint16_t target);
+
+        // the version in_cksum() uses : "avx2", "sse2" or "scalar"
+        static const char * get_cksum_impl();
+        // makes in_cksum() use the given version, e.g. to test or benchmark 
+        // each of them. returns -1 if the cpu doesn't support it. not 
+        // thread-safe : call it before any checksums are computed.
+        static int set_cksum_impl(const char * name);
+
+        static struct icmp * prepare_icmp_pckt(
+            char * buffer, 
+            uint8_t type, 
+            uint8_t code);
+
+        static void print_icmp_hdr(struct icmp * icmp_pckt);
+};
+
+// a fixed set of pre-built icmp probes, allocated once. each probe is 
+// prepared up front (type, code, 0xA5 fill, identifier and a valid 
+// checksum), so that sending one only takes patching its seq number, the 
+// start of its data (e.g. a timestamp) and its checksum (see stamp()) : no 
+// allocation, memset() or full checksum per probe.
+class ICMPProbePool {
+
+    public:
+
+        // nr_probes probes of pckt_len byte (icmp header + data), of type 
+        // <type, code>. probe i gets identifier id_base + i.
+        ICMPProbePool(
+            int nr_probes, 
+            int pckt_len, 
+            uint8_t type, 
+            uint8_t code, 
+            uint16_t id_base);
+        ~ICMPProbePool();
+
+        struct icmp * get(int i) { return (struct icmp *) (probes + (i * stride)); }
+        int size() { return nr_probes; }
+        int get_pckt_len() { return pckt_len; }
+
+        // sets probe i's seq number (host byte order), copies data_len byte 
+        // of data to the start of its data field, and updates its checksum 
+        // for those changes only (rfc 1624). returns the probe, NULL if 
+        // data_len is too large.
+        struct icmp * stamp(int i, uint16_t seq, const void * data, int data_len);
+
+        // sets the 16 bit word at offset (even, from the start of the data) 
+        // of probe i, so that its checksum becomes cksum (as it's in the 
+        // packet), whatever was stamped. returns the probe, NULL if offset 
+        // is out of bounds.
+        struct icmp * pin_cksum(int i, int offset, uint16_t cksum);
+
+        // nr. of allocations (and byte) made by all pools, against the nr. 
+        // of probes stamped. only counted in debug builds (i.e. w/o NDEBUG), 
+        // prints nothing otherwise.
+        static void print_alloc_stats();
+
+    private:
+
+        char * probes;
+        int nr_probes;
+        int pckt_len;
+        // pckt_len, rounded up to a multiple of ICMP_PROBE_ALIGN
+        int stride;
+
+#ifndef NDEBUG
+        // shared by all pools, incl. those of pingy's --threads pingers
+        static std::atomic<uint64_t> nr_allocs;
+        static std::atomic<uint64_t> nr_alloc_bytes;
+        static std::atomic<uint64_t> nr_stamps;
+#endif
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,544 @@
+#include <stdlib.h>
+#include <string.h>         // strcmp()
+
+#include <arpa/inet.h>      // htons()
+
+#include <new>              // std::bad_alloc
+
+#include "icmp-utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ICMP_UTILS_X86
+#endif
+
+// one's complement addition doesn't care about the order in which words are 
+// added, nor about their width : a 32 bit word hi:lo is hi * 2^16 + lo, and 
+// since 2^16 = 1 (mod 2^16 - 1), adding it is the same as adding hi and lo. 
+// so the versions below add 32 bit words into 64 bit accumulators (which 
+// can't overflow, whatever the packet size), and fold the carries back in 
+// only at the end.
+
+// folds a 64 bit sum into 16 bit, w/o complementing it. 2 folds at each step, 
+// since the 1st one may carry again.
+static uint16_t fold(uint64_t sum) {
+
+    sum = (sum >> 32) + (sum & 0xffffffff);
+    sum = (sum >> 32) + (sum & 0xffffffff);
+    sum = (sum >> 16) + (sum & 0xffff);
+    sum = (sum >> 16) + (sum & 0xffff);
+
+    return (uint16_t) sum;
+}
+
+// adds len byte at data to sum, 4 byte at a time. also mops up the tails 
+// left by the simd versions.
+static uint64_t sum_scalar(const uint8_t * data, int len, uint64_t sum) {
+
+    uint32_t word = 0;
+
+    // memcpy() rather than a cast, since data may not be aligned
+    while (len >= 4) {
+        memcpy(&word, data, 4);
+        sum += word;
+        data += 4;
+        len -= 4;
+    }
+
+    if (len >= 2) {
+        uint16_t half = 0;
+        memcpy(&half, data, 2);
+        sum += half;
+        data += 2;
+        len -= 2;
+    }
+
+    // an odd byte is padded w/ a 0 byte after it, as in in_cksum_scalar()
+    if (len == 1) {
+        uint16_t last = 0;
+        *(uint8_t *) (&last) = *data;
+        sum += last;
+    }
+
+    return sum;
+}
+
+#ifdef ICMP_UTILS_X86
+
+// 32 byte per iteration. each 128 bit load is split into its 4 32 bit words, 
+// zero-extended to 64 bit (unpack w/ zero), and added to 2 accumulators of 
+// 2 x 64 bit lanes each.
+__attribute__((target("sse2")))
+static uint64_t sum_sse2(const uint8_t * data, int len, uint64_t sum) {
+
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc_lo = zero;
+    __m128i acc_hi = zero;
+
+    while (len >= 32) {
+
+        __m128i v0 = _mm_loadu_si128((const __m128i *) data);
+        __m128i v1 = _mm_loadu_si128((const __m128i *) (data + 16));
+
+        acc_lo = _mm_add_epi64(acc_lo, _mm_unpacklo_epi32(v0, zero));
+        acc_hi = _mm_add_epi64(acc_hi, _mm_unpackhi_epi32(v0, zero));
+        acc_lo = _mm_add_epi64(acc_lo, _mm_unpacklo_epi32(v1, zero));
+        acc_hi = _mm_add_epi64(acc_hi, _mm_unpackhi_epi32(v1, zero));
+
+        data += 32;
+        len -= 32;
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *) lanes, _mm_add_epi64(acc_lo, acc_hi));
+
+    return sum_scalar(data, len, sum + lanes[0] + lanes[1]);
+}
+
+// same as sum_sse2(), w/ 256 bit registers and 64 byte per iteration. the 
+// unpacks work within each 128 bit half, which is fine : the order of the 
+// words doesn't matter.
+__attribute__((target("avx2")))
+static uint64_t sum_avx2(const uint8_t * data, int len, uint64_t sum) {
+
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc_lo = zero;
+    __m256i acc_hi = zero;
+
+    while (len >= 64) {
+
+        __m256i v0 = _mm256_loadu_si256((const __m256i *) data);
+        __m256i v1 = _mm256_loadu_si256((const __m256i *) (data + 32));
+
+        acc_lo = _mm256_add_epi64(acc_lo, _mm256_unpacklo_epi32(v0, zero));
+        acc_hi = _mm256_add_epi64(acc_hi, _mm256_unpackhi_epi32(v0, zero));
+        acc_lo = _mm256_add_epi64(acc_lo, _mm256_unpacklo_epi32(v1, zero));
+        acc_hi = _mm256_add_epi64(acc_hi, _mm256_unpackhi_epi32(v1, zero));
+
+        data += 64;
+        len -= 64;
+    }
+
+    __m256i acc = _mm256_add_epi64(acc_lo, acc_hi);
+    __m128i acc_128 = _mm_add_epi64(
+        _mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *) lanes, acc_128);
+
+    // the compiler only adds this itself w/ optimizations on. w/o it, the 
+    // (non-vex) sse instructions which follow pay for saving and restoring 
+    // the upper halves of the ymm registers.
+    _mm256_zeroupper();
+
+    // < 64 byte left : the sse2 version takes it from here
+    return sum_sse2(data, len, sum + lanes[0] + lanes[1]);
+}
+
+#endif
+
+typedef uint64_t (*sum_func)(const uint8_t * data, int len, uint64_t sum);
+
+struct cksum_impl {
+    const char * name;
+    sum_func sum;
+};
+
+static struct cksum_impl select_cksum_impl() {
+
+    struct cksum_impl impl = { "scalar", sum_scalar };
+
+#ifdef ICMP_UTILS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        impl.name = "avx2";
+        impl.sum = sum_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        impl.name = "sse2";
+        impl.sum = sum_sse2;
+    }
+#endif
+
+    return impl;
+}
+
+// picked on the 1st call (c++11 makes the initialization thread-safe), 
+// unless set_cksum_impl() says otherwise
+static struct cksum_impl & get_impl() {
+
+    static struct cksum_impl impl = select_cksum_impl();
+    return impl;
+}
+
+uint16_t ICMPUtils::in_cksum(uint16_t * addr, int len) {
+
+    return (uint16_t) ~fold(get_impl().sum((const uint8_t *) addr, len, 0));
+}
+
+uint16_t ICMPUtils::in_cksum_scalar(uint16_t * addr, int len) {
+    int nleft = len;
+    uint32_t sum = 0;
+    uint16_t * w = addr;
+    uint16_t answer = 0;
+
+    /*
+     * the algorithm is simple: using a 32 bit accumulator (sum), we add
+     * sequential 16 bit words to it, and at the end, fold back all the
+     * carry bits from the top 16 bits into the lower 16 bits.
+     */
+    while (nleft > 1)  {
+        sum += *w++;
+        nleft -= 2;
+    }
+
+    /* mop up an odd byte, if necessary */
+    if (nleft == 1) {
+        *(unsigned char *) (&answer) = *(unsigned char *) w ;
+        sum += answer;
+    }
+
+    /* add back carry outs from top 16 bits to low 16 bits */
+    sum = (sum >> 16) + (sum & 0xffff); /* add hi 16 to low 16 */
+    sum += (sum >> 16);         /* add carry */
+    answer = ~sum;              /* truncate to 16 bits */
+
+    return answer;
+}
+
+uint16_t ICMPUtils::in_cksum_update(
+    uint16_t cksum, 
+    uint16_t old_word, 
+    uint16_t new_word) {
+
+    // eqn. 3 of rfc 1624 : HC' = ~(~HC + ~m + m'). rfc 1141's HC' = HC + m - m' 
+    // gets it wrong when the sum of the other words is -0 (see rfc 1624, sec. 3).
+    uint64_t sum = (uint16_t) ~cksum;
+    sum += (uint16_t) ~old_word;
+    sum += new_word;
+
+    return (uint16_t) ~fold(sum);
+}
+
+uint16_t ICMPUtils::in_cksum_update(
+    uint16_t cksum, 
+    const void * old_data, 
+    const void * new_data, 
+    int len) {
+
+    // same as above, w/ m and m' being the (one's complement) sums of the 
+    // old and new data. the sum of the ~m of each word is ~(sum of m).
+    const struct cksum_impl & impl = get_impl();
+
+    uint64_t sum = (uint16_t) ~cksum;
+    sum += (uint16_t) ~fold(impl.sum((const uint8_t *) old_data, len, 0));
+    sum += fold(impl.sum((const uint8_t *) new_data, len, 0));
+
+    return (uint16_t) ~fold(sum);
+}
+
+uint16_t ICMPUtils::in_cksum_fixup(
+    uint16_t cksum, 
+    uint16_t word, 
+    uint16_t target) {
+
+    // eqn. 3 of rfc 1624 solved for m' : ~HC' = ~HC + ~m + m', so 
+    // m' = ~HC' - ~HC - ~m = ~HC' + HC + m (in one's complement, -~x = x)
+    uint64_t sum = (uint16_t) ~target;
+    sum += cksum;
+    sum += word;
+
+    return (uint16_t) fold(sum);
+}
+
+const char * ICMPUtils::get_cksum_impl() {
+
+    return get_impl().name;
+}
+
+int ICMPUtils::set_cksum_impl(const char * name) {
+
+    struct cksum_impl impl = { "scalar", sum_scalar };
+
+#ifdef ICMP_UTILS_X86
+    __builtin_cpu_init();
+
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        impl.name = "avx2";
+        impl.sum = sum_avx2;
+    } else if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        impl.name = "sse2";
+        impl.sum = sum_sse2;
+    } else
+#endif
+    if (strcmp(name, "scalar") != 0)
+        return -1;
+
+    get_impl() = impl;
+
+    return 0;
+}
+
+int ICMPUtils::get_inner_ip_hdr(
+    char * icmp_pckt,               // array of icmp packet bytes
+    int icmp_pckt_len,              // length of icmp packet
+    struct ip * & inner_ip_hdr) {
+
+    // at least icmp header + an ip header within its payload
+    if (icmp_pckt_len < 8 + (int) sizeof(struct ip)) {
+
+        std::cerr << "icmp-utils::get_inner_ip_hdr() : [ERROR] malformed ICMP "\
+            "reply. payload too short to be meaningful (" 
+            << icmp_pckt_len << " byte). skip processing." << std::endl;
+
+        return -1;            
+    }
+
+    // inner ip header should be after icmp header : 8 byte in the icmp packet
+    inner_ip_hdr = (struct ip *) (icmp_pckt + 8);
+
+    return 0;
+}
+
+int ICMPUtils::get_inner_icmp_hdr(
+    char * icmp_pckt, 
+    int icmp_pckt_len,
+    struct icmp * & inner_icmp_hdr) {
+
+    if (icmp_pckt_len < 8 + (int) sizeof(struct ip)) {
+
+        std::cerr << "icmp-utils::get_inner_icmp_hdr() : [ERROR] malformed ICMP "\
+            "reply. payload too short to be meaningful (" 
+            << icmp_pckt_len << " byte). skip processing." << std::endl;
+
+        return -1;
+    }
+
+    // let's now look at the ip header embedded in the icmp reply
+    struct ip * inner_ipv4_hdr = NULL;
+    if (get_inner_ip_hdr(icmp_pckt, icmp_pckt_len, inner_ipv4_hdr) < 0)
+        return -1;
+    int inner_ipv4_hdr_len = (inner_ipv4_hdr->ip_hl << 2);
+
+    if (inner_ipv4_hdr->ip_p != IPPROTO_ICMP) {
+
+        std::cerr << "icmp-utils::get_inner_icmp_hdr() : [ERROR] not "\
+            "an icmp packet (proto code = " << inner_ipv4_hdr->ip_p << "). skip "\
+            "processing." << std::endl;
+
+        return -1; 
+    }
+
+    // we offset the pckt_buff starting address with the length of all the 
+    // headers in between, till the start of the icmp header
+    inner_icmp_hdr = (struct icmp *) (icmp_pckt + 8 + inner_ipv4_hdr_len);
+    // the icmp_len should be at least 8 byte (size of icmp header). 
+    // if not, abort.
+    int inner_icmp_pckt_len = icmp_pckt_len - (8 + inner_ipv4_hdr_len);
+
+    if (inner_icmp_pckt_len < 8) {
+
+        std::cerr << "icmp-utils::get_inner_icmp_hdr() : [ERROR] malformed ICMP "\
+            "packet. header too short (" << inner_icmp_pckt_len << " byte). not "\
+            "processing." << std::endl;  
+
+        return -1;              
+    }
+
+    // return a positive int if inner icmp packet isn't an icmp ECHO reply
+    if (inner_icmp_hdr->icmp_type == ICMP_ECHOREPLY) {
+
+        if (inner_icmp_pckt_len < 16) {
+
+            std::cerr << "icmp-utils::get_inner_icmp_hdr() : [ERROR] malformed ICMP "\
+                "echo reply. payload too short to be meaningful (" 
+                << inner_icmp_pckt_len << " byte). not processing." << std::endl;  
+
+            return -1;            
+        }
+
+    } else {
+
+        return (inner_icmp_hdr->icmp_type);
+    }
+
+    return 0;
+}
+
+int ICMPUtils::get_inner_udp_hdr(
+    char * icmp_pckt, 
+    int icmp_pckt_len,
+    struct udphdr * & inner_udp_hdr) {
+
+    if (icmp_pckt_len < 8 + (int) sizeof(struct ip)) {
+
+        std::cerr << "icmp-utils::get_inner_udp_hdr() : [ERROR] malformed ICMP "\
+            "reply. payload too short to be meaningful (" 
+            << icmp_pckt_len << " byte). skip processing." << std::endl;  
+
+        return -1;            
+    }
+
+    struct ip * inner_ipv4_hdr = NULL;
+    if (get_inner_ip_hdr(icmp_pckt, icmp_pckt_len, inner_ipv4_hdr) < 0)
+        return -1;
+    int inner_ipv4_hdr_len = (inner_ipv4_hdr->ip_hl << 2);
+
+    if (icmp_pckt_len < 8 + inner_ipv4_hdr_len + 4) {
+
+        std::cerr << "icmp-utils::get_inner_udp_hdr() : [ERROR] not "\
+            "enough data to look at udp ports (" << icmp_pckt_len << " byte). skip "\
+            "processing." << std::endl;  
+
+        return -1;              
+    }
+
+    if (inner_ipv4_hdr->ip_p != IPPROTO_UDP) {
+
+        std::cerr << "icmp-utils::get_inner_udp_hdr() : [ERROR] not "\
+            "and udp packet (proto code = " << inner_ipv4_hdr->ip_p << "). skip "\
+            "processing." << std::endl;  
+
+        return -1;                      
+    }
+
+    inner_udp_hdr = (struct udphdr *) (icmp_pckt + 8 + inner_ipv4_hdr_len);
+
+    return 0;
+}
+
+struct icmp * ICMPUtils::prepare_icmp_pckt(
+    char * buffer,
+    uint8_t type, 
+    uint8_t code) {
+
+    // we allocate memory with a char[] (passed as arg), and then use the memory 
+    // block for the struct icmp *
+    struct icmp * icmp_pckt = (struct icmp *) buffer;
+
+    // the <type, code> tuple identifies the icmp message purpose
+    icmp_pckt->icmp_type = type;
+    icmp_pckt->icmp_code = code;
+
+    // following Steven's UNP book, we fill the data portion with '0XA5', then 
+    // with data
+    memset(icmp_pckt->icmp_data, 0xA5, ICMP_DATA_LEN);
+
+    return icmp_pckt;
+}
+
+void ICMPUtils::print_icmp_hdr(struct icmp * icmp_pckt) {
+
+    std::cout << std::endl << "icmp-utils::print_icmp_hdr() : [INFO] icmp header fields :" << std::endl;
+    std::cout << "\ticmp_type = " << std::hex << (uint16_t) icmp_pckt->icmp_type 
+        << " icmp_code = " << std::hex << (uint16_t) icmp_pckt->icmp_code 
+        << " icmp_cksum = " << std::hex << (uint16_t) icmp_pckt->icmp_cksum 
+        << std::endl;
+    std::cout << "\ticmp_id = " << std::hex << (uint16_t) icmp_pckt->icmp_id 
+        << " icmp_seq = " << std::hex << (uint16_t) icmp_pckt->icmp_seq 
+        << std::endl;
+}
+#ifndef NDEBUG
+std::atomic<uint64_t> ICMPProbePool::nr_allocs(0);
+std::atomic<uint64_t> ICMPProbePool::nr_alloc_bytes(0);
+std::atomic<uint64_t> ICMPProbePool::nr_stamps(0);
+#endif
+
+ICMPProbePool::ICMPProbePool(
+    int nr_probes, 
+    int pckt_len, 
+    uint8_t type, 
+    uint8_t code, 
+    uint16_t id_base)
+    : probes(NULL), nr_probes(nr_probes), pckt_len(pckt_len) {
+
+    stride = ((pckt_len + ICMP_PROBE_ALIGN - 1) / ICMP_PROBE_ALIGN) * ICMP_PROBE_ALIGN;
+    size_t size = (size_t) nr_probes * stride;
+
+    // a single block for all probes, aligned on a cache line
+    if (posix_memalign((void **) &probes, ICMP_PROBE_ALIGN, size) != 0)
+        throw std::bad_alloc();
+
+#ifndef NDEBUG
+    nr_allocs++;
+    nr_alloc_bytes += size;
+#endif
+
+    memset(probes, 0, size);
+
+    for (int i = 0; i < nr_probes; i++) {
+
+        struct icmp * icmp_pckt = get(i);
+
+        icmp_pckt->icmp_type = type;
+        icmp_pckt->icmp_code = code;
+        icmp_pckt->icmp_id = htons((uint16_t) (id_base + i));
+        icmp_pckt->icmp_seq = 0;
+        // following Steven's UNP book, we fill the data portion with '0XA5'
+        memset(icmp_pckt->icmp_data, 0xA5, pckt_len - 8);
+
+        // the checksum stamp() starts from
+        icmp_pckt->icmp_cksum = 0;
+        icmp_pckt->icmp_cksum = ICMPUtils::in_cksum((uint16_t *) icmp_pckt, pckt_len);
+    }
+}
+
+ICMPProbePool::~ICMPProbePool() {
+
+    free(probes);
+}
+
+struct icmp * ICMPProbePool::stamp(int i, uint16_t seq, const void * data, int data_len) {
+
+    if (data_len > ICMP_PROBE_MAX_STAMP || data_len > pckt_len - 8) {
+
+        std::cerr << "icmp-utils::stamp() : [ERROR] can't fit " << data_len 
+            << " byte in the probe's data." << std::endl;
+
+        return NULL;
+    }
+
+    struct icmp * icmp_pckt = get(i);
+
+    // the seq number and the start of the data are contiguous (byte 6 
+    // onwards), so a single run of words changes
+    char * changed = (char *) &icmp_pckt->icmp_seq;
+    int changed_len = 2 + data_len;
+    char old_fields[2 + ICMP_PROBE_MAX_STAMP];
+    memcpy(old_fields, changed, changed_len);
+
+    icmp_pckt->icmp_seq = htons(seq);
+    memcpy(icmp_pckt->icmp_data, data, data_len);
+
+    icmp_pckt->icmp_cksum = ICMPUtils::in_cksum_update(
+        icmp_pckt->icmp_cksum, old_fields, changed, changed_len);
+
+#ifndef NDEBUG
+    nr_stamps++;
+#endif
+
+    return icmp_pckt;
+}
+
+struct icmp * ICMPProbePool::pin_cksum(int i, int offset, uint16_t cksum) {
+
+    if (offset < 0 || (offset & 1) || 8 + offset + 2 > pckt_len)
+        return NULL;
+
+    struct icmp * icmp_pckt = get(i);
+    uint16_t * word = (uint16_t *) (((char *) icmp_pckt) + 8 + offset);
+
+    *word = ICMPUtils::in_cksum_fixup(icmp_pckt->icmp_cksum, *word, cksum);
+    icmp_pckt->icmp_cksum = cksum;
+
+    return icmp_pckt;
+}
+
+void ICMPProbePool::print_alloc_stats() {
+
+#ifndef NDEBUG
+    std::cout << "icmp-utils::print_alloc_stats() : [INFO] probe pools : " 
+        << nr_allocs << " allocations (" << nr_alloc_bytes << " byte) for " 
+        << nr_stamps << " probes stamped" << std::endl;
+#endif
+}
@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <vector>
+
+#include "icmp-utils.h"
+
+// checks ICMPUtils::in_cksum() against ICMPUtils::in_cksum_scalar(), w/ each
+// version (avx2, sse2 and plain c) forced in turn : for every length up to
+// MAX_LEN (and a few larger ones), at every offset within a cache line, over
+// random data, all 1s and all 0s. also checks in_cksum_update() against a
+// full re-sum, for random changes to random packets, and that
+// in_cksum_fixup() gets random packets to random checksums. exits w/ 1 on
+// the 1st mismatch. run it w/ 'make check'.
+
+// longer than anything pingy or traceroute sends (incl. jumbo frames)
+#define MAX_LEN         2100
+// offsets 0 to MAX_OFFSET - 1 from an aligned address
+#define MAX_OFFSET      64
+#define NR_UPDATES      1000000
+
+static const char * impls[] = { "avx2", "sse2", "scalar" };
+// up to the largest ip packet. in_cksum_scalar()'s 32 bit accumulator may
+// overflow past 128 KB, so it can't be a reference for more.
+static const int large_lens[] = { 4095, 4096, 9000, 65535, 65536 };
+
+static int check_len(const char * impl, const char * data_name, uint8_t * buff, int offset, int len) {
+
+    uint16_t * addr = (uint16_t *) (buff + offset);
+    uint16_t cksum = ICMPUtils::in_cksum(addr, len);
+    uint16_t ref = ICMPUtils::in_cksum_scalar(addr, len);
+
+    if (cksum == ref)
+        return 0;
+
+    std::cerr << "cksum-check::check_len() : [ERROR] " << impl << " : " << data_name
+        << " data, offset " << offset << ", len " << len << " : 0x" << std::hex << cksum
+        << " (expected 0x" << ref << ")" << std::dec << std::endl;
+
+    return -1;
+}
+
+static int check_impl(const char * impl, std::vector<uint8_t> & buff) {
+
+    const char * data_names[] = { "random", "0xff", "0x00" };
+    uint64_t nr_checks = 0;
+
+    for (int d = 0; d < 3; d++) {
+
+        for (size_t i = 0; i < buff.size(); i++)
+            buff[i] = (d == 0 ? (uint8_t) rand() : (d == 1 ? 0xff : 0x00));
+
+        for (int offset = 0; offset < MAX_OFFSET; offset++) {
+
+            for (int len = 0; len <= MAX_LEN; len++, nr_checks++) {
+                if (check_len(impl, data_names[d], &buff[0], offset, len) < 0)
+                    return -1;
+            }
+
+            for (size_t k = 0; k < sizeof(large_lens) / sizeof(large_lens[0]); k++, nr_checks++) {
+                if (check_len(impl, data_names[d], &buff[0], offset, large_lens[k]) < 0)
+                    return -1;
+            }
+        }
+    }
+
+    std::cout << "cksum-check::check_impl() : [INFO] " << impl << " : "
+        << nr_checks << " lengths / offsets OK" << std::endl;
+
+    return 0;
+}
+
+static int check_updates(const char * impl) {
+
+    // an echo request : 8 byte header, 56 byte data
+    uint8_t pckt[64], before[64];
+    uint16_t * words = (uint16_t *) pckt;
+
+    for (int n = 0; n < NR_UPDATES; n++) {
+
+        for (size_t i = 0; i < sizeof(pckt); i++)
+            pckt[i] = (uint8_t) rand();
+
+        // words[1] is the checksum
+        words[1] = 0;
+        words[1] = ICMPUtils::in_cksum_scalar(words, sizeof(pckt));
+        memcpy(before, pckt, sizeof(pckt));
+
+        uint16_t cksum = 0;
+
+        if (n & 1) {
+
+            // a single word (e.g. the seq number)
+            int w = 2 + (rand() % ((sizeof(pckt) / 2) - 2));
+            uint16_t old_word = words[w];
+            words[w] = (uint16_t) rand();
+            cksum = ICMPUtils::in_cksum_update(words[1], old_word, words[w]);
+
+        } else {
+
+            // a block at an even offset into the data (e.g. a timestamp)
+            int offset = 8 + 2 * (rand() % 28);
+            int len = 1 + rand() % ((int) sizeof(pckt) - offset);
+            for (int i = 0; i < len; i++)
+                pckt[offset + i] = (uint8_t) rand();
+            cksum = ICMPUtils::in_cksum_update(words[1], before + offset, pckt + offset, len);
+        }
+
+        words[1] = 0;
+        uint16_t ref = ICMPUtils::in_cksum_scalar(words, sizeof(pckt));
+
+        // 0x0000 and 0xffff are both 0 in one's complement : the update
+        // may come up w/ either
+        if (cksum != ref && !((cksum == 0 || cksum == 0xffff) && (ref == 0 || ref == 0xffff))) {
+
+            std::cerr << "cksum-check::check_updates() : [ERROR] " << impl << " : update #"
+                << n << " : 0x" << std::hex << cksum << " (expected 0x" << ref << ")"
+                << std::dec << std::endl;
+
+            return -1;
+        }
+    }
+
+    std::cout << "cksum-check::check_updates() : [INFO] " << impl << " : "
+        << NR_UPDATES << " incremental updates OK" << std::endl;
+
+    return 0;
+}
+
+static int check_fixups(const char * impl) {
+
+    // a random packet, whose word at offset 8 is set so that the checksum 
+    // becomes a given one (as traceroute's paris probes do, see 
+    // ICMPProbePool::pin_cksum())
+    uint8_t pckt[64];
+    uint16_t * words = (uint16_t *) pckt;
+
+    for (int n = 0; n < NR_UPDATES; n++) {
+
+        for (size_t i = 0; i < sizeof(pckt); i++)
+            pckt[i] = (uint8_t) rand();
+
+        words[1] = 0;
+        uint16_t cksum = ICMPUtils::in_cksum(words, sizeof(pckt));
+
+        // anything but 0x0000 and 0xffff
+        uint16_t target = (uint16_t) (1 + rand() % 0xfffe);
+        words[4] = ICMPUtils::in_cksum_fixup(cksum, words[4], target);
+
+        uint16_t ref = ICMPUtils::in_cksum_scalar(words, sizeof(pckt));
+
+        if (ref != target) {
+
+            std::cerr << "cksum-check::check_fixups() : [ERROR] " << impl << " : fixup #"
+                << n << " : 0x" << std::hex << ref << " (expected 0x" << target << ")"
+                << std::dec << std::endl;
+
+            return -1;
+        }
+    }
+
+    std::cout << "cksum-check::check_fixups() : [INFO] " << impl << " : "
+        << NR_UPDATES << " fixups OK" << std::endl;
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+
+    srand(1);
+
+    // room for the largest length, at the largest offset
+    std::vector<uint8_t> buff(65536 + MAX_OFFSET);
+    int nr_impls = 0;
+
+    for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+
+        if (ICMPUtils::set_cksum_impl(impls[i]) < 0) {
+
+            std::cout << "cksum-check::main() : [INFO] " << impls[i]
+                << " : not supported by this cpu, skipped" << std::endl;
+
+            continue;
+        }
+
+        if (check_impl(impls[i], buff) < 0 || check_updates(impls[i]) < 0
+            || check_fixups(impls[i]) < 0)
+            return 1;
+
+        nr_impls++;
+    }
+
+    std::cout << "cksum-check::main() : [INFO] all checks passed (" << nr_impls
+        << " versions)" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,307 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/resource.h>   // getrusage()
+#include <sys/socket.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include "icmp-filter.h"
+#include "icmp-utils.h"
+#include "uring-backend.h"
+
+// pingy's two io backends under the same load, side by side : NR_REQUESTS
+// echo requests to 127.0.0.1, w/ up to WINDOW of them in flight at once
+// (i.e. a flood, as w/ pingy -f). 'syscalls' sends w/ sendto() and receives
+// w/ recvmsg(), one packet per call. 'uring' queues the same requests on a
+// UringBackend and submits them in batches, and receives through its
+// multishot recvmsg. for each, prints the packet rate and the cpu time (user
+// + system) per packet, sent or received, as pingy does at exit. the
+// backends take turns, NR_RUNS times each. needs a raw socket (i.e. root or
+// CAP_NET_RAW) : skipped w/o one. run it w/ 'make bench'.
+
+#define NR_REQUESTS     200000
+#define WINDOW          64
+#define NR_RUNS         3
+// requests w/o a reply after this long are given up on (msec)
+#define REPLY_TIMEOUT   100
+
+struct bench_run {
+    uint64_t nr_sent;
+    uint64_t nr_received;
+    uint64_t nr_lost;
+    // nr. of syscalls made to send and receive
+    uint64_t nr_calls;
+};
+
+static double get_cpu_usec() {
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000.0
+        + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static double get_elapsed_sec(struct timespec & start) {
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1000000000.0;
+}
+
+// the ip header is in the packet too (raw socket)
+static bool is_echo_reply(const char * pckt, int len) {
+
+    const struct ip * ip_hdr = (const struct ip *) pckt;
+    int ip_hdr_len = ip_hdr->ip_hl << 2;
+
+    if (len < ip_hdr_len + ICMP_MINLEN)
+        return false;
+
+    return (((const struct icmp *) (pckt + ip_hdr_len))->icmp_type == ICMP_ECHOREPLY);
+}
+
+static void handle_uring_reply(struct msghdr * msg, int len, void * arg) {
+
+    if (is_echo_reply((const char *) msg->msg_iov[0].iov_base, len))
+        ((struct bench_run *) arg)->nr_received++;
+}
+
+static int run_syscalls(int socket_fd, ICMPProbePool * probes, struct sockaddr_in * addr, struct bench_run & run) {
+
+    char buff[2048];
+    struct iovec iov = { buff, sizeof(buff) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    struct pollfd pfd = { socket_fd, POLLIN, 0 };
+    uint64_t in_flight = 0;
+
+    while (run.nr_sent < NR_REQUESTS || in_flight > 0) {
+
+        for ( ; in_flight < WINDOW && run.nr_sent < NR_REQUESTS; in_flight++, run.nr_sent++, run.nr_calls++) {
+
+            struct icmp * icmp_pckt = probes->stamp(0, (uint16_t) run.nr_sent, NULL, 0);
+
+            if (sendto(socket_fd, icmp_pckt, probes->get_pckt_len(), 0,
+                    (struct sockaddr *) addr, sizeof(*addr)) < 0) {
+
+                std::cerr << "io-backend-bench::run_syscalls() : [ERROR] sendto() : "
+                    << strerror(errno) << std::endl;
+
+                return -1;
+            }
+        }
+
+        int rc = poll(&pfd, 1, REPLY_TIMEOUT);
+
+        if (rc < 0 && errno != EINTR)
+            return -1;
+
+        if (rc == 0) {
+            run.nr_lost += in_flight;
+            in_flight = 0;
+            continue;
+        }
+
+        // all queued replies, then back to sending
+        int len = 0;
+
+        while (in_flight > 0 && (len = recvmsg(socket_fd, &msg, MSG_DONTWAIT)) >= 0) {
+
+            run.nr_calls++;
+
+            if (is_echo_reply(buff, len)) {
+                run.nr_received++;
+                in_flight--;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int run_uring(UringBackend * uring, ICMPProbePool * probes, struct sockaddr_in * addr, struct bench_run & run) {
+
+    struct pollfd pfd = { uring->get_event_fd(), POLLIN, 0 };
+    uint64_t nr_enters = uring->get_nr_enters(), nr_answered = 0;
+
+    while (run.nr_sent < NR_REQUESTS || run.nr_sent > nr_answered) {
+
+        uint64_t in_flight = run.nr_sent - nr_answered;
+
+        for ( ; in_flight < WINDOW && run.nr_sent < NR_REQUESTS
+                && uring->get_free_send_slots() > 0; in_flight++, run.nr_sent++) {
+
+            struct icmp * icmp_pckt = probes->stamp(0, (uint16_t) run.nr_sent, NULL, 0);
+
+            if (uring->queue_send(icmp_pckt, probes->get_pckt_len(), addr) < 0)
+                return -1;
+        }
+
+        if (uring->submit() < 0)
+            return -1;
+
+        int rc = poll(&pfd, 1, REPLY_TIMEOUT);
+
+        if (rc < 0 && errno != EINTR)
+            return -1;
+
+        if (rc == 0) {
+            run.nr_lost += run.nr_sent - nr_answered;
+            nr_answered = run.nr_sent;
+            continue;
+        }
+
+        // the eventfd only says 'there are completions' : reset it, then
+        // reap them all (see pingy's event loop)
+        uint64_t nr_signals = 0;
+        if (read(pfd.fd, &nr_signals, sizeof(nr_signals)) < 0 && errno != EAGAIN)
+            return -1;
+
+        run.nr_calls++;
+
+        if (uring->reap() < 0)
+            return -1;
+
+        // a late reply to a request given up on doesn't count twice
+        nr_answered = std::min(run.nr_received + run.nr_lost, run.nr_sent);
+    }
+
+    run.nr_calls += uring->get_nr_enters() - nr_enters;
+
+    return 0;
+}
+
+static void print_run(const char * backend, struct bench_run & run, double elapsed, double cpu_usec) {
+
+    uint64_t nr_pckts = run.nr_sent + run.nr_received;
+
+    std::cout << std::left << std::setw(10) << backend << std::right << std::setw(10) << run.nr_sent
+        << std::setw(10) << run.nr_received << std::setw(8) << run.nr_lost << std::fixed
+        << std::setprecision(3) << std::setw(9) << elapsed << std::setprecision(0) << std::setw(10)
+        << (nr_pckts / elapsed) << std::setprecision(2) << std::setw(12) << (cpu_usec / nr_pckts)
+        << std::setw(12) << ((double) run.nr_calls / nr_pckts) << std::endl;
+}
+
+// a raw icmp socket, which only gets echo replies w/ identifier id : each
+// backend gets its own, so that neither sees (or steals) the other's
+// replies. returns -1 on error.
+static int open_socket(uint16_t id) {
+
+    int socket_fd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+
+    if (socket_fd < 0) {
+
+        std::cout << "io-backend-bench::open_socket() : [INFO] can't open a raw socket ("
+            << strerror(errno) << "). run it as root." << std::endl;
+
+        return -1;
+    }
+
+    // the requests looping back on lo (and everything else) are dropped in
+    // the kernel
+    if (ICMPFilter::attach_echo_filter(socket_fd, id, 1) < 0) {
+        close(socket_fd);
+        return -1;
+    }
+
+    return socket_fd;
+}
+
+int main(int argc, char **argv) {
+
+    uint16_t id = (uint16_t) (getpid() & 0xFFFF);
+    int socket_fd = open_socket(id);
+
+    if (socket_fd < 0) {
+        std::cout << "io-backend-bench::main() : [INFO] skipped" << std::endl;
+        return 0;
+    }
+
+    ICMPProbePool probes(1, ICMP_DATA_LEN + 8, ICMP_ECHO, 0, id);
+    ICMPProbePool uring_probes(1, ICMP_DATA_LEN + 8, ICMP_ECHO, 0, (uint16_t) (id + 1));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    struct bench_run run;
+    int uring_socket_fd = open_socket((uint16_t) (id + 1));
+    UringBackend * uring = NULL;
+
+    if (uring_socket_fd >= 0) {
+
+        uring = new UringBackend(uring_socket_fd, handle_uring_reply, &run);
+
+        if (uring->init() < 0) {
+            delete uring;
+            uring = NULL;
+        }
+    }
+
+    if (uring == NULL) {
+        std::cout << "io-backend-bench::main() : [INFO] io_uring not available, "\
+            "only 'syscalls' is run" << std::endl;
+    }
+
+    std::cout << NR_REQUESTS << " echo requests to 127.0.0.1, " << WINDOW << " in flight" << std::endl;
+    std::cout << std::left << std::setw(10) << "backend" << std::right << std::setw(10) << "sent"
+        << std::setw(10) << "received" << std::setw(8) << "lost" << std::setw(9) << "sec"
+        << std::setw(10) << "pps" << std::setw(12) << "cpu us/pkt" << std::setw(12) << "calls/pkt" << std::endl;
+
+    int rc = 0;
+
+    for (int n = 0; n < NR_RUNS && rc == 0; n++) {
+
+        for (int b = 0; b < 2 && rc == 0; b++) {
+
+            if (b == 1 && uring == NULL)
+                continue;
+
+            memset(&run, 0, sizeof(run));
+
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            double cpu_usec = get_cpu_usec();
+
+            if (b == 0)
+                rc = run_syscalls(socket_fd, &probes, &addr, run);
+            else
+                rc = run_uring(uring, &uring_probes, &addr, run);
+
+            if (rc < 0) {
+                std::cerr << "io-backend-bench::main() : [ERROR] " << (b == 0 ? "syscalls" : "uring")
+                    << " run failed" << std::endl;
+                break;
+            }
+
+            print_run((b == 0 ? "syscalls" : "uring"), run, get_elapsed_sec(start), get_cpu_usec() - cpu_usec);
+        }
+    }
+
+    delete uring;
+
+    if (uring_socket_fd >= 0)
+        close(uring_socket_fd);
+
+    close(socket_fd);
+
+    return (rc < 0 ? 1 : 0);
+}
@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include <sys/resource.h>   // getrusage()
+
+#include <iomanip>
+#include <iostream>
+
+#include "timing-wheel.h"
+
+// benchmark of TimingWheel w/ NR_TIMERS pending timers, due 1 to SPREAD
+// ticks out : the cost of insert and cancel, of a tick in steady state
+// (NR_TIMERS / SPREAD expiries per tick, each one inserting a new timer, as
+// probes timing out make room for new ones) and of draining the wheel (incl.
+// cascades). also prints the slab's size and the process' max. rss before
+// and after, to show memory stays bounded. run it w/ 'make bench'.
+
+#define NR_TIMERS       10000000
+// timeouts, in ticks (2 sec w/ a 1 ms tick)
+#define SPREAD          2000
+#define NR_STEADY_TICKS 4000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng() {
+
+    // xorshift64
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+
+    return rng_state;
+}
+
+static double get_elapsed_ns(struct timespec & start) {
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double) (end.tv_sec - start.tv_sec) * 1000000000.0 + (double) (end.tv_nsec - start.tv_nsec);
+}
+
+static long get_max_rss_kb() {
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_maxrss;
+}
+
+struct steady_state {
+    TimingWheel * wheel;
+    uint64_t tick;
+};
+
+// a probe timed out : another one takes its place
+static void on_expire_reinsert(uint64_t data, void * arg) {
+
+    struct steady_state * s = (struct steady_state *) arg;
+    s->wheel->insert_at(s->tick + 1 + rng() % SPREAD, data);
+}
+
+static void on_expire_count(uint64_t data, void * arg) {
+
+    (*(uint64_t *) arg)++;
+}
+
+static void print_result(const char * op, uint64_t nr, double ns, const char * unit) {
+
+    std::cout << std::left << std::setw(10) << op << std::right << std::setw(12) << nr
+        << std::fixed << std::setprecision(1) << std::setw(14) << (ns / nr) << " " << unit << std::endl;
+}
+
+int main(int argc, char **argv) {
+
+    TimingWheel wheel(NR_TIMERS, 1000000);
+    uint64_t * handles = new uint64_t[NR_TIMERS];
+
+    std::cout << std::left << std::setw(10) << "op" << std::right << std::setw(12) << "nr"
+        << std::setw(14) << "cost" << std::endl;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (uint64_t i = 0; i < NR_TIMERS; i++)
+        handles[i] = wheel.insert_at(1 + rng() % SPREAD, i);
+
+    print_result("insert", NR_TIMERS, get_elapsed_ns(start), "ns/timer");
+
+    uint64_t slab_size = wheel.get_slab_size();
+    long max_rss = get_max_rss_kb();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (uint64_t i = 0; i < NR_TIMERS; i++)
+        wheel.cancel(handles[i]);
+
+    print_result("cancel", NR_TIMERS, get_elapsed_ns(start), "ns/timer");
+
+    // refill it, w/ the free list now in random order (as it would be
+    // after a while)
+    for (uint64_t i = 0; i < NR_TIMERS; i++)
+        wheel.insert_at(1 + rng() % SPREAD, i);
+
+    struct steady_state s;
+    s.wheel = &wheel;
+    s.tick = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int n = 0; n < NR_STEADY_TICKS; n++) {
+        s.tick++;
+        wheel.advance_to(s.tick, on_expire_reinsert, &s);
+    }
+
+    double ns = get_elapsed_ns(start);
+    print_result("tick", NR_STEADY_TICKS, ns / 1000000.0, "ms/tick");
+    print_result("expire", wheel.get_nr_expired(), ns, "ns/timer (incl. a new insert)");
+
+    uint64_t nr_pending = wheel.size(), nr_drained = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    wheel.advance_to(s.tick + SPREAD + 1, on_expire_count, &nr_drained);
+    print_result("drain", nr_drained, get_elapsed_ns(start), "ns/timer");
+
+    std::cout << "timing-wheel-bench::main() : [INFO] " << nr_pending << " timers pending, slab of "
+        << (slab_size >> 20) << " MB after the 1st " << NR_TIMERS << " inserts, "
+        << (wheel.get_slab_size() >> 20) << " MB at the end. max. rss " << (max_rss >> 10)
+        << " MB after the 1st inserts, " << (get_max_rss_kb() >> 10) << " MB at the end." << std::endl;
+
+    delete [] handles;
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef CYCLIC_PERMUTATION_H
+#define CYCLIC_PERMUTATION_H
+
+#include <stdint.h>
+
+#include <random>
+
+// walks [0, n) in a pseudo-random order, w/o keeping track of what was
+// already visited (as zmap does). the idea:
+//  -# pick the smallest prime p > n. the multiplicative group of integers
+//     modulo p, Z*_p = {1, ..., p - 1}, is cyclic.
+//  -# pick a random generator g of Z*_p, and a random start x_0 in Z*_p.
+//  -# x_{k+1} = x_k * g mod p visits every element of Z*_p exactly once,
+//     before coming back to x_0.
+//  -# x_k - 1 is the next index, skipping those >= n (there are only a few,
+//     since p is close to n).
+// so the whole state is 3 integers, whatever n (up to 2^32).
+class CyclicPermutation {
+
+    public:
+
+        // n : the size of the range, at most 2^32
+        CyclicPermutation(uint64_t n);
+        ~CyclicPermutation() {}
+
+        // sets index to the next one in the permutation. returns false once
+        // all n indexes have been visited.
+        bool next(uint64_t & index);
+
+        uint64_t get_prime() { return prime; }
+        uint64_t get_generator() { return generator; }
+
+    private:
+
+        static bool is_prime(uint64_t x);
+        static uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t m);
+        static uint64_t pow_mod(uint64_t base, uint64_t exp, uint64_t m);
+        bool is_generator(uint64_t g);
+
+        uint64_t n;
+        uint64_t prime;
+        uint64_t generator;
+        uint64_t first;
+        uint64_t current;
+        bool done;
+
+        std::mt19937_64 rng;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <netinet/in.h>
+
+// default nr. of addresses kept in the cache
+#define DNS_CACHE_SIZE          4096
+// max. nr. of addresses waiting to be resolved. requests beyond that are
+// dropped (and retried on the next lookup of the same address).
+#define DNS_MAX_PENDING         1024
+#define DNS_MAX_NAME_SIZE       256
+
+// an asynchronous reverse dns resolver, behind a bounded lru cache keyed by
+// ipv4 address. lookup() never blocks on the network : it either returns the
+// cached name, or queues the address for the resolver thread and returns
+// false right away, so that the caller can print the numeric address in the
+// meantime. the resolver thread uses getnameinfo() (unlike gethostbyaddr(),
+// it's thread-safe) and doesn't hold the cache lock while resolving.
+class DnsCache {
+
+    public:
+
+        DnsCache(size_t capacity);
+        ~DnsCache();
+
+        // copies the name of addr into name (w/ up to name_len bytes) and 
+        // returns true if it is known. addresses w/o a reverse mapping are 
+        // cached as their dotted-decimal string. returns false if the name 
+        // isn't known yet.
+        bool lookup(struct in_addr addr, char * name, size_t name_len);
+
+    private:
+
+        struct dns_entry {
+            uint32_t addr;
+            bool resolved;
+            char name[DNS_MAX_NAME_SIZE];
+        };
+
+        size_t capacity;
+
+        // most recently used entries at the front. the map points into the 
+        // list, so that entries can be found and moved to the front in O(1).
+        std::list<struct dns_entry> lru;
+        std::unordered_map<uint32_t, std::list<struct dns_entry>::iterator> entries;
+
+        // addresses waiting for the resolver thread
+        std::deque<uint32_t> pending;
+
+        std::mutex lock;
+        std::condition_variable has_pending;
+        bool stop;
+
+        std::thread resolver;
+
+        void resolve_loop();
+};
+
+#endif
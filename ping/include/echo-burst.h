@@ -0,0 +1,74 @@
+#ifndef ECHO_BURST_H
+#define ECHO_BURST_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+
+#include "ping-target.h"
+#include "timing-wheel.h"
+
+// builds and sends bursts of icmp echo requests w/ a single sendmmsg() call.
+// the packets are copies of a template (type, code and payload fill are set
+// once), so that for each packet in a burst only the id, seq, payload (see
+// struct echo_payload) and checksum have to be written. the checksum itself isn't recomputed over the
+// whole packet: the one's complement sum of the template's constant words is
+// computed once, and only the changing words are added to it per packet.
+class EchoBurst {
+
+    public:
+
+        // icmp_template : a prepared echo request (see ICMPProbePool), 
+        // pckt_len bytes long (icmp header + data)
+        EchoBurst(int burst_size, struct icmp * icmp_template, int pckt_len);
+        ~EchoBurst();
+
+        // fills the burst w/ echo requests to the next burst_size targets, 
+        // round-robin starting at next_target (which is updated), and sends 
+        // them w/ sendmmsg(). on a non-blocking socket, the burst may be cut 
+        // short (EAGAIN) : the remaining packets are then sent by the next 
+        // call, before a new burst is built. returns the nr. of packets sent 
+        // (0 if the socket's send buffer is full), -1 on error.
+        int send(int socket_fd, TargetTable * targets, size_t & next_target);
+
+        // starts a timeout of timeout_nsec in timeouts for each echo request 
+        // built from now on
+        void set_timeouts(TimingWheel * timeouts, uint64_t timeout_nsec) {
+            this->timeouts = timeouts;
+            this->timeout_nsec = timeout_nsec;
+        }
+
+        uint64_t get_nr_bursts() { return nr_bursts; }
+        uint64_t get_nr_sent() { return nr_sent; }
+
+    private:
+
+        // sends the packets of the current burst from next_unsent onwards
+        int send_pending(int socket_fd);
+
+        int burst_size;
+        int pckt_len;
+
+        char * pckts;
+        struct iovec * iovecs;
+        struct mmsghdr * msgs;
+
+        // index of the 1st packet of the current burst not sent yet. 0 if 
+        // the whole burst went out.
+        int next_unsent;
+
+        // one's complement sum (not folded) of the template, w/ the id, seq, 
+        // checksum and payload fields set to 0
+        uint32_t template_sum;
+
+        TimingWheel * timeouts;
+        uint64_t timeout_nsec;
+
+        uint64_t nr_bursts;
+        uint64_t nr_sent;
+};
+
+#endif
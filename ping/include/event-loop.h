@@ -0,0 +1,73 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <vector>
+
+#include <sys/epoll.h>
+
+// max. nr. of events returned by a single EventLoop::wait() call
+#define EVENT_LOOP_MAX_EVENTS   16
+
+// a thin wrapper around an epoll instance, so that a single thread can wait
+// on everything pingy cares about at once:
+//  -# the raw socket (replies, and tx timestamps on its error queue)
+//  -# timerfds, for send deadlines and periodic reports
+//  -# a signalfd, so that SIGINT and SIGTERM arrive as plain events instead
+//     of interrupting syscalls at random points
+// the loop owns (and closes) the timer and signal fds it creates, but not the
+// fds added w/ add_fd(). nothing in here is shared, so scaling out is a
+// matter of running one EventLoop per thread, each w/ its own socket and
+// targets (see pingy's --threads).
+class EventLoop {
+
+    public:
+
+        EventLoop();
+        ~EventLoop();
+
+        // watches fd for events (EPOLLIN, EPOLLOUT, ...). EPOLLERR and
+        // EPOLLHUP are always reported. returns 0 on success, -1 on error.
+        int add_fd(int fd, uint32_t events);
+
+        // changes the events watched on an fd already added w/ add_fd()
+        int mod_fd(int fd, uint32_t events);
+
+        // creates a (disarmed) timerfd on CLOCK_MONOTONIC, and watches it for
+        // expirations. returns the timerfd, -1 on error.
+        int add_timer();
+
+        // creates a signalfd for the given signals, and watches it. the
+        // signals are blocked in the calling thread (and so in any thread
+        // created after this call), otherwise they'd still be delivered the
+        // usual way. returns the signalfd, -1 on error.
+        int add_signals(const int * signos, int nr_signos);
+
+        // waits for events, at most timeout_ms (-1 means forever). returns the
+        // nr. of events written to events (0 on timeout or if interrupted),
+        // -1 on error.
+        int wait(struct epoll_event * events, int max_events, int timeout_ms);
+
+        // arms timer_fd to expire at the absolute CLOCK_MONOTONIC time
+        // deadline and, if period_usec > 0, every period_usec after that. a
+        // deadline in the past expires right away.
+        static int arm_timer(int timer_fd, const struct timespec & deadline, uint64_t period_usec);
+
+        // reads (and resets) the nr. of expirations of timer_fd. returns 0 if
+        // it hasn't expired.
+        static uint64_t read_timer(int timer_fd);
+
+        // reads the next pending signal from signal_fd. returns the signal
+        // nr., 0 if none is pending.
+        static int read_signal(int signal_fd);
+
+    private:
+
+        int epoll_fd;
+        // timer and signal fds created by the loop, closed in the destructor
+        std::vector<int> owned_fds;
+};
+
+#endif
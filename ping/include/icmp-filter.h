@@ -0,0 +1,43 @@
+#ifndef ICMP_FILTER_H
+#define ICMP_FILTER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// in-kernel filtering for pingy's raw icmp socket. a SOCK_RAW / IPPROTO_ICMP
+// socket gets a copy of *every* icmp packet the host receives, including
+// replies to other ping processes. w/ a classic bpf program attached
+// (SO_ATTACH_FILTER), the kernel drops those before they're queued on our
+// socket, so we're not woken up to parse them. the program accepts only :
+//  -# echo replies whose icmp identifier is one of ours
+//  -# icmp errors (dest. unreachable, time exceeded, parameter problem,
+//     source quench) which quote one of our echo requests
+// our identifiers are the range [id_base, id_base + nr_ids), modulo 2^16
+// (see TargetTable).
+class ICMPFilter {
+
+    public:
+
+        ICMPFilter() {}
+        ~ICMPFilter() {}
+
+        // builds the bpf program and attaches it to socket_fd. net_off is 
+        // where the ip header starts, as seen by the filter : 0 for raw ip 
+        // sockets, SKF_NET_OFF for packet sockets (see packet-ring.h). 
+        // returns 0 on success, -1 otherwise.
+        static int attach_echo_filter(
+            int socket_fd, uint16_t id_base, uint32_t nr_ids, int32_t net_off = 0);
+
+        // attaches a filter which drops everything, e.g. to keep a socket 
+        // which is only used for sending from queueing packets
+        static int attach_drop_filter(int socket_fd);
+
+        // the kernel doesn't count the packets a socket filter drops. as an 
+        // estimate, we use the host-wide nr. of icmp messages received 
+        // (Icmp: InMsgs in /proc/net/snmp) : the difference between its 
+        // increase and what we were delivered is what the filter dropped. 
+        // returns 0 on success, -1 otherwise.
+        static int get_icmp_in_msgs(uint64_t & in_msgs);
+};
+
+#endif
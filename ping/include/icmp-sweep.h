@@ -0,0 +1,139 @@
+#ifndef ICMP_SWEEP_H
+#define ICMP_SWEEP_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <vector>
+#include <utility>
+
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+
+#include "cyclic-permutation.h"
+
+// a sweep probe's data : the upper 32 bit of the cookie (see below), then
+// the send time (a struct timespec)
+#define SWEEP_DATA_LEN      (4 + 16)
+// replies are de-duplicated w/ a bitmap over the range, for ranges of up to
+// this many addresses (a /8 : 2 MB of bitmap). larger ranges get no
+// de-duplication.
+#define SWEEP_MAX_DEDUP     (1ULL << 24)
+
+// a stateless icmp echo sweep over an address range (in cidr notation, e.g.
+// 10.0.0.0/16), for checking the liveness of many hosts at once. unlike
+// TargetTable, nothing is kept per probe, or per address :
+//  -# the range is walked in a pseudo-random order (see CyclicPermutation),
+//     so that consecutive probes don't hit the same subnet. excluded ranges
+//     are skipped as they come up.
+//  -# each probe carries a cookie, a keyed hash (siphash-2-4, w/ a random
+//     key per sweep) of its destination address : its 1st 32 bit go in
+//     icmp_id and icmp_seq, the other 32 bit at the start of the data.
+//  -# a reply is validated by hashing its source address again, and
+//     comparing the result to the cookie it echoes back. the rtt comes from
+//     the send time, also echoed back. icmp errors only quote the 1st 8
+//     byte of our echo request, so these are validated against the quoted
+//     destination and icmp_id / icmp_seq only.
+// probes are sent in batches, w/ a single sendmmsg() call each.
+class IcmpSweep {
+
+    public:
+
+        IcmpSweep(int batch_size);
+        ~IcmpSweep();
+
+        // sets the range to sweep, e.g. "10.0.0.0/16" (a plain address is
+        // a /32). returns 0 on success, -1 on error.
+        int set_range(const char * cidr);
+
+        // excludes a range (in the same format) from the sweep. returns 0
+        // on success, -1 on error.
+        int add_exclusion(const char * cidr);
+
+        // adds the exclusions listed in filename, one range per line ('#'
+        // starts a comment). returns the nr. of exclusions added, -1 on
+        // error.
+        int load_exclusions(const char * filename);
+
+        // sets up the permutation and the cookie key. must be called after
+        // set_range() and the exclusions, and before send(). returns 0 on
+        // success, -1 on error.
+        int start();
+
+        // builds up to max probes (at most a batch) to the next addresses
+        // in the permutation, and sends them w/ sendmmsg(). as in EchoBurst,
+        // a batch cut short (EAGAIN) is sent first by the next call. returns
+        // the nr. of probes sent (0 if the send buffer is full), -1 on error.
+        int send(int socket_fd, int max);
+
+        // true once every address in the range was sent a probe
+        bool is_done() { return (exhausted && next_unsent >= nr_built); }
+
+        // validates an icmp packet (ip header included) from src, received
+        // at rx_ts (CLOCK_REALTIME), and prints a line for each new live
+        // (or unreachable) host, unless quiet. returns 1 for a valid reply,
+        // 0 if it's not one of ours.
+        int process_reply(
+            char * pckt, int len,
+            struct sockaddr_in * src,
+            const struct timespec * rx_ts,
+            bool quiet);
+
+        uint64_t get_range_size() { return range_size; }
+        uint64_t get_nr_sent() { return nr_sent; }
+        uint64_t get_nr_excluded() { return nr_excluded; }
+        uint64_t get_nr_alive() { return nr_alive; }
+        uint64_t get_nr_duplicates() { return nr_duplicates; }
+        uint64_t get_nr_unreachable() { return nr_unreachable; }
+        uint64_t get_nr_invalid() { return nr_invalid; }
+
+        // parses "a.b.c.d/prefix" into the 1st address of the range (host
+        // byte order) and its size. returns 0 on success, -1 on error.
+        static int parse_cidr(const char * cidr, uint32_t & first, uint64_t & size);
+
+    private:
+
+        uint64_t get_cookie(uint32_t addr);
+        bool is_excluded(uint32_t addr);
+        int send_pending(int socket_fd);
+        // marks addr as seen. returns true if it already was.
+        bool check_seen(uint32_t addr);
+
+        // the range, in host byte order
+        uint32_t range_first;
+        uint64_t range_size;
+        // excluded ranges [first, last] (host byte order), sorted and merged
+        // by start()
+        std::vector< std::pair<uint32_t, uint32_t> > exclusions;
+
+        CyclicPermutation * permutation;
+        bool exhausted;
+
+        // siphash key
+        uint64_t key[2];
+
+        // batch of probes
+        int batch_size;
+        int pckt_len;
+        char * pckts;
+        struct sockaddr_in * addrs;
+        struct iovec * iovecs;
+        struct mmsghdr * msgs;
+        int nr_built;
+        int next_unsent;
+
+        // a bit per address in the range (if not too large)
+        std::vector<uint8_t> seen;
+
+        uint64_t nr_sent;
+        uint64_t nr_excluded;
+        uint64_t nr_alive;
+        uint64_t nr_duplicates;
+        uint64_t nr_unreachable;
+        uint64_t nr_invalid;
+};
+
+#endif
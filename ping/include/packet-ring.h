@@ -0,0 +1,77 @@
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+// the ring is made of blocks, each holding as many (variable size) frames as
+// fit. the kernel hands a block to user space when it's full, or after
+// PACKET_RING_BLOCK_TIMEOUT msec. the rtts don't depend on the latter, since
+// each frame carries the kernel's rx timestamp.
+#define PACKET_RING_BLOCK_SIZE      (1 << 18)
+#define PACKET_RING_NR_BLOCKS       64
+#define PACKET_RING_FRAME_SIZE      2048
+#define PACKET_RING_BLOCK_TIMEOUT   2
+
+// called for every packet in the ring. msg is laid out like a msghdr filled
+// by recvmsg() on a raw ip socket : a single iovec pointing at the ip header
+// (in the ring itself, no copy), and the source address. it's only valid
+// during the call. rx_ts is the kernel's rx timestamp (CLOCK_REALTIME).
+typedef void (*packet_ring_handler)(
+    struct msghdr * msg, int len, const struct timespec * rx_ts, void * arg);
+
+// receives icmp replies through a memory-mapped TPACKET_V3 receive ring
+// (PACKET_RX_RING) on an AF_PACKET socket, instead of copying each packet
+// into a buffer w/ recvmsg(). the kernel writes packets straight into memory
+// shared w/ us, and hands them over a block (i.e. possibly many packets) at
+// a time, so there's no syscall per packet, and no copy to user space.
+// the packet socket sees all ipv4 traffic, so the same bpf filter as the raw
+// socket's (see icmp-filter.h) is attached to it, w/ loads relative to the
+// network header, so that it works whatever the link layer header is.
+class PacketRing {
+
+    public:
+
+        PacketRing();
+        ~PacketRing();
+
+        // creates the packet socket. needs CAP_NET_RAW, so it must be called
+        // before dropping privileges. returns 0 on success, -1 on error.
+        int open_socket();
+
+        // attaches the filter for our icmp identifiers (see ICMPFilter),
+        // sets up and maps the ring, and binds the socket to interface
+        // ifname ("any" for all interfaces). returns 0 on success, -1 on
+        // error.
+        int setup(const char * ifname, uint16_t id_base, uint32_t nr_ids);
+
+        // readable (EPOLLIN) when a block is ready for user space
+        int get_fd() { return socket_fd; }
+
+        // calls handler for each packet in the blocks ready for user space,
+        // and hands the blocks back to the kernel. returns the nr. of
+        // packets, -1 on error.
+        int receive(packet_ring_handler handler, void * arg);
+
+        uint64_t get_nr_blocks() { return nr_blocks; }
+        uint64_t get_nr_packets() { return nr_packets; }
+
+        // nr. of packets the kernel dropped because the ring was full, since
+        // the last call (PACKET_STATISTICS). -1 on error.
+        int64_t get_drops();
+
+    private:
+
+        int socket_fd;
+        char * ring;
+        size_t ring_size;
+        // the next block to read
+        unsigned int current_block;
+
+        uint64_t nr_blocks;
+        uint64_t nr_packets;
+};
+
+#endif
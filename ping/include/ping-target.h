@@ -0,0 +1,98 @@
+#ifndef PING_TARGET_H
+#define PING_TARGET_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <vector>
+
+#include <time.h>
+#include <netinet/in.h>
+
+#include "rtt-stats.h"
+#include "seq-window.h"
+
+#define MAX_HOSTNAME_SIZE   256
+// the icmp identifier field is 16 bit long, and each target gets its own
+// identifier (see TargetTable below). so this is as many targets as a single
+// raw socket can tell apart.
+#define MAX_TARGETS         65536
+
+// what an echo request carries at the start of its data, and gets echoed
+// back : the send time (CLOCK_REALTIME) and the handle of the request's
+// timeout in the TimingWheel, so that a reply can cancel it w/o a lookup
+struct echo_payload {
+    struct timespec timestamp;
+    uint64_t timer;
+};
+
+// everything pingy keeps about a single destination
+struct ping_target {
+    // the name as given by the user (hostname or dotted-decimal)
+    char hostname[MAX_HOSTNAME_SIZE];
+    // destination address, resolved once at load time
+    struct sockaddr_in addr;
+    // icmp identifier used in all echo requests to this target (host byte
+    // order)
+    uint16_t id;
+    // seq number to be used in the next echo request (host byte order)
+    uint16_t next_seq;
+    // position of this target in the TargetTable
+    uint32_t index;
+    // nr. of echo requests sent and (distinct) echo replies received
+    uint64_t sent;
+    uint64_t received;
+    // nr. of echo requests which got no reply w/in the timeout
+    uint64_t timed_out;
+    // rtt statistics, updated w/ every echo reply (except duplicates)
+    RttStats rtt_stats;
+    // which seq numbers got a reply, to tell late, duplicate and reordered 
+    // replies apart
+    SeqWindow seq_window;
+};
+
+// keeps the list of ping targets and demultiplexes echo replies back to
+// them. the idea is simple: when sending to many targets from a single raw
+// socket, every target is given a distinct icmp identifier,
+// (id_base + target index) mod 2^16. an (icmp_id, icmp_seq) pair arriving in
+// an echo reply is then resolved w/ two O(1) steps:
+//  -# icmp_id indexes a flat 2^16 entry array, which holds the target index
+//  -# icmp_seq is checked against the range of seq numbers already sent to
+//     that target
+// no hashing, no searching, and no allocation on the receive path.
+class TargetTable {
+
+    public:
+
+        TargetTable(uint16_t id_base);
+        ~TargetTable() {}
+
+        // resolves hostname (a name or dotted-decimal string) and appends it
+        // to the table. returns the index of the new target, -1 on error.
+        int add_target(const char * hostname);
+
+        // same, for a target whose address is already known (e.g. a target 
+        // of another table), w/o resolving hostname again
+        int add_target(const char * hostname, struct in_addr addr);
+
+        // reads targets from a file, one hostname per line. empty lines and
+        // lines starting w/ '#' are skipped. returns the nr. of targets
+        // added, -1 if the file can't be read.
+        int load_targets(const char * filename);
+
+        // returns the target an echo reply w/ the given (icmp_id, icmp_seq)
+        // (host byte order) belongs to, NULL if it isn't one of ours
+        struct ping_target * lookup(uint16_t id, uint16_t seq);
+
+        size_t size() { return targets.size(); }
+        struct ping_target * get(size_t i) { return &targets[i]; }
+
+    private:
+
+        uint16_t id_base;
+        std::vector<struct ping_target> targets;
+        // indexed by icmp_id, holds (target index + 1). 0 means 'no target'.
+        std::vector<uint32_t> id_to_target;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef PROBE_SCHEDULER_H
+#define PROBE_SCHEDULER_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <random>
+
+// probe timing patterns supported by ProbeScheduler
+#define SCHEDULE_FIXED      0   // one tick every interval
+#define SCHEDULE_POISSON    1   // exponentially distributed gaps (RFC 2330)
+#define SCHEDULE_BURST      2   // trains of back-to-back ticks, every interval
+
+// decides when probes are sent. all deadlines are absolute points in time on
+// CLOCK_MONOTONIC, computed from the previous deadline (not from 'now'), so
+// the time spent building and sending probes doesn't accumulate as drift:
+// the k-th tick of a fixed schedule fires at start + k * interval, no matter
+// how long each send took.
+class ProbeScheduler {
+
+    public:
+
+        // interval_usec : the (mean) interval between ticks, or between the 
+        // start of trains for SCHEDULE_BURST
+        // train_len : nr. of back-to-back ticks per train (SCHEDULE_BURST 
+        // only)
+        ProbeScheduler(int pattern, uint64_t interval_usec, int train_len);
+        ~ProbeScheduler() {}
+
+        // the absolute deadline of the next tick, to arm a 
+        // TFD_TIMER_ABSTIME timerfd at. if we're already late, the timerfd 
+        // fires right away (the schedule isn't shifted : we catch up).
+        const struct timespec & get_next_deadline() { return next_deadline; }
+
+        // moves to the following deadline, once the current one's tick is 
+        // handled
+        void advance();
+
+        // translates a pattern name ("fixed", "poisson" or "burst") into a 
+        // SCHEDULE_* value. returns -1 for unknown names.
+        static int parse_pattern(const char * name);
+
+    private:
+
+        int pattern;
+        uint64_t interval_usec;
+        int train_len;
+        // position within the current train (SCHEDULE_BURST)
+        int train_pos;
+
+        struct timespec next_deadline;
+
+        std::mt19937_64 rng;
+        std::exponential_distribution<double> exp_gap;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef RECV_RING_H
+#define RECV_RING_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <netinet/in.h>
+
+// size of each slot's packet buffer (as with recv_buffer in pingy's main())
+#define RECV_RING_BUFFER_SIZE   1500
+// size of each slot's ancillary data buffer. a few cmsgs (e.g. kernel
+// timestamps) fit here comfortably.
+#define RECV_RING_CTRL_SIZE     256
+
+// a preallocated ring of recvmmsg() slots. each slot has its own packet
+// buffer, ancillary data buffer, source address, iovec and msghdr, all
+// allocated once in the constructor. receive() then drains up to 'slots'
+// packets from a socket w/ a single recvmmsg() syscall, instead of one
+// recvmsg() syscall per packet.
+class RecvRing {
+
+    public:
+
+        RecvRing(int slots);
+        ~RecvRing();
+
+        // blocks until at least one packet is available, then returns as 
+        // many as are queued (up to 'slots'). on a non-blocking socket, fails 
+        // w/ EAGAIN instead of blocking. returns the nr. of packets 
+        // received, -1 on error (w/ errno set by recvmmsg()).
+        int receive(int socket_fd);
+
+        // the msghdr and nr. of bytes received in slot i, valid until the 
+        // next call to receive()
+        struct msghdr * get_msg(int i) { return &msgs[i].msg_hdr; }
+        int get_len(int i) { return (int) msgs[i].msg_len; }
+
+        int get_slots() { return slots; }
+        uint64_t get_nr_batches() { return nr_batches; }
+        uint64_t get_nr_packets() { return nr_packets; }
+
+        // average nr. of packets returned per recvmmsg() call. if this 
+        // sits close to 'slots', the ring is probably too small.
+        double get_avg_batch_size();
+
+    private:
+
+        int slots;
+
+        char * buffers;
+        char * ctrl_buffers;
+        struct sockaddr_in * addrs;
+        struct iovec * iovecs;
+        struct mmsghdr * msgs;
+
+        uint64_t nr_batches;
+        uint64_t nr_packets;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef RTT_STATS_H
+#define RTT_STATS_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// the rtt histogram is log-linear (as in HdrHistogram) : each power-of-two
+// range of rtts, [2^m, 2^(m + 1)) usec, is split into 2^RTT_HIST_SUB_BITS
+// linear sub-buckets. the relative error of a percentile is thus bounded by
+// 1 / 2^RTT_HIST_SUB_BITS (~3%), whatever the rtt's magnitude.
+#define RTT_HIST_SUB_BITS       5
+#define RTT_HIST_SUB_BUCKETS    (1 << RTT_HIST_SUB_BITS)
+// largest rtt the histogram tells apart : 2^RTT_HIST_MAX_EXP usec (~67 sec).
+// larger rtts go into the last bucket.
+#define RTT_HIST_MAX_EXP        26
+#define RTT_HIST_BUCKETS        \
+    (RTT_HIST_SUB_BUCKETS * (RTT_HIST_MAX_EXP - RTT_HIST_SUB_BITS + 1))
+
+// streaming rtt statistics for a single target, in constant memory (~3 KB)
+// and O(1) per sample :
+//  - min, max
+//  - mean and variance, w/ Welford's online algorithm (numerically stable,
+//    unlike keeping sum and sum of squares)
+//  - percentiles, from the log-linear histogram
+class RttStats {
+
+    public:
+
+        RttStats();
+        ~RttStats() {}
+
+        void add(int64_t rtt_nsec);
+
+        uint64_t get_count() { return count; }
+
+        // all in msec
+        double get_min() { return (count ? min_nsec / 1000000.0 : 0.0); }
+        double get_max() { return (count ? max_nsec / 1000000.0 : 0.0); }
+        double get_mean() { return mean / 1000000.0; }
+        // standard deviation (what ping calls 'mdev')
+        double get_stdev();
+        // p in [0.0, 1.0], e.g. 0.999 for the 99.9th percentile
+        double get_percentile(double p);
+
+    private:
+
+        uint64_t count;
+        int64_t min_nsec;
+        int64_t max_nsec;
+
+        // Welford's running mean and sum of squared differences (in nsec)
+        double mean;
+        double m2;
+
+        uint32_t buckets[RTT_HIST_BUCKETS];
+
+        static int bucket_index(uint64_t rtt_usec);
+        // the midpoint of a bucket's range of values, in usec
+        static double bucket_value(int index);
+};
+
+#endif
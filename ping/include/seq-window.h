@@ -0,0 +1,61 @@
+#ifndef SEQ_WINDOW_H
+#define SEQ_WINDOW_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// size of the sliding window, in seq numbers. must be a power of 2, and much
+// smaller than 2^15, so that the distance between 2 16 bit seq numbers can be
+// read as a signed int16_t w/o ambiguity.
+#define SEQ_WINDOW_SIZE     1024
+#define SEQ_WINDOW_WORDS    (SEQ_WINDOW_SIZE / 64)
+
+// classes of replies, as returned by SeqWindow::classify()
+#define REPLY_ON_TIME       0   // 1st copy, in order, w/in the timeout
+#define REPLY_LATE          1   // 1st copy, but after the timeout (or too old 
+                                // to be tracked by the window)
+#define REPLY_DUPLICATE     2   // a copy of a reply we already got
+#define REPLY_REORDERED     3   // 1st copy, w/in the timeout, but after a 
+                                // reply w/ a higher seq number
+
+// keeps track of which seq numbers a target has replied to, over a sliding
+// window of the last SEQ_WINDOW_SIZE seq numbers (one bit each, 128 byte per
+// target). the window's right edge is the highest seq number seen so far :
+// a new highest seq slides the window forward, clearing the bits it passes.
+// seq numbers are compared modulo 2^16 (e.g. 3 comes 'after' 65533), so this
+// keeps working after icmp_seq wraps around. no allocation after
+// construction, and O(1) per reply in steady state.
+class SeqWindow {
+
+    public:
+
+        SeqWindow();
+        ~SeqWindow() {}
+
+        // classifies a reply w/ seq number seq, which took rtt_nsec to 
+        // arrive, and updates the counters
+        int classify(uint16_t seq, int64_t rtt_nsec, int64_t timeout_nsec);
+
+        uint64_t get_on_time() { return on_time; }
+        uint64_t get_late() { return late; }
+        uint64_t get_duplicates() { return duplicates; }
+        uint64_t get_reordered() { return reordered; }
+
+    private:
+
+        bool started;
+        // highest seq number seen so far (modulo 2^16)
+        uint16_t max_seq;
+        // bit (seq % SEQ_WINDOW_SIZE) is set if seq has been received
+        uint64_t bitmap[SEQ_WINDOW_WORDS];
+
+        uint64_t on_time;
+        uint64_t late;
+        uint64_t duplicates;
+        uint64_t reordered;
+
+        bool test_and_set(uint16_t seq);
+        void clear(uint16_t seq);
+};
+
+#endif
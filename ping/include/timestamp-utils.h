@@ -0,0 +1,103 @@
+#ifndef TIMESTAMP_UTILS_H
+#define TIMESTAMP_UTILS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <vector>
+
+// nr. of tx timestamps kept per target (indexed by seq % TX_TS_SLOTS). a tx
+// timestamp only has to live until the respective reply arrives, so this
+// only needs to cover the nr. of echo requests in flight per target.
+#define TX_TS_SLOTS     16
+
+// kernel timestamps of a single packet. the software timestamp is on
+// CLOCK_REALTIME. the hardware one is taken by the nic, on the nic's own
+// clock : it can only be compared w/ other hardware timestamps.
+struct pckt_timestamps {
+    struct timespec sw;
+    struct timespec hw;
+    bool has_sw;
+    bool has_hw;
+};
+
+// helpers for kernel timestamping of packets. w/ SO_TIMESTAMPNS set on a
+// socket, the kernel records the time at which each packet was received
+// (when the packet hit the socket layer, not when our recvmsg() returned),
+// and hands it to us as a SCM_TIMESTAMPNS control message (cmsg) in the
+// msghdr's ancillary data. the timestamp is a struct timespec on
+// CLOCK_REALTIME, i.e. comparable to clock_gettime(CLOCK_REALTIME).
+//
+// tx timestamps work differently : w/ SO_TIMESTAMPING, the kernel takes a
+// timestamp when the packet is handed to the device (software) or when the
+// nic puts it on the wire (hardware), and queues a copy of the packet plus
+// a SCM_TIMESTAMPING cmsg on the socket's error queue, to be read w/
+// recvmsg(MSG_ERRQUEUE).
+class TimestampUtils {
+
+    public:
+
+        TimestampUtils() {}
+        ~TimestampUtils() {}
+
+        // sets SO_TIMESTAMPNS on socket_fd. returns 0 on success, -1 
+        // otherwise.
+        static int enable_rx_timestamps(int socket_fd);
+
+        // sets SO_TIMESTAMPING on socket_fd, requesting software tx 
+        // timestamps and, if hardware is true, hardware tx and rx timestamps 
+        // too (these only show up if the nic supports them and hardware 
+        // timestamping has been enabled on it, e.g. w/ hwstamp_ctl). 
+        // returns 0 on success, -1 otherwise.
+        static int enable_tx_timestamps(int socket_fd, bool hardware);
+
+        // extracts all kernel timestamps from msg's ancillary data (both 
+        // SCM_TIMESTAMPNS and SCM_TIMESTAMPING). returns 0 if at least one 
+        // was found, -1 otherwise.
+        static int get_pckt_timestamps(struct msghdr * msg, struct pckt_timestamps * ts);
+
+        // reads one tx timestamp from socket_fd's error queue, w/o blocking. 
+        // the copy of the sent packet is placed in buffer. returns the nr. of 
+        // bytes in buffer, -1 if the error queue is empty (errno = EAGAIN) or 
+        // on error.
+        static int read_tx_timestamp(
+            int socket_fd, 
+            char * buffer, int buffer_len, 
+            struct pckt_timestamps * ts);
+
+        // a - b, in nanoseconds
+        static int64_t ts_sub_nsec(const struct timespec * a, const struct timespec * b);
+
+        static double nsec_to_msec(int64_t nsec) { return nsec / 1000000.0; }
+};
+
+// tx timestamps of the echo requests in flight, per target. tx timestamps 
+// are read from the error queue shortly after each send, and looked up when 
+// the respective reply arrives : rtt = rx timestamp - tx timestamp.
+class TxTimestampTable {
+
+    public:
+
+        TxTimestampTable(size_t nr_targets);
+        ~TxTimestampTable() {}
+
+        void put(size_t target_index, uint16_t seq, const struct pckt_timestamps * ts);
+
+        // returns 0 and fills ts if there's a tx timestamp for (target, seq), 
+        // -1 otherwise (e.g. it was never read, or overwritten by a later seq)
+        int get(size_t target_index, uint16_t seq, struct pckt_timestamps * ts);
+
+    private:
+
+        struct tx_slot {
+            uint16_t seq;
+            bool valid;
+            struct pckt_timestamps ts;
+        };
+
+        std::vector<struct tx_slot> slots;
+};
+
+#endif
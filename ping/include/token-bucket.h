@@ -0,0 +1,39 @@
+#ifndef TOKEN_BUCKET_H
+#define TOKEN_BUCKET_H
+
+#include <stdint.h>
+#include <time.h>
+
+// a token bucket, for a global packet rate limit : tokens accrue at 'rate'
+// per second (on CLOCK_MONOTONIC), up to 'burst' of them, and each packet
+// sent takes one. the bucket only moves when refill() is called, so there's
+// no timer of its own : the caller polls it (e.g. from a periodic timerfd).
+class TokenBucket {
+
+    public:
+
+        // rate : tokens per second, 0 for no limit
+        // burst : max. nr. of tokens kept, i.e. the largest burst allowed
+        TokenBucket(uint64_t rate, uint64_t burst);
+        ~TokenBucket() {}
+
+        // adds the tokens accrued since the last call, and returns the nr.
+        // of whole tokens available. w/o a limit, that's always 'burst'.
+        uint64_t refill();
+
+        // takes n tokens (n <= what refill() returned)
+        void consume(uint64_t n);
+
+        uint64_t get_rate() { return rate; }
+
+    private:
+
+        uint64_t rate;
+        uint64_t burst;
+        // in 'token-nanoseconds' (i.e. tokens * 10^9), so that fractions of
+        // a token carry over from one refill() to the next
+        uint64_t tokens;
+        struct timespec last;
+};
+
+#endif
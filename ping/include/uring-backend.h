@@ -0,0 +1,141 @@
+#ifndef URING_BACKEND_H
+#define URING_BACKEND_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <vector>
+
+#include <netinet/in.h>
+#include <linux/io_uring.h>
+
+// nr. of submission queue entries. the completion queue gets 4x as many,
+// since a single multishot receive posts many completions.
+#define URING_ENTRIES           256
+// nr. of send buffers (i.e. max. nr. of sends in flight)
+#define URING_SEND_SLOTS        256
+// an echo request is 64 byte, this leaves plenty of room
+#define URING_SEND_BUFFER_SIZE  128
+// nr. of buffers handed to the kernel for receives (a power of 2)
+#define URING_RECV_BUFFERS      256
+// each receive buffer holds a struct io_uring_recvmsg_out, the source
+// address, the ancillary data and the packet itself
+#define URING_RECV_BUFFER_SIZE  2048
+#define URING_RECV_CTRL_SIZE    256
+
+// called for every packet received. msg is laid out like a msghdr filled by
+// recvmsg() (a single iovec w/ the packet, source address, ancillary data),
+// and is only valid during the call.
+typedef void (*uring_recv_handler)(struct msghdr * msg, int len, void * arg);
+
+// an io_uring based send and receive path for a (raw) socket, talking to the
+// kernel w/ the io_uring_setup(), io_uring_enter() and io_uring_register()
+// syscalls directly (i.e. w/o liburing). the idea:
+//  -# receives : a single multishot IORING_OP_RECVMSG stays armed on the
+//     socket, and posts a completion per packet. packets land in buffers
+//     handed to the kernel beforehand (IORING_OP_PROVIDE_BUFFERS), which we
+//     hand back after processing. no syscall per packet.
+//  -# sends : echo requests are copied into preallocated send slots and
+//     queued as IORING_OP_SENDMSG entries, and a whole batch (e.g. a round
+//     of echo requests to all targets) is submitted w/ a single
+//     io_uring_enter().
+//  -# completions are signalled through an eventfd, so that the ring can
+//     be watched by an EventLoop, next to timers and signals.
+class UringBackend {
+
+    public:
+
+        // handler is called (w/ handler_arg) for each packet received
+        UringBackend(int socket_fd, uring_recv_handler handler, void * handler_arg);
+        ~UringBackend();
+
+        // sets up the ring, registers the receive buffers and the eventfd,
+        // and arms the multishot receive. returns 0 on success, -1 if
+        // io_uring can't be used (e.g. old kernel, or disabled by
+        // kernel.io_uring_disabled), in which case the caller should fall
+        // back to plain syscalls.
+        int init();
+
+        // readable whenever completions are posted
+        int get_event_fd() { return event_fd; }
+
+        // copies pckt into a free send slot, and queues a sendmsg() to addr.
+        // nothing is sent until submit(). if all slots are in flight,
+        // submits and waits for (and reaps) completions first. returns 0 on
+        // success, -1 on error.
+        int queue_send(const void * pckt, int len, const struct sockaddr_in * addr);
+
+        int get_free_send_slots() { return (int) free_slots.size(); }
+
+        // submits all queued entries w/ a single io_uring_enter(). returns
+        // the nr. of entries submitted, -1 on error.
+        int submit();
+
+        // processes all posted completions : received packets are passed to
+        // the handler (and their buffers recycled), send slots are freed,
+        // and the multishot receive is re-armed if the kernel ended it.
+        // returns the nr. of completions, -1 on error.
+        int reap();
+
+        uint64_t get_nr_sent() { return nr_sent; }
+        uint64_t get_nr_received() { return nr_received; }
+        uint64_t get_nr_enters() { return nr_enters; }
+
+    private:
+
+        struct io_uring_sqe * get_sqe();
+        int enter(unsigned int nr_submit, unsigned int min_complete, unsigned int flags);
+        int arm_recv();
+        int provide_recv_buffers(uint16_t bid, int nr_buffers);
+        int recycle_recv_buffer(uint16_t bid);
+
+        int socket_fd;
+        uring_recv_handler handler;
+        void * handler_arg;
+
+        int ring_fd;
+        int event_fd;
+
+        // the mmap()ed rings and their sizes
+        void * sq_ptr;
+        size_t sq_size;
+        void * cq_ptr;
+        size_t cq_size;
+        struct io_uring_sqe * sqes;
+        size_t sqes_size;
+
+        // pointers into the shared rings (see io_uring_setup(2))
+        unsigned * sq_head;
+        unsigned * sq_tail;
+        unsigned * sq_array;
+        unsigned sq_mask;
+        unsigned sq_entries;
+        unsigned * cq_head;
+        unsigned * cq_tail;
+        unsigned cq_mask;
+        struct io_uring_cqe * cqes;
+
+        // sq entries filled but not yet handed to the kernel
+        unsigned sq_local_tail;
+        unsigned to_submit;
+
+        // provided buffers for receives
+        char * recv_buffers;
+        // describes the layout of the receive buffers to the kernel (only
+        // msg_namelen and msg_controllen matter)
+        struct msghdr recv_msg;
+
+        // send slots
+        char * send_buffers;
+        struct sockaddr_in * send_addrs;
+        struct iovec * send_iovecs;
+        struct msghdr * send_msgs;
+        std::vector<int> free_slots;
+
+        uint64_t nr_sent;
+        uint64_t nr_received;
+        uint64_t nr_enters;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include <vector>
+
+#include "cyclic-permutation.h"
+
+CyclicPermutation::CyclicPermutation(uint64_t n)
+    : n(n), done(false), rng(std::random_device()()) {
+
+    // 2 is the smallest prime we'd get anyway, and Z*_2 = {1}
+    prime = (n < 2 ? 2 : n + 1);
+
+    while (!is_prime(prime))
+        prime++;
+
+    // a random element of Z*_p is a generator w/ probability phi(p - 1) /
+    // (p - 1), which is never too small : a handful of tries is enough
+    std::uniform_int_distribution<uint64_t> element(1, prime - 1);
+
+    if (prime == 2) {
+
+        generator = 1;
+
+    } else {
+
+        do {
+            generator = element(rng);
+        } while (!is_generator(generator));
+    }
+
+    first = element(rng);
+    current = first;
+
+    if (n == 0)
+        done = true;
+}
+
+bool CyclicPermutation::next(uint64_t & index) {
+
+    while (!done) {
+
+        uint64_t x = current;
+
+        current = mul_mod(current, generator, prime);
+
+        // back to the start : the whole group has been visited
+        if (current == first)
+            done = true;
+
+        if (x - 1 < n) {
+            index = x - 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool CyclicPermutation::is_prime(uint64_t x) {
+
+    if (x < 2)
+        return false;
+
+    if (x % 2 == 0)
+        return (x == 2);
+
+    // trial division is quick enough for x < 2^33 (at most 2^16 odd divisors)
+    for (uint64_t d = 3; d * d <= x; d += 2) {
+        if (x % d == 0)
+            return false;
+    }
+
+    return true;
+}
+
+uint64_t CyclicPermutation::mul_mod(uint64_t a, uint64_t b, uint64_t m) {
+
+    // p may be a bit over 2^32, so the product needs more than 64 bit
+    return (uint64_t) (((unsigned __int128) a * b) % m);
+}
+
+uint64_t CyclicPermutation::pow_mod(uint64_t base, uint64_t exp, uint64_t m) {
+
+    uint64_t result = 1;
+    base %= m;
+
+    while (exp > 0) {
+
+        if (exp & 1)
+            result = mul_mod(result, base, m);
+
+        base = mul_mod(base, base, m);
+        exp >>= 1;
+    }
+
+    return result;
+}
+
+bool CyclicPermutation::is_generator(uint64_t g) {
+
+    // g generates Z*_p iff g^((p - 1) / q) != 1 (mod p) for every prime
+    // factor q of p - 1, the order of the group
+    uint64_t order = prime - 1;
+    uint64_t rest = order;
+    std::vector<uint64_t> factors;
+
+    for (uint64_t q = 2; q * q <= rest; q++) {
+
+        if (rest % q == 0) {
+
+            factors.push_back(q);
+
+            while (rest % q == 0)
+                rest /= q;
+        }
+    }
+
+    if (rest > 1)
+        factors.push_back(rest);
+
+    for (size_t i = 0; i < factors.size(); i++) {
+        if (pow_mod(g, order / factors[i], prime) == 1)
+            return false;
+    }
+
+    return true;
+}
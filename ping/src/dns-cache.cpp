@@ -0,0 +1,132 @@
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netdb.h>              // getnameinfo()
+
+#include "dns-cache.h"
+
+DnsCache::DnsCache(size_t capacity)
+    : capacity(capacity), stop(false) {
+
+    resolver = std::thread(&DnsCache::resolve_loop, this);
+}
+
+DnsCache::~DnsCache() {
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+
+    has_pending.notify_one();
+    // note that this waits for an in-flight getnameinfo() to return
+    resolver.join();
+}
+
+bool DnsCache::lookup(struct in_addr addr, char * name, size_t name_len) {
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = entries.find(addr.s_addr);
+
+    if (it != entries.end()) {
+
+        // a hit : move the entry to the front of the lru list (splice() 
+        // only relinks the list node, so iterators stay valid)
+        lru.splice(lru.begin(), lru, it->second);
+
+        if (!it->second->resolved)
+            return false;
+
+        strncpy(name, it->second->name, name_len - 1);
+        name[name_len - 1] = '\0';
+
+        return true;
+    }
+
+    // a miss : queue the address for the resolver thread, unless too many 
+    // are waiting already
+    if (pending.size() >= DNS_MAX_PENDING)
+        return false;
+
+    // evict the least recently used entry if the cache is full
+    if (entries.size() >= capacity) {
+
+        entries.erase(lru.back().addr);
+        lru.pop_back();
+    }
+
+    struct dns_entry entry;
+    entry.addr = addr.s_addr;
+    entry.resolved = false;
+    entry.name[0] = '\0';
+
+    lru.push_front(entry);
+    entries[addr.s_addr] = lru.begin();
+    pending.push_back(addr.s_addr);
+
+    has_pending.notify_one();
+
+    return false;
+}
+
+void DnsCache::resolve_loop() {
+
+    // SIGINT and SIGTERM are read from pingy's signalfd (see event-loop.h), 
+    // which only works if no thread lets them through
+    sigset_t exit_set;
+    sigemptyset(&exit_set);
+    sigaddset(&exit_set, SIGINT);
+    sigaddset(&exit_set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &exit_set, NULL);
+
+    while (1) {
+
+        uint32_t addr = 0;
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            has_pending.wait(guard, [this] { return stop || !pending.empty(); });
+
+            if (stop)
+                return;
+
+            addr = pending.front();
+            pending.pop_front();
+        }
+
+        // the (possibly slow) network lookup happens w/o holding the lock
+        struct sockaddr_in sin;
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_addr.s_addr = addr;
+
+        char name[DNS_MAX_NAME_SIZE] = "";
+
+        // NI_NAMEREQD makes getnameinfo() fail if there's no reverse mapping, 
+        // in which case we keep the dotted-decimal string
+        if (getnameinfo(
+                (struct sockaddr *) &sin, sizeof(sin), 
+                name, sizeof(name), NULL, 0, NI_NAMEREQD) != 0) {
+
+            inet_ntop(AF_INET, &sin.sin_addr, name, sizeof(name));
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            // the entry may have been evicted while we were resolving it
+            auto it = entries.find(addr);
+
+            if (it != entries.end()) {
+
+                strncpy(it->second->name, name, DNS_MAX_NAME_SIZE - 1);
+                it->second->name[DNS_MAX_NAME_SIZE - 1] = '\0';
+                it->second->resolved = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <iostream>
+
+#include "echo-burst.h"
+
+// sum of the 16 bit words in [addr, addr + len), w/o folding the carries. len
+// must be even (it always is for the fields we sum here).
+static uint32_t sum_words(uint16_t * addr, int len) {
+
+    uint32_t sum = 0;
+
+    for (int i = 0; i < (len >> 1); i++)
+        sum += addr[i];
+
+    return sum;
+}
+
+EchoBurst::EchoBurst(int burst_size, struct icmp * icmp_template, int pckt_len)
+    : burst_size(burst_size), pckt_len(pckt_len), next_unsent(0), 
+    timeouts(NULL), timeout_nsec(0), nr_bursts(0), nr_sent(0) {
+
+    pckts = new char[burst_size * pckt_len];
+    iovecs = new struct iovec[burst_size];
+    msgs = new struct mmsghdr[burst_size];
+
+    memset(msgs, 0, burst_size * sizeof(struct mmsghdr));
+
+    // copy the template into every slot, and wire each msghdr to its slot. 
+    // the destination address (msg_name) is set per packet in send().
+    for (int i = 0; i < burst_size; i++) {
+
+        char * pckt = pckts + (i * pckt_len);
+        memcpy(pckt, icmp_template, pckt_len);
+
+        iovecs[i].iov_base = pckt;
+        iovecs[i].iov_len = pckt_len;
+
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+
+    // the constant part of the checksum: zero the fields which change per 
+    // packet in a scratch copy of the template, and sum the rest
+    char * scratch = new char[pckt_len];
+    memcpy(scratch, icmp_template, pckt_len);
+
+    struct icmp * icmp_pckt = (struct icmp *) scratch;
+    icmp_pckt->icmp_cksum = 0;
+    icmp_pckt->icmp_id = 0;
+    icmp_pckt->icmp_seq = 0;
+    memset(icmp_pckt->icmp_data, 0, sizeof(struct echo_payload));
+
+    template_sum = sum_words((uint16_t *) scratch, pckt_len);
+
+    delete [] scratch;
+}
+
+EchoBurst::~EchoBurst() {
+
+    delete [] pckts;
+    delete [] iovecs;
+    delete [] msgs;
+}
+
+int EchoBurst::send(int socket_fd, TargetTable * targets, size_t & next_target) {
+
+    // the previous burst was cut short : its packets already count as sent 
+    // (targets' seq numbers and counters were bumped), so they must go out 
+    // before any new ones. their timestamps are a bit old by now, which only 
+    // matters when the send buffer is full, i.e. when flooding anyway.
+    if (next_unsent > 0)
+        return send_pending(socket_fd);
+
+    // all packets in a burst leave w/ the same sendmmsg() call, so a single 
+    // send timestamp is taken for the whole burst
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    for (int i = 0; i < burst_size; i++) {
+
+        struct ping_target * target = targets->get(next_target);
+        next_target = (next_target + 1) % targets->size();
+
+        struct icmp * icmp_pckt = (struct icmp *) (pckts + (i * pckt_len));
+
+        icmp_pckt->icmp_id = htons(target->id);
+        icmp_pckt->icmp_seq = htons(target->next_seq);
+
+        struct echo_payload payload;
+        payload.timestamp = now;
+        payload.timer = TIMER_NONE;
+
+        if (timeouts != NULL) {
+            payload.timer = timeouts->insert(
+                timeout_nsec, ((uint64_t) target->index << 16) | target->next_seq);
+        }
+
+        memcpy(icmp_pckt->icmp_data, &payload, sizeof(payload));
+
+        target->next_seq++;
+        target->sent++;
+
+        // template sum + the words which changed, then fold the carries back 
+        // into the lower 16 bits (twice, since the 1st fold may carry again)
+        uint32_t sum = template_sum 
+            + icmp_pckt->icmp_id + icmp_pckt->icmp_seq
+            + sum_words((uint16_t *) icmp_pckt->icmp_data, sizeof(struct echo_payload));
+        sum = (sum >> 16) + (sum & 0xffff);
+        sum += (sum >> 16);
+        icmp_pckt->icmp_cksum = (uint16_t) ~sum;
+
+        msgs[i].msg_hdr.msg_name = &target->addr;
+    }
+
+    return send_pending(socket_fd);
+}
+
+int EchoBurst::send_pending(int socket_fd) {
+
+    // sendmmsg() may send fewer packets than asked for (e.g. if interrupted), 
+    // in which case we carry on w/ the remaining ones
+    int sent = 0;
+
+    while (next_unsent < burst_size) {
+
+        int rc = sendmmsg(socket_fd, msgs + next_unsent, burst_size - next_unsent, 0);
+
+        if (rc < 0) {
+
+            if (errno == EINTR)
+                continue;
+
+            // send buffer full : keep the rest for the next call
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            std::cerr << "echo-burst::send() : [ERROR] error in sendmmsg(): " 
+                << strerror(errno) << std::endl;
+
+            // drop the rest of the burst, so that we don't retry it forever
+            next_unsent = 0;
+            nr_bursts++;
+            nr_sent += sent;
+
+            return (sent > 0 ? sent : -1);
+        }
+
+        next_unsent += rc;
+        sent += rc;
+    }
+
+    if (next_unsent >= burst_size) {
+
+        next_unsent = 0;
+        nr_bursts++;
+    }
+
+    nr_sent += sent;
+
+    return sent;
+}
@@ -0,0 +1,185 @@
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include <iostream>
+
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+
+#include "event-loop.h"
+
+EventLoop::EventLoop() {
+
+    if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+
+        std::cerr << "event-loop::EventLoop() : [ERROR] error in epoll_create1(): "
+            << strerror(errno) << std::endl;
+    }
+}
+
+EventLoop::~EventLoop() {
+
+    for (size_t i = 0; i < owned_fds.size(); i++)
+        close(owned_fds[i]);
+
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+}
+
+int EventLoop::add_fd(int fd, uint32_t events) {
+
+    // the fd itself is all we need to tell events apart
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+
+        std::cerr << "event-loop::add_fd() : [ERROR] error in epoll_ctl(): "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int EventLoop::mod_fd(int fd, uint32_t events) {
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+
+        std::cerr << "event-loop::mod_fd() : [ERROR] error in epoll_ctl(): "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int EventLoop::add_timer() {
+
+    // CLOCK_MONOTONIC, the clock ProbeScheduler's deadlines are on
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (timer_fd < 0) {
+
+        std::cerr << "event-loop::add_timer() : [ERROR] error in timerfd_create(): "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    owned_fds.push_back(timer_fd);
+
+    if (add_fd(timer_fd, EPOLLIN) < 0)
+        return -1;
+
+    return timer_fd;
+}
+
+int EventLoop::add_signals(const int * signos, int nr_signos) {
+
+    sigset_t mask;
+    sigemptyset(&mask);
+
+    for (int i = 0; i < nr_signos; i++)
+        sigaddset(&mask, signos[i]);
+
+    // signals are only queued for the signalfd if they're blocked
+    if (pthread_sigmask(SIG_BLOCK, &mask, NULL) != 0) {
+
+        std::cerr << "event-loop::add_signals() : [ERROR] error blocking "\
+            "signals." << std::endl;
+
+        return -1;
+    }
+
+    int signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (signal_fd < 0) {
+
+        std::cerr << "event-loop::add_signals() : [ERROR] error in signalfd(): "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    owned_fds.push_back(signal_fd);
+
+    if (add_fd(signal_fd, EPOLLIN) < 0)
+        return -1;
+
+    return signal_fd;
+}
+
+int EventLoop::wait(struct epoll_event * events, int max_events, int timeout_ms) {
+
+    int nr_events = epoll_wait(epoll_fd, events, max_events, timeout_ms);
+
+    if (nr_events < 0) {
+
+        // e.g. SIGSTOP + SIGCONT. not an error, just try again.
+        if (errno == EINTR)
+            return 0;
+
+        std::cerr << "event-loop::wait() : [ERROR] error in epoll_wait(): "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return nr_events;
+}
+
+int EventLoop::arm_timer(int timer_fd, const struct timespec & deadline, uint64_t period_usec) {
+
+    struct itimerspec spec;
+    spec.it_value = deadline;
+    spec.it_interval.tv_sec = period_usec / 1000000;
+    spec.it_interval.tv_nsec = (period_usec % 1000000) * 1000;
+
+    // an all-zero it_value would disarm the timer instead. that's never a
+    // valid CLOCK_MONOTONIC deadline anyway, but play it safe.
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+        spec.it_value.tv_nsec = 1;
+
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+
+        std::cerr << "event-loop::arm_timer() : [ERROR] error in timerfd_settime(): "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+uint64_t EventLoop::read_timer(int timer_fd) {
+
+    uint64_t expirations = 0;
+
+    if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return 0;
+
+    return expirations;
+}
+
+int EventLoop::read_signal(int signal_fd) {
+
+    struct signalfd_siginfo info;
+
+    if (read(signal_fd, &info, sizeof(info)) != sizeof(info))
+        return 0;
+
+    return (int) info.ssi_signo;
+}
@@ -0,0 +1,153 @@
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <linux/filter.h>       // struct sock_filter, BPF_* macros
+#include <linux/if_packet.h>    // PACKET_OUTGOING
+
+#include "icmp-filter.h"
+
+int ICMPFilter::attach_echo_filter(
+    int socket_fd, 
+    uint16_t id_base, 
+    uint32_t nr_ids, 
+    int32_t net_off) {
+
+    // on a raw ipv4 socket, the filter sees the packet from the ip header 
+    // onwards, and net_off is 0. on a packet socket, it sees the link layer 
+    // header first : w/ net_off = SKF_NET_OFF, loads are relative to the 
+    // network header instead, whatever the link layer (ethernet, loopback, 
+    // tun, ...). loads beyond the end of the packet make the program return 
+    // 0 (i.e. drop), so truncated packets are taken care of. the identifier 
+    // check is the same for replies and quoted requests :
+    //  (id - id_base) & 0xffff < nr_ids
+    // which handles the id range wrapping around 2^16.
+    //
+    // jump offsets (the 3rd and 4th args of BPF_JUMP) are relative to the 
+    // next instruction. the labels on the right are instruction indexes.
+    struct sock_filter code[] = {
+        // packets we send show up on packet sockets too (PACKET_OUTGOING). 
+        // on loopback, that means every reply would be seen twice.
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, (uint32_t) (SKF_AD_OFF + SKF_AD_PKTTYPE)),  // 0
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PACKET_OUTGOING, 28, 0),        // 1 : -> 30
+        // a packet socket gets all ipv4 packets, not just icmp
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, (uint32_t) (net_off + 9)),       // 2
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_ICMP, 0, 26),           // 3 : -> 30
+
+        // X <- 4 * (ip[0] & 0xf), the outer ip header length
+        BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, (uint32_t) net_off),            // 4
+        // A <- icmp type
+        BPF_STMT(BPF_LD | BPF_B | BPF_IND, (uint32_t) net_off),             // 5
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_ECHOREPLY, 4, 0),          // 6 : -> 11
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_DEST_UNREACH, 7, 0),       // 7 : -> 15
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_TIME_EXCEEDED, 6, 0),      // 8 : -> 15
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_PARAMETERPROB, 5, 0),      // 9 : -> 15
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_SOURCE_QUENCH, 4, 19),     // 10 : -> 15, 30
+
+        // echo reply : A <- icmp id, then the range check
+        BPF_STMT(BPF_LD | BPF_H | BPF_IND, (uint32_t) (net_off + 4)),       // 11
+        BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, id_base),                       // 12
+        BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xffff),                        // 13
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, nr_ids, 15, 14),                // 14 : -> 30, 29
+
+        // icmp error : the quoted ip header starts 8 byte into the icmp 
+        // message. its protocol field (9 byte in) must be icmp.
+        BPF_STMT(BPF_LD | BPF_B | BPF_IND, (uint32_t) (net_off + 8 + 9)),   // 15
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_ICMP, 0, 13),           // 16 : -> 30
+        // X <- X + 8 + quoted ip header length, i.e. the offset of the 
+        // quoted icmp header
+        BPF_STMT(BPF_LD | BPF_B | BPF_IND, (uint32_t) (net_off + 8)),       // 17
+        BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf),                           // 18
+        BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 2),                             // 19
+        BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),                             // 20
+        BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 8),                             // 21
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),                                    // 22
+        // the quoted packet must be an echo request w/ one of our ids
+        BPF_STMT(BPF_LD | BPF_B | BPF_IND, (uint32_t) net_off),             // 23
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_ECHO, 0, 5),               // 24 : -> 30
+        BPF_STMT(BPF_LD | BPF_H | BPF_IND, (uint32_t) (net_off + 4)),       // 25
+        BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, id_base),                       // 26
+        BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xffff),                        // 27
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, nr_ids, 1, 0),                  // 28 : -> 30, 29
+
+        // accept (the whole packet) / drop
+        BPF_STMT(BPF_RET | BPF_K, 0xffffffff),                              // 29
+        BPF_STMT(BPF_RET | BPF_K, 0),                                       // 30
+    };
+
+    struct sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+
+        std::cerr << "icmp-filter::attach_echo_filter() : [ERROR] error attaching "\
+            "filter: " << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int ICMPFilter::attach_drop_filter(int socket_fd) {
+
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+
+    struct sock_fprog prog;
+    prog.len = 1;
+    prog.filter = code;
+
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+
+        std::cerr << "icmp-filter::attach_drop_filter() : [ERROR] error attaching "\
+            "filter: " << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int ICMPFilter::get_icmp_in_msgs(uint64_t & in_msgs) {
+
+    // /proc/net/snmp has pairs of lines per protocol : a header line w/ the 
+    // field names, and a line w/ the values, e.g. :
+    //  Icmp: InMsgs InErrors ...
+    //  Icmp: 2078594 0 ...
+    std::ifstream snmp("/proc/net/snmp");
+    std::string header, values;
+
+    if (!snmp.is_open())
+        return -1;
+
+    while (std::getline(snmp, header) && std::getline(snmp, values)) {
+
+        if (header.compare(0, 5, "Icmp:") != 0)
+            continue;
+
+        std::istringstream names(header), nrs(values);
+        std::string name, nr;
+
+        while ((names >> name) && (nrs >> nr)) {
+
+            if (name == "InMsgs") {
+
+                in_msgs = strtoull(nr.c_str(), NULL, 10);
+                return 0;
+            }
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,476 @@
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <random>
+
+#include <arpa/inet.h>
+#include <sys/random.h>         // getrandom()
+
+#include "icmp-sweep.h"
+#include "icmp-utils.h"
+#include "timestamp-utils.h"
+
+// at most this many excluded addresses are skipped per send() call, so that
+// a large exclusion doesn't hold up the event loop : the rest are skipped by
+// the following calls
+#define SWEEP_MAX_SKIP      65536
+
+IcmpSweep::IcmpSweep(int batch_size)
+    : range_first(0), range_size(0), permutation(NULL), exhausted(false),
+      batch_size(batch_size), pckt_len(8 + SWEEP_DATA_LEN), nr_built(0), next_unsent(0),
+      nr_sent(0), nr_excluded(0), nr_alive(0), nr_duplicates(0), nr_unreachable(0),
+      nr_invalid(0) {
+
+    pckts = new char[batch_size * pckt_len];
+    addrs = new struct sockaddr_in[batch_size];
+    iovecs = new struct iovec[batch_size];
+    msgs = new struct mmsghdr[batch_size];
+
+    memset(pckts, 0, batch_size * pckt_len);
+    memset(addrs, 0, batch_size * sizeof(struct sockaddr_in));
+    memset(msgs, 0, batch_size * sizeof(struct mmsghdr));
+
+    // as in EchoBurst, each slot is wired to its packet and address once.
+    // only the cookie, timestamp, checksum and destination change.
+    for (int i = 0; i < batch_size; i++) {
+
+        struct icmp * icmp_pckt = (struct icmp *) (pckts + (i * pckt_len));
+        icmp_pckt->icmp_type = ICMP_ECHO;
+        icmp_pckt->icmp_code = 0;
+
+        addrs[i].sin_family = AF_INET;
+
+        iovecs[i].iov_base = icmp_pckt;
+        iovecs[i].iov_len = pckt_len;
+
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+IcmpSweep::~IcmpSweep() {
+
+    delete permutation;
+    delete [] pckts;
+    delete [] addrs;
+    delete [] iovecs;
+    delete [] msgs;
+}
+
+int IcmpSweep::parse_cidr(const char * cidr, uint32_t & first, uint64_t & size) {
+
+    std::string str(cidr);
+    int prefix = 32;
+    size_t slash = str.find('/');
+
+    if (slash != std::string::npos) {
+
+        char * end = NULL;
+        prefix = (int) strtol(str.c_str() + slash + 1, &end, 10);
+
+        if (end == str.c_str() + slash + 1 || *end != '\0' || prefix < 0 || prefix > 32) {
+
+            std::cerr << "icmp-sweep::parse_cidr() : [ERROR] invalid prefix "\
+                "length in " << cidr << std::endl;
+
+            return -1;
+        }
+
+        str = str.substr(0, slash);
+    }
+
+    struct in_addr addr;
+
+    if (inet_pton(AF_INET, str.c_str(), &addr) != 1) {
+
+        std::cerr << "icmp-sweep::parse_cidr() : [ERROR] invalid address in "
+            << cidr << std::endl;
+
+        return -1;
+    }
+
+    // host bits set in the address (e.g. 10.0.0.1/16) are ignored
+    uint32_t mask = (prefix == 0 ? 0 : ~((1ULL << (32 - prefix)) - 1));
+    first = ntohl(addr.s_addr) & mask;
+    size = 1ULL << (32 - prefix);
+
+    return 0;
+}
+
+int IcmpSweep::set_range(const char * cidr) {
+
+    return parse_cidr(cidr, range_first, range_size);
+}
+
+int IcmpSweep::add_exclusion(const char * cidr) {
+
+    uint32_t first = 0;
+    uint64_t size = 0;
+
+    if (parse_cidr(cidr, first, size) < 0)
+        return -1;
+
+    exclusions.push_back(std::make_pair(first, (uint32_t) (first + size - 1)));
+
+    return 0;
+}
+
+int IcmpSweep::load_exclusions(const char * filename) {
+
+    std::ifstream file(filename);
+
+    if (!file.is_open()) {
+
+        std::cerr << "icmp-sweep::load_exclusions() : [ERROR] could not open "\
+            "exclusion file " << filename << std::endl;
+
+        return -1;
+    }
+
+    int added = 0;
+    std::string line;
+
+    while (std::getline(file, line)) {
+
+        // drop comments, then trim leading and trailing whitespace
+        line = line.substr(0, line.find('#'));
+
+        size_t start = line.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos)
+            continue;
+        size_t end = line.find_last_not_of(" \t\r\n");
+        line = line.substr(start, end - start + 1);
+
+        if (add_exclusion(line.c_str()) == 0)
+            added++;
+    }
+
+    return added;
+}
+
+int IcmpSweep::start() {
+
+    if (range_size == 0) {
+
+        std::cerr << "icmp-sweep::start() : [ERROR] no range to sweep." << std::endl;
+        return -1;
+    }
+
+    // sort the exclusions by their 1st address, and merge those which
+    // overlap (or touch), so that is_excluded() is a single binary search
+    std::sort(exclusions.begin(), exclusions.end());
+
+    std::vector< std::pair<uint32_t, uint32_t> > merged;
+
+    for (size_t i = 0; i < exclusions.size(); i++) {
+
+        if (!merged.empty() && (uint64_t) exclusions[i].first <= (uint64_t) merged.back().second + 1)
+            merged.back().second = std::max(merged.back().second, exclusions[i].second);
+        else
+            merged.push_back(exclusions[i]);
+    }
+
+    exclusions.swap(merged);
+
+    // a new key per sweep : cookies can't be predicted (or replayed from an
+    // earlier sweep) by whoever sees our probes
+    if (getrandom(key, sizeof(key), 0) != sizeof(key)) {
+
+        std::random_device rd;
+        key[0] = ((uint64_t) rd() << 32) | rd();
+        key[1] = ((uint64_t) rd() << 32) | rd();
+    }
+
+    if (range_size <= SWEEP_MAX_DEDUP)
+        seen.assign((range_size + 7) / 8, 0);
+
+    permutation = new CyclicPermutation(range_size);
+    exhausted = false;
+
+    return 0;
+}
+
+#define ROTL(x, b) (uint64_t) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND                                        \
+    do {                                                \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0;          \
+        v0 = ROTL(v0, 32);                              \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2;          \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0;          \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2;          \
+        v2 = ROTL(v2, 32);                              \
+    } while (0)
+
+uint64_t IcmpSweep::get_cookie(uint32_t addr) {
+
+    // siphash-2-4 of a single 8 byte block (the address), i.e. 2 compression
+    // rounds for the block, 2 for the final (length only) block, and 4
+    // finalization rounds
+    uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+
+    uint64_t m = addr;
+    v3 ^= m;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= m;
+
+    uint64_t b = ((uint64_t) 8) << 56;
+    v3 ^= b;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+bool IcmpSweep::is_excluded(uint32_t addr) {
+
+    if (exclusions.empty())
+        return false;
+
+    // the last exclusion starting at or before addr
+    std::vector< std::pair<uint32_t, uint32_t> >::iterator it = std::upper_bound(
+        exclusions.begin(), exclusions.end(), std::make_pair(addr, (uint32_t) 0xffffffff));
+
+    if (it == exclusions.begin())
+        return false;
+
+    --it;
+
+    return (addr <= it->second);
+}
+
+bool IcmpSweep::check_seen(uint32_t addr) {
+
+    if (seen.empty())
+        return false;
+
+    uint64_t index = (uint64_t) (addr - range_first);
+    uint8_t bit = (uint8_t) (1 << (index & 7));
+
+    if (seen[index >> 3] & bit)
+        return true;
+
+    seen[index >> 3] |= bit;
+
+    return false;
+}
+
+int IcmpSweep::send(int socket_fd, int max) {
+
+    // the previous batch was cut short : send the rest first
+    if (next_unsent < nr_built)
+        return send_pending(socket_fd);
+
+    if (max > batch_size)
+        max = batch_size;
+
+    // all probes in a batch leave w/ the same sendmmsg() call, so they share
+    // a send time
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    nr_built = 0;
+    next_unsent = 0;
+    int skipped = 0;
+    uint64_t index = 0;
+
+    while (nr_built < max && skipped < SWEEP_MAX_SKIP) {
+
+        if (!permutation->next(index)) {
+            exhausted = true;
+            break;
+        }
+
+        uint32_t addr = range_first + (uint32_t) index;
+
+        if (is_excluded(addr)) {
+            nr_excluded++;
+            skipped++;
+            continue;
+        }
+
+        struct icmp * icmp_pckt = (struct icmp *) (pckts + (nr_built * pckt_len));
+
+        // the cookie's bytes are copied as they are : they're only ever
+        // compared w/ what comes back, never read as numbers
+        uint64_t cookie = get_cookie(addr);
+        memcpy(&icmp_pckt->icmp_id, &cookie, 4);
+        memcpy(icmp_pckt->icmp_data, ((char *) &cookie) + 4, 4);
+        memcpy(icmp_pckt->icmp_data + 4, &now, sizeof(now));
+
+        icmp_pckt->icmp_cksum = 0;
+        icmp_pckt->icmp_cksum = ICMPUtils::in_cksum((uint16_t *) icmp_pckt, pckt_len);
+
+        addrs[nr_built].sin_addr.s_addr = htonl(addr);
+        nr_built++;
+    }
+
+    if (nr_built == 0)
+        return 0;
+
+    return send_pending(socket_fd);
+}
+
+int IcmpSweep::send_pending(int socket_fd) {
+
+    int sent = 0;
+
+    while (next_unsent < nr_built) {
+
+        int rc = sendmmsg(socket_fd, msgs + next_unsent, nr_built - next_unsent, 0);
+
+        if (rc < 0) {
+
+            if (errno == EINTR)
+                continue;
+
+            // send buffer full : keep the rest for the next call
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            // e.g. EACCES for a broadcast address, or ENETUNREACH : skip
+            // the probe which failed, and carry on w/ the rest
+            if (errno == EACCES || errno == ENETUNREACH || errno == EHOSTUNREACH
+                || errno == EPERM || errno == EINVAL) {
+
+                next_unsent++;
+                continue;
+            }
+
+            std::cerr << "icmp-sweep::send() : [ERROR] error in sendmmsg(): "
+                << strerror(errno) << std::endl;
+
+            next_unsent = nr_built;
+            nr_sent += sent;
+
+            return (sent > 0 ? sent : -1);
+        }
+
+        next_unsent += rc;
+        sent += rc;
+    }
+
+    nr_sent += sent;
+
+    return sent;
+}
+
+int IcmpSweep::process_reply(
+    char * pckt, int len,
+    struct sockaddr_in * src,
+    const struct timespec * rx_ts,
+    bool quiet) {
+
+    if (len < (int) sizeof(struct ip))
+        return 0;
+
+    struct ip * ip_hdr = (struct ip *) pckt;
+    int ip_hdr_len = ip_hdr->ip_hl << 2;
+    int icmp_len = len - ip_hdr_len;
+
+    if (ip_hdr->ip_p != IPPROTO_ICMP || icmp_len < 8)
+        return 0;
+
+    struct icmp * icmp_hdr = (struct icmp *) (pckt + ip_hdr_len);
+    char src_addr[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &src->sin_addr, src_addr, sizeof(src_addr));
+
+    if (icmp_hdr->icmp_type == ICMP_ECHOREPLY) {
+
+        // the reply must echo back the whole cookie, and the send time.
+        // this also rules out replies to other ping processes.
+        uint32_t addr = ntohl(src->sin_addr.s_addr);
+        uint64_t cookie = get_cookie(addr);
+
+        if (icmp_len < 8 + SWEEP_DATA_LEN
+            || memcmp(&icmp_hdr->icmp_id, &cookie, 4) != 0
+            || memcmp(icmp_hdr->icmp_data, ((char *) &cookie) + 4, 4) != 0) {
+
+            nr_invalid++;
+            return 0;
+        }
+
+        if (check_seen(addr)) {
+            nr_duplicates++;
+            return 1;
+        }
+
+        nr_alive++;
+
+        if (!quiet) {
+
+            struct timespec sent;
+            memcpy(&sent, icmp_hdr->icmp_data + 4, sizeof(sent));
+
+            std::cout << src_addr << " : alive, ttl = " << (uint16_t) ip_hdr->ip_ttl
+                << ", rtt = "
+                << TimestampUtils::nsec_to_msec(TimestampUtils::ts_sub_nsec(rx_ts, &sent))
+                << " ms" << std::endl;
+        }
+
+        return 1;
+    }
+
+    if (icmp_hdr->icmp_type != ICMP_DEST_UNREACH
+        && icmp_hdr->icmp_type != ICMP_TIME_EXCEEDED
+        && icmp_hdr->icmp_type != ICMP_PARAMETERPROB
+        && icmp_hdr->icmp_type != ICMP_SOURCE_QUENCH)
+        return 0;
+
+    // an icmp error : it quotes the ip header of our echo request, followed
+    // by (at least) its 8 byte icmp header
+    if (icmp_len < 8 + (int) sizeof(struct ip))
+        return 0;
+
+    struct ip * inner_ip_hdr = (struct ip *) (pckt + ip_hdr_len + 8);
+    int inner_ip_hdr_len = inner_ip_hdr->ip_hl << 2;
+
+    if (inner_ip_hdr->ip_p != IPPROTO_ICMP || icmp_len < 8 + inner_ip_hdr_len + 8)
+        return 0;
+
+    struct icmp * inner_icmp_hdr = (struct icmp *) (pckt + ip_hdr_len + 8 + inner_ip_hdr_len);
+    uint32_t addr = ntohl(inner_ip_hdr->ip_dst.s_addr);
+
+    if (inner_icmp_hdr->icmp_type != ICMP_ECHO || (uint64_t) (addr - range_first) >= range_size)
+        return 0;
+
+    uint64_t cookie = get_cookie(addr);
+
+    if (memcmp(&inner_icmp_hdr->icmp_id, &cookie, 4) != 0) {
+        nr_invalid++;
+        return 0;
+    }
+
+    nr_unreachable++;
+
+    if (!quiet) {
+
+        char dst_addr[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &inner_ip_hdr->ip_dst, dst_addr, sizeof(dst_addr));
+
+        std::cout << dst_addr << " : unreachable (type = "
+            << (uint16_t) icmp_hdr->icmp_type << ", code = "
+            << (uint16_t) icmp_hdr->icmp_code << ", from " << src_addr << ")"
+            << std::endl;
+    }
+
+    return 1;
+}
@@ -0,0 +1,198 @@
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <iostream>
+
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <net/if.h>             // if_nametoindex()
+#include <net/ethernet.h>       // ETH_P_IP
+#include <netinet/ip.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>       // SKF_NET_OFF
+
+#include "packet-ring.h"
+#include "icmp-filter.h"
+
+PacketRing::PacketRing()
+    : socket_fd(-1), ring((char *) MAP_FAILED), ring_size(0), current_block(0),
+      nr_blocks(0), nr_packets(0) {
+}
+
+PacketRing::~PacketRing() {
+
+    if (ring != MAP_FAILED)
+        munmap(ring, ring_size);
+
+    if (socket_fd >= 0)
+        close(socket_fd);
+}
+
+int PacketRing::open_socket() {
+
+    // protocol 0 : the socket receives nothing until bind() (see setup()),
+    // so no packet gets in before the filter is attached
+    if ((socket_fd = socket(AF_PACKET, SOCK_RAW, 0)) < 0) {
+
+        std::cerr << "packet-ring::open_socket() : [ERROR] error opening packet "\
+            "socket: " << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int PacketRing::setup(const char * ifname, uint16_t id_base, uint32_t nr_ids) {
+
+    if (ICMPFilter::attach_echo_filter(socket_fd, id_base, nr_ids, SKF_NET_OFF) < 0)
+        return -1;
+
+    int version = TPACKET_V3;
+
+    if (setsockopt(socket_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+
+        std::cerr << "packet-ring::setup() : [ERROR] error setting TPACKET_V3: "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = PACKET_RING_BLOCK_SIZE;
+    req.tp_block_nr = PACKET_RING_NR_BLOCKS;
+    req.tp_frame_size = PACKET_RING_FRAME_SIZE;
+    req.tp_frame_nr = (PACKET_RING_BLOCK_SIZE / PACKET_RING_FRAME_SIZE) * PACKET_RING_NR_BLOCKS;
+    req.tp_retire_blk_tov = PACKET_RING_BLOCK_TIMEOUT;
+
+    if (setsockopt(socket_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+
+        std::cerr << "packet-ring::setup() : [ERROR] error setting up the ring: "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    ring_size = (size_t) req.tp_block_size * req.tp_block_nr;
+    ring = (char *) mmap(NULL, ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_LOCKED | MAP_POPULATE, socket_fd, 0);
+
+    // MAP_LOCKED may fail w/ a low RLIMIT_MEMLOCK : try w/o it
+    if (ring == MAP_FAILED)
+        ring = (char *) mmap(NULL, ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, socket_fd, 0);
+
+    if (ring == MAP_FAILED) {
+
+        std::cerr << "packet-ring::setup() : [ERROR] error mapping the ring: "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_IP);
+    addr.sll_ifindex = 0;
+
+    if (strcmp(ifname, "any") != 0 && (addr.sll_ifindex = if_nametoindex(ifname)) == 0) {
+
+        std::cerr << "packet-ring::setup() : [ERROR] unknown interface "
+            << ifname << std::endl;
+
+        return -1;
+    }
+
+    if (bind(socket_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+
+        std::cerr << "packet-ring::setup() : [ERROR] error binding to "
+            << ifname << ": " << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int PacketRing::receive(packet_ring_handler handler, void * arg) {
+
+    int received = 0;
+
+    // at most a full turn of the ring per call, so that a flood can't keep
+    // us here forever
+    for (int b = 0; b < PACKET_RING_NR_BLOCKS; b++) {
+
+        struct tpacket_block_desc * block =
+            (struct tpacket_block_desc *) (ring + (current_block * PACKET_RING_BLOCK_SIZE));
+
+        // the acquire load pairs w/ the kernel's release of the block, so
+        // that its packets are visible once we see TP_STATUS_USER
+        if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+            break;
+
+        struct tpacket3_hdr * frame =
+            (struct tpacket3_hdr *) ((char *) block + block->hdr.bh1.offset_to_first_pkt);
+
+        for (uint32_t i = 0; i < block->hdr.bh1.num_pkts; i++) {
+
+            // the frame starts w/ its tpacket3_hdr. the link layer header
+            // (e.g. ethernet's 14 byte) is at tp_mac, and the ip header at
+            // tp_net : the link layer header is skipped, whatever its size.
+            // tp_snaplen counts from tp_mac.
+            char * ip_pckt = (char *) frame + frame->tp_net;
+            int len = (int) frame->tp_snaplen - (int) (frame->tp_net - frame->tp_mac);
+
+            if (len >= (int) sizeof(struct ip)) {
+
+                // what recvmsg() would have filled in on a raw socket
+                struct sockaddr_in src;
+                memset(&src, 0, sizeof(src));
+                src.sin_family = AF_INET;
+                src.sin_addr = ((struct ip *) ip_pckt)->ip_src;
+
+                struct iovec iov;
+                iov.iov_base = ip_pckt;
+                iov.iov_len = len;
+
+                struct msghdr msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.msg_name = &src;
+                msg.msg_namelen = sizeof(src);
+                msg.msg_iov = &iov;
+                msg.msg_iovlen = 1;
+
+                struct timespec rx_ts;
+                rx_ts.tv_sec = frame->tp_sec;
+                rx_ts.tv_nsec = frame->tp_nsec;
+
+                handler(&msg, len, &rx_ts, arg);
+            }
+
+            frame = (struct tpacket3_hdr *) ((char *) frame + frame->tp_next_offset);
+        }
+
+        received += block->hdr.bh1.num_pkts;
+        nr_packets += block->hdr.bh1.num_pkts;
+        nr_blocks++;
+
+        // hand the block back to the kernel
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        current_block = (current_block + 1) % PACKET_RING_NR_BLOCKS;
+    }
+
+    return received;
+}
+
+int64_t PacketRing::get_drops() {
+
+    struct tpacket_stats_v3 stats;
+    socklen_t len = sizeof(stats);
+
+    if (getsockopt(socket_fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) < 0)
+        return -1;
+
+    return (int64_t) stats.tp_drops;
+}
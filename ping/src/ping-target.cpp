@@ -0,0 +1,127 @@
+#include <string.h>
+#include <stdio.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netdb.h>              // getaddrinfo()
+
+#include "ping-target.h"
+
+TargetTable::TargetTable(uint16_t id_base)
+    : id_base(id_base), id_to_target(MAX_TARGETS, 0) {
+}
+
+int TargetTable::add_target(const char * hostname) {
+
+    struct in_addr addr;
+
+    // if hostname is already in dotted-decimal form, inet_pton() is enough.
+    // this matters when loading large target lists, which are mostly ip
+    // addresses: a getaddrinfo() call per target would take ages.
+    if (inet_pton(AF_INET, hostname, &addr) != 1) {
+
+        int rc = 0;
+        struct addrinfo hints, * answer;
+
+        memset(&hints, 0, sizeof hints);
+        hints.ai_family = AF_INET;          // we're interested in ipv4
+        hints.ai_socktype = SOCK_STREAM;    // tcp
+
+        if ((rc = getaddrinfo(hostname, NULL, &hints, &answer)) != 0) {
+
+            std::cerr << "ping-target::add_target() : [ERROR] error while getting "\
+                "address of " << hostname << " (" << gai_strerror(rc) << ")" << std::endl;
+
+            return -1;
+        }
+
+        addr = ((struct sockaddr_in *) answer->ai_addr)->sin_addr;
+        freeaddrinfo(answer);
+    }
+
+    return add_target(hostname, addr);
+}
+
+int TargetTable::add_target(const char * hostname, struct in_addr addr) {
+
+    if (targets.size() >= MAX_TARGETS) {
+
+        std::cerr << "ping-target::add_target() : [ERROR] too many targets "\
+            "(max. " << MAX_TARGETS << "). skipping " << hostname << std::endl;
+
+        return -1;
+    }
+
+    // value-initialization : zeroes all plain fields
+    struct ping_target target = ping_target();
+    strncpy(target.hostname, hostname, MAX_HOSTNAME_SIZE - 1);
+    target.addr.sin_family = AF_INET;
+    target.addr.sin_addr = addr;
+
+    // each target gets its own icmp identifier. with a single target, this
+    // is just id_base (i.e. the pid, as in the original ping).
+    int index = targets.size();
+    target.index = index;
+    target.id = (uint16_t) (id_base + index);
+    id_to_target[target.id] = index + 1;
+
+    targets.push_back(target);
+
+    return index;
+}
+
+int TargetTable::load_targets(const char * filename) {
+
+    std::ifstream file(filename);
+
+    if (!file.is_open()) {
+
+        std::cerr << "ping-target::load_targets() : [ERROR] could not open "\
+            "target file " << filename << std::endl;
+
+        return -1;
+    }
+
+    int added = 0;
+    std::string line;
+
+    while (std::getline(file, line)) {
+
+        // trim leading and trailing whitespace
+        size_t start = line.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos)
+            continue;
+        size_t end = line.find_last_not_of(" \t\r\n");
+        line = line.substr(start, end - start + 1);
+
+        if (line[0] == '#')
+            continue;
+
+        if (add_target(line.c_str()) >= 0)
+            added++;
+    }
+
+    return added;
+}
+
+struct ping_target * TargetTable::lookup(uint16_t id, uint16_t seq) {
+
+    uint32_t index = id_to_target[id];
+
+    if (index == 0)
+        return NULL;
+
+    struct ping_target * target = &targets[index - 1];
+
+    // the seq number must be one we've already sent. the distance is taken
+    // modulo 2^16, so that this keeps working after seq wraps around.
+    uint16_t distance = (uint16_t) (target->next_seq - 1 - seq);
+    if (target->sent == 0 || distance >= target->sent)
+        return NULL;
+
+    return target;
+}
@@ -1,11 +1,18 @@
 #include <string.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/eventfd.h>
 
 #include <iostream>
-#include <thread>
+#include <vector>
+#include <algorithm>
 
 #include <sys/socket.h>
 #include <arpa/inet.h>
@@ -16,22 +23,140 @@
 #include <netdb.h>              // getaddrinfo()
 
 #include "argvparser.h"
+#include "ping-target.h"
+#include "recv-ring.h"
+#include "echo-burst.h"
+#include "probe-scheduler.h"
+#include "timestamp-utils.h"
+#include "dns-cache.h"
+#include "icmp-filter.h"
+#include "event-loop.h"
+#include "uring-backend.h"
+#include "packet-ring.h"
+#include "icmp-utils.h"
+#include "icmp-sweep.h"
+#include "token-bucket.h"
+#include "timing-wheel.h"
 
-// Steven's unp book sets the icmp's ECHO optional data field (i.e. after the 
-// 8 byte icmp header) to 56 bytes, which yields a 84 byte ipv4 datagram:
-//  -# 20 byte ipv4 header
-//  -# 8 byte icmp header
-//  -# 56 byte for icmp optional data (we only use 8 byte for a timeval struct)
-#define ICMP_DATA_LEN   56
 #define SERVICE_HTTP    "http"
 // as defined in Steven's unp book, fig. 28.4
 #define MAX_BUFFER_SIZE 1500
 #define MAX_STRING_SIZE 256
 
 #define OPTION_HOSTNAME     (char *) "hostname"
+#define OPTION_TARGETS      (char *) "targets"
+#define OPTION_RECV_BATCH   (char *) "recv-batch"
+#define OPTION_BURST        (char *) "burst"
+#define OPTION_INTERVAL     (char *) "interval"
+#define OPTION_SCHEDULE     (char *) "schedule"
+#define OPTION_TRAIN        (char *) "train"
+#define OPTION_TX_TIMESTAMPS    (char *) "tx-timestamps"
+#define OPTION_QUIET            (char *) "quiet"
+#define OPTION_REPORT_INTERVAL  (char *) "report-interval"
+#define OPTION_TIMEOUT          (char *) "timeout"
+#define OPTION_NO_FILTER        (char *) "no-filter"
+#define OPTION_IO_BACKEND       (char *) "io-backend"
+#define OPTION_RX_RING          (char *) "rx-ring"
+#define OPTION_SWEEP            (char *) "sweep"
+#define OPTION_EXCLUDE          (char *) "exclude"
+#define OPTION_RATE             (char *) "rate"
+#define OPTION_THREADS          (char *) "threads"
+
+// max. nr. of replies read per EPOLLIN event (see receive_replies())
+#define RECV_BUDGET             256
+// max. nr. of rounds of echo requests sent per send timer event
+#define MAX_ROUNDS_PER_EVENT    64
+
+// default time after which a reply is considered late, in msec
+#define DEFAULT_TIMEOUT     2000
+// resolution of the per-request timeouts (see TimingWheel), in usec, and the 
+// max. nr. of them pending at once (24 byte each)
+#define TIMEOUT_TICK        10000
+#define MAX_TIMEOUTS        (1 << 24)
+
+// default interval between rounds of echo requests : 1 sec, in usec
+#define DEFAULT_INTERVAL    1000000
+
+// sweeps (see run_sweep()) : probes per sendmmsg(), replies per recvmmsg(), 
+// the period of the send timer (in usec) and the default rate (in pps)
+#define SWEEP_BATCH         64
+#define SWEEP_RECV_BATCH    64
+#define SWEEP_TICK          1000
+#define DEFAULT_SWEEP_RATE  10000
 
 using namespace CommandLineProcessing;
 
+// everything the receive path needs to process a reply
+struct reply_context {
+    TargetTable * targets;
+    // kernel tx timestamps of the requests (NULL if not used)
+    TxTimestampTable * tx_stamps;
+    DnsCache * dns_cache;
+    // if true, don't print a line per reply (only the statistics)
+    bool quiet;
+    // replies w/ larger rtts are classified as late
+    int64_t timeout_nsec;
+    // a timeout per echo request, cancelled by its reply
+    TimingWheel * timeouts;
+    // nr. of packets read from the socket (i.e. which got past the kernel 
+    // filter, if any)
+    uint64_t delivered;
+};
+
+// the options all pingers share (see below), as given on the command line
+struct pinger_options {
+    int recv_batch;
+    int burst_size;
+    uint64_t interval;
+    int schedule;
+    int train_len;
+    const char * tx_timestamps;
+    bool quiet;
+    int report_interval;
+    int timeout;
+    bool use_filter;
+    const char * io_backend;
+    const char * rx_ring_ifname;
+    DnsCache * dns_cache;
+};
+
+// a pinger : an event loop (see event-loop.h) w/ its own raw socket and 
+// targets, which sends the echo requests and processes the replies. w/ 
+// --threads n, pingy runs n of them, one per thread (and core), each w/ a 
+// slice of the targets : besides the options and the dns cache, they share 
+// nothing. the objects below are kept after the loop ends, so that main() 
+// can report on (and then delete) them.
+struct pinger {
+    const struct pinger_options * options;
+    int socket_fd;
+    TargetTable * targets;
+    // the icmp identifier of the 1st target (see TargetTable)
+    uint16_t id_base;
+    // the core the pinger runs on, -1 for any
+    int cpu;
+    // the loop ends once exit_fd is readable. w/ a single pinger, it's the 
+    // signalfd for SIGINT and SIGTERM. otherwise, it's an eventfd which 
+    // main() (or a pinger which fails) writes to, and which is never read, 
+    // so that all pingers see it.
+    int exit_fd;
+    bool exit_on_signal;
+
+    PacketRing * rx_ring;
+    struct reply_context reply_ctx;
+    TimingWheel * timeouts;
+    UringBackend * uring;
+    RecvRing * recv_ring;
+    EchoBurst * burst;
+    // the kernel filter is attached to the socket (or the rx ring)
+    bool filtered;
+    double elapsed;
+    int rc;
+};
+
+// serializes the output of pingers in diff. threads (see --threads), so 
+// that their lines (and reports) don't interleave
+pthread_mutex_t print_lock = PTHREAD_MUTEX_INITIALIZER;
+
 ArgvParser * create_argv_parser() {
 
     ArgvParser * parser = new ArgvParser();
@@ -42,115 +167,264 @@ ArgvParser * create_argv_parser() {
     parser->defineOption(
             OPTION_HOSTNAME,
             "hostname to ping",
-            ArgvParser::OptionRequiresValue | ArgvParser::OptionRequired);
+            ArgvParser::OptionRequiresValue);
 
-    return parser;
-}
+    parser->defineOption(
+            OPTION_TARGETS,
+            "file w/ a list of hostnames to ping (one per line). all targets "\
+            "are pinged from a single raw socket.",
+            ArgvParser::OptionRequiresValue);
 
-struct icmp * prepare_icmp_pckt(
-    uint8_t type, 
-    uint8_t code) {
-
-    // we allocate memory with a char[] of size 1500, and then use the memory 
-    // block for the struct icmp *
-    char * icmp_raw = (char *) calloc(MAX_BUFFER_SIZE, sizeof(char));
-    struct icmp * icmp_pckt = (struct icmp *) icmp_raw;
-
-    // the <type, code> tuple identifies the icmp message purpose
-    icmp_pckt->icmp_type = type;
-    icmp_pckt->icmp_code = code;
-    // we set the identifier field of the icmp message as the calling process 
-    // pid
-    icmp_pckt->icmp_id = (getpid() & 0xFFFF);
-    // the icmp message is started w/ a seq number of 0, it will be increased 
-    // as needed in subsequent uses of the icmp struct
-    icmp_pckt->icmp_seq = 0;    
-    // following Steven's UNP book, we fill the data portion with '0XA5', then 
-    // with data
-    memset(icmp_pckt->icmp_data, 0xA5, ICMP_DATA_LEN);
-
-    return icmp_pckt;
-}
+    parser->defineOption(
+            OPTION_RECV_BATCH,
+            "receive up to <n> replies per syscall (w/ recvmmsg()). the "\
+            "average batch size is reported on exit.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_BURST,
+            "flood mode : send echo requests back-to-back, in bursts of <n> "\
+            "per syscall (w/ sendmmsg()). targets are cycled round-robin.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_INTERVAL,
+            "(mean) interval between rounds of echo requests, in usec. a "\
+            "round sends one echo request to each target. default : 1000000.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_SCHEDULE,
+            "timing pattern of rounds : 'fixed' (default), 'poisson' "\
+            "(exponential gaps w/ mean --interval, as in RFC 2330) or 'burst' "\
+            "(trains of --train back-to-back rounds, every --interval).",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_TRAIN,
+            "nr. of back-to-back rounds per train, w/ --schedule burst. "\
+            "default : 1.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_TX_TIMESTAMPS,
+            "use kernel tx timestamps (read from the socket's error queue) "\
+            "as send times : 'sw' for software timestamps, 'hw' for hardware "\
+            "timestamps where the nic supports them (software otherwise).",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_QUIET,
+            "don't print a line per echo reply, only the statistics",
+            ArgvParser::NoOptionAttribute);
+
+    parser->defineOption(
+            OPTION_REPORT_INTERVAL,
+            "print per-target statistics every <n> seconds (they're always "\
+            "printed on exit)",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_TIMEOUT,
+            "time after which a reply is considered late, in msec. "\
+            "default : 2000.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_NO_FILTER,
+            "don't attach the in-kernel (bpf) filter to the raw socket, i.e. "\
+            "process every icmp packet the host receives",
+            ArgvParser::NoOptionAttribute);
+
+    parser->defineOption(
+            OPTION_IO_BACKEND,
+            "how probes are sent and replies received : 'syscalls' (default, "\
+            "sendto() / sendmmsg() and recvmsg() / recvmmsg()) or 'uring' "\
+            "(batched io_uring submissions and a multishot receive, falls back "\
+            "to 'syscalls' if io_uring isn't available).",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_RX_RING,
+            "receive replies through a memory-mapped (TPACKET_V3) packet ring "\
+            "on interface <ifname> ('any' for all interfaces), instead of "\
+            "reading them from the raw socket. the ring always gets the kernel "\
+            "(bpf) filter.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_SWEEP,
+            "sweep mode : send a single echo request to every address in a "\
+            "range, given in cidr notation (e.g. 10.0.0.0/16), in a "\
+            "pseudo-random order, and list the hosts which reply. no state is "\
+            "kept per probe : replies are validated w/ a cookie (a keyed hash "\
+            "of the address). waits --timeout msec for the last replies. "\
+            "--io-backend, --rx-ring and the scheduling options don't apply.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_EXCLUDE,
+            "file w/ ranges (cidr notation, one per line) to leave out of a "\
+            "--sweep",
+            ArgvParser::OptionRequiresValue);
 
-uint16_t in_cksum(uint16_t * addr, int len) {
-    int nleft = len;
-    int sum = 0;
-    uint16_t *w = addr;
-    uint16_t answer = 0;
-
-    /*
-     * the algorithm is simple: using a 32 bit accumulator (sum), we add
-     * sequential 16 bit words to it, and at the end, fold back all the
-     * carry bits from the top 16 bits into the lower 16 bits.
-     */
-    while (nleft > 1)  {
-        sum += *w++;
-        nleft -= 2;
-    }
-
-    /* mop up an odd byte, if necessary */
-    if (nleft == 1) {
-        *(unsigned char *) (&answer) = *(unsigned char *) w ;
-        sum += answer;
-    }
-
-        /* add back carry outs from top 16 bits to low 16 bits */
-    sum = (sum >> 16) + (sum & 0xffff); /* add hi 16 to low 16 */
-    sum += (sum >> 16);         /* add carry */
-    answer = ~sum;              /* truncate to 16 bits */
-    
-    return answer;
+    parser->defineOption(
+            OPTION_RATE,
+            "max. nr. of echo requests per second in a --sweep, 0 for no limit. "\
+            "default : 10000.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_THREADS,
+            "run <n> event loops, one per thread (pinned to a core each), each "\
+            "w/ its own raw socket and a slice of the targets. default : 1. "\
+            "doesn't apply to --sweep, and can't be used w/ --rx-ring.",
+            ArgvParser::OptionRequiresValue);
+
+    return parser;
 }
 
+// sends an echo request to target, w/ its probe in the pool (probe i is 
+// target i's, and so already carries its identifier) : only the seq number, 
+// timestamp and checksum change. 
+// w/ the io_uring backend, the request is only queued (see uring-backend.h), 
+// and goes out w/ the next UringBackend::submit().
 void send_icmp_echo(
-    int interval,
-    int socket_fd,
-    struct icmp * icmp_pckt,
-    struct sockaddr * dst_addr,
-    socklen_t dst_addrlen) {
+    int socket_fd, 
+    ICMPProbePool * probes,
+    struct ping_target * target,
+    UringBackend * uring,
+    struct reply_context * ctx) {
 
     // 56 byte of optional data + 8 byte icmp header
-    int icmp_data_len = ICMP_DATA_LEN + 8;
-    icmp_pckt->icmp_seq = 0;
-
-    while (1) {
-
-        // fill icmp_pct->icmp_data (payload) with the current timestamp. note 
-        // how we just use the raw bytes of icmp_pckt->icmp_data.
-        gettimeofday((struct timeval *) icmp_pckt->icmp_data, NULL); 
+    int icmp_data_len = probes->get_pckt_len();
+
+    // the payload starts w/ the current timestamp. the clock is 
+    // CLOCK_REALTIME, the same as the kernel's rx timestamps.
+    struct echo_payload payload;
+    clock_gettime(CLOCK_REALTIME, &payload.timestamp);
+
+    // then the request's timeout, which expires unless the reply cancels 
+    // it first (see handle_timeout())
+    payload.timer = ctx->timeouts->insert(
+        (uint64_t) ctx->timeout_nsec, ((uint64_t) target->index << 16) | target->next_seq);
+
+    // unlike the original single-target version, id and seq go out 
+    // in network byte order (see ICMPProbePool), so that other tools (e.g. 
+    // tcpdump) read the same values we do. the checksum is updated for 
+    // the seq number and payload only (rfc 1624), not re-summed.
+    struct icmp * icmp_pckt = probes->stamp(
+        (int) target->index, target->next_seq, &payload, sizeof(payload));
+
+    // increment the sequence nr. before the send, so that the target's 
+    // state is consistent w/ what's on the wire. a reply can't be 
+    // processed before we're done here anyway : sending and receiving 
+    // happen in the same thread (see the event loop in main()).
+    target->next_seq++;
+    target->sent++;
+
+    if (uring != NULL) {
+
+        if (uring->queue_send(icmp_pckt, icmp_data_len, &target->addr) < 0) {
+
+            std::cerr << "pingy::send_icmp_echo() : [ERROR] error queuing "\
+                "echo request to " << target->hostname << std::endl;
+        }
 
-        // icmp packet checksum over the whole of its 64 byte
-        icmp_pckt->icmp_cksum = 0;
-        icmp_pckt->icmp_cksum = in_cksum((u_short *) icmp_pckt, icmp_data_len);
+        return;
+    }
 
-        sendto(
+    if (sendto(
             socket_fd, 
             icmp_pckt, icmp_data_len,
             0,
-            dst_addr, dst_addrlen);
+            (struct sockaddr *) &target->addr, sizeof(target->addr)) < 0) {
 
-        sleep(interval);
-
-        // increment the sequence nr.
-        icmp_pckt->icmp_seq++;
+        std::cerr << "pingy::send_icmp_echo() : [ERROR] error sending "\
+            "to " << target->hostname << ": " << strerror(errno) << std::endl;
     }
 }
 
-void tv_sub(struct timeval * out, struct timeval * in) {
+// reads all tx timestamps queued on the socket's error queue, and saves them 
+// in tx_stamps, indexed by the target and seq of the respective echo request
+void read_tx_timestamps(
+    int socket_fd, 
+    TargetTable * targets, 
+    TxTimestampTable * tx_stamps) {
+
+    char buffer[MAX_BUFFER_SIZE];
+    struct pckt_timestamps ts;
+    int len = 0;
+    // 56 byte of optional data + 8 byte icmp header
+    int icmp_data_len = ICMP_DATA_LEN + 8;
+
+    while ((len = TimestampUtils::read_tx_timestamp(socket_fd, buffer, sizeof(buffer), &ts)) >= 0) {
+
+        // the copy of the sent packet starts w/ the headers added on the way 
+        // down the stack (ip header, and possibly a link layer header, 
+        // depending on the device), and ends w/ our echo request. we know 
+        // the length of the latter, so we read it from the end.
+        if (len < icmp_data_len)
+            continue;
 
-    if ((out->tv_usec -= in->tv_usec) < 0) {   /* out -= in */
+        struct icmp * icmp_pckt = (struct icmp *) (buffer + len - icmp_data_len);
 
-        --out->tv_sec;
-        out->tv_usec += 1000000;
+        if (icmp_pckt->icmp_type != ICMP_ECHO)
+            continue;
+
+        uint16_t seq = ntohs(icmp_pckt->icmp_seq);
+        struct ping_target * target = targets->lookup(ntohs(icmp_pckt->icmp_id), seq);
+
+        if (target != NULL)
+            tx_stamps->put(target->index, seq, &ts);
+    }
+}
+
+// prints the statistics of every target, in the style of ping's summary. 
+// percentiles come from each target's log-linear histogram (see rtt-stats.h).
+void print_rtt_stats(TargetTable * targets) {
+
+    for (size_t i = 0; i < targets->size(); i++) {
+
+        struct ping_target * target = targets->get(i);
+        RttStats * stats = &target->rtt_stats;
+
+        double loss = 0.0;
+        if (target->sent > 0)
+            loss = 100.0 * (double) (target->sent - target->received) / (double) target->sent;
+
+        std::cout << "--- " << target->hostname << " ping statistics ---" << std::endl;
+        std::cout << target->sent << " packets transmitted, " 
+            << target->received << " received, " 
+            << loss << "% packet loss, " 
+            << target->timed_out << " timed out" << std::endl;
+
+        SeqWindow * window = &target->seq_window;
+        std::cout << window->get_on_time() << " on time, " 
+            << window->get_late() << " late, " 
+            << window->get_reordered() << " reordered, " 
+            << window->get_duplicates() << " duplicates" << std::endl;
+
+        if (stats->get_count() == 0)
+            continue;
+
+        std::cout << "rtt min/avg/max/mdev = " 
+            << stats->get_min() << "/" << stats->get_mean() << "/" 
+            << stats->get_max() << "/" << stats->get_stdev() << " ms" << std::endl;
+        std::cout << "rtt p50/p90/p99/p99.9 = " 
+            << stats->get_percentile(0.5) << "/" << stats->get_percentile(0.9) << "/" 
+            << stats->get_percentile(0.99) << "/" << stats->get_percentile(0.999) 
+            << " ms" << std::endl;
     }
-    
-    out->tv_sec -= in->tv_sec;
 }
 
 int proccess_icmp_ipv4_reply(
     int recv_bytes, 
     struct msghdr * msg, 
-    struct timeval * rcv_timestamp) {
+    struct pckt_timestamps * rcv_timestamp,
+    struct reply_context * ctx) {
+
+    ctx->delivered++;
 
     // fetch the recv payload through the iovec of msg 
     char aux[MAX_STRING_SIZE] = "";
@@ -181,7 +455,7 @@ int proccess_icmp_ipv4_reply(
         std::cerr << "pingy::proccess_icmp_ipv4_reply() : [ERROR] not an ICMP "\
             "packet. not processing." << std::endl;        
 
-        return -1;
+        return -1;              
     }
 
     // with the ipv4 header length, we now know the start of the icmp 
@@ -201,7 +475,9 @@ int proccess_icmp_ipv4_reply(
 
     if (icmp_hdr->icmp_type == ICMP_ECHOREPLY) {
 
-        if (icmp_len < 16) {
+        // the payload must hold the struct echo_payload we sent (timestamp 
+        // and timer handle) : anything shorter isn't one of our replies
+        if (icmp_len < 8 + (int) sizeof(struct echo_payload)) {
 
             std::cerr << "pingy::proccess_icmp_ipv4_reply() : [ERROR] malformed ICMP "\
                 "echo reply. payload too short to be meaningful (" 
@@ -210,11 +486,55 @@ int proccess_icmp_ipv4_reply(
             return -1;            
         }
 
-        // extract the struct timeval in the echo reply. again through a simple 
+        // demultiplex the reply to the target it belongs to. with a single 
+        // raw socket, we get replies to other ping processes too: those 
+        // simply don't resolve to a target, and are ignored.
+        struct ping_target * target = ctx->targets->lookup(
+            ntohs(icmp_hdr->icmp_id), ntohs(icmp_hdr->icmp_seq));
+
+        if (target == NULL)
+            return 1;
+
+        // extract the struct timespec in the echo reply. again through a simple 
         // typecast (which seems pretty convenient)
-        struct timeval * snd_timestamp = (struct timeval *) icmp_hdr->icmp_data;
-        tv_sub(rcv_timestamp, snd_timestamp);
-        double rtt = rcv_timestamp->tv_sec * 1000.0 + rcv_timestamp->tv_usec / 1000.0;
+        struct echo_payload * payload = (struct echo_payload *) icmp_hdr->icmp_data;
+        struct timespec * snd_timestamp = &payload->timestamp;
+
+        // the request is answered : cancel its timeout. if it already 
+        // expired, the reply is late (which the seq window tells us anyway).
+        ctx->timeouts->cancel(payload->timer);
+        int64_t rtt_nsec = TimestampUtils::ts_sub_nsec(&rcv_timestamp->sw, snd_timestamp);
+
+        // if the kernel gave us a tx timestamp for the request, use it 
+        // instead of the one in the payload (which is taken before the 
+        // checksum and sendto(), and so includes the tx path's delays). 
+        // hardware timestamps are used only if both ends have one, since 
+        // they're on the nic's clock.
+        struct pckt_timestamps snd_kernel_timestamp;
+        if (ctx->tx_stamps != NULL 
+            && ctx->tx_stamps->get(target->index, ntohs(icmp_hdr->icmp_seq), &snd_kernel_timestamp) == 0) {
+
+            if (snd_kernel_timestamp.has_hw && rcv_timestamp->has_hw)
+                rtt_nsec = TimestampUtils::ts_sub_nsec(&rcv_timestamp->hw, &snd_kernel_timestamp.hw);
+            else if (snd_kernel_timestamp.has_sw && rcv_timestamp->has_sw)
+                rtt_nsec = TimestampUtils::ts_sub_nsec(&rcv_timestamp->sw, &snd_kernel_timestamp.sw);
+        }
+
+        double rtt = TimestampUtils::nsec_to_msec(rtt_nsec);
+
+        // check the seq number against the ones already received. duplicates 
+        // don't count as received, and don't go into the rtt statistics.
+        int reply_class = target->seq_window.classify(
+            ntohs(icmp_hdr->icmp_seq), rtt_nsec, ctx->timeout_nsec);
+
+        if (reply_class != REPLY_DUPLICATE) {
+
+            target->received++;
+            target->rtt_stats.add(rtt_nsec);
+        }
+
+        if (ctx->quiet)
+            return 0;
 
         // believe it or not, one of the most complicated parts of unix network 
         // programming is translation between the raw bit representations of 
@@ -224,65 +544,504 @@ int proccess_icmp_ipv4_reply(
         // the ipv4 header. this is quick : get the ip_src attribute of the 
         // struct ip is an in_addr, ready to be fed to inet_ntoa(), which 
         // in turn returns a dotted-decimal C string.
-        std::cout << "got " << icmp_len << " bytes from " 
-            << inet_ntoa(ipv4_hdr->ip_src) 
-                // to print the canonical name of the host w/ ipv4 address 
-                // ipv4_hdr->ip_src, we use gethostbyaddr(). this returns a 
-                // srtuct hostent *, which has char * attribute with this 
-                // cname. one curious thing: the 1st arg of gethostbyaddr() is 
-                // listed as a char *, but should be a struct in_addr * instead.
-                << " (" << gethostbyaddr(&(ipv4_hdr->ip_src), sizeof(struct in_addr), AF_INET)->h_name << ")"
-            << " : icmp_seq = " << icmp_hdr->icmp_seq 
+        // to print the canonical name of the host w/ ipv4 address 
+        // ipv4_hdr->ip_src, we used to call gethostbyaddr() right here. 
+        // that's a blocking network lookup on the receive path, so names 
+        // now come from an asynchronous, cached resolver (see dns-cache.h). 
+        // until the name is known, we print the numeric address.
+        char src_addr[INET_ADDRSTRLEN] = "";
+        char src_name[DNS_MAX_NAME_SIZE] = "";
+        inet_ntop(AF_INET, &ipv4_hdr->ip_src, src_addr, sizeof(src_addr));
+
+        if (!ctx->dns_cache->lookup(ipv4_hdr->ip_src, src_name, sizeof(src_name)))
+            strncpy(src_name, src_addr, sizeof(src_name));
+
+        pthread_mutex_lock(&print_lock);
+
+        std::cout << target->hostname << " : got " << icmp_len << " bytes from " 
+            << src_addr << " (" << src_name << ")"
+            << " : icmp_seq = " << ntohs(icmp_hdr->icmp_seq) 
             << ", ttl = " << (uint16_t) ipv4_hdr->ip_ttl << " (" << to_hex_str(ipv4_hdr->ip_ttl, aux) << ")" 
-            << ", rtt = " << rtt << " ms" << std::endl; 
+            << ", rtt = " << rtt << " ms" 
+            << (reply_class == REPLY_DUPLICATE ? " (DUP!)" : "")
+            << (reply_class == REPLY_LATE ? " (late)" : "")
+            << (reply_class == REPLY_REORDERED ? " (reordered)" : "")
+            << std::endl; 
+
+        pthread_mutex_unlock(&print_lock);
  
     } else {
 
+        // in quiet mode, only the statistics are printed
+        if (ctx->quiet)
+            return 1;
+
         // if this is an icmp packet but not an ECHO_REPLY, post the contents 
         // anyway...
+        pthread_mutex_lock(&print_lock);
+
         std::cerr << "pingy::proccess_icmp_ipv4_reply() : [WARNING] not ICMP ECHO REPLY. "\
             << "processing anyway..." << std::endl;
 
         std::cout << "got " << icmp_len << " bytes from " 
             << inet_ntoa(((struct sockaddr_in *) msg->msg_name)->sin_addr)
-            << " : type = " << icmp_hdr->icmp_type 
-            << ", code = " << icmp_hdr->icmp_code << std::endl;         
+            << " : type = " << (uint16_t) icmp_hdr->icmp_type 
+            << ", code = " << (uint16_t) icmp_hdr->icmp_code << std::endl;         
+
+        pthread_mutex_unlock(&print_lock);
     }
 
     return 0;
 }
 
-int main (int argc, char ** argv) {
+// fills rcv_timestamp w/ the kernel rx timestamp in msg's ancillary data. if 
+// the kernel didn't hand us one, we fall back to 'now'.
+void get_recv_timestamp(struct msghdr * msg, struct pckt_timestamps * rcv_timestamp) {
 
-    char hostname[MAX_STRING_SIZE] = "";
+    if (TimestampUtils::get_pckt_timestamps(msg, rcv_timestamp) < 0 
+        || !rcv_timestamp->has_sw) {
 
-    ArgvParser * arg_parser = create_argv_parser();
-    int parse_result = arg_parser->parse(argc, argv);
+        clock_gettime(CLOCK_REALTIME, &rcv_timestamp->sw);
+        rcv_timestamp->has_sw = true;
+    }
+}
 
-    if (parse_result != ArgvParser::NoParserError) {
+// reads the replies queued on the (non-blocking) socket, until it's empty or 
+// RECV_BUDGET replies have been processed, whichever comes first. the budget 
+// keeps a reply flood from starving the other events (e.g. send deadlines) : 
+// epoll is level-triggered, so whatever's left is reported again right 
+// away. w/ recv_ring, replies are read w/ recvmmsg(), otherwise one by one 
+// into recv_msg. returns the nr. of replies read, -1 on error.
+int receive_replies(
+    int socket_fd, 
+    RecvRing * recv_ring,
+    struct msghdr * recv_msg,
+    struct reply_context * ctx) {
 
-        std::cerr << arg_parser->parseErrorDescription(parse_result).c_str() << std::endl;
-        std::cerr << "pingy::main() : [ERROR] use option -h for help." << std::endl;
+    // we take note of the reception timestamp, compare it to that carried 
+    // by the ECHO's payload, which should contain the 'send time' timestamps. 
+    // the reception timestamp is taken by the kernel, as the packet arrives 
+    // (SO_TIMESTAMPNS), so that the time spent processing the previous 
+    // reply (or waiting to be scheduled) doesn't inflate the rtt. if the 
+    // kernel doesn't hand us a timestamp, we fall back to 'now'.
+    struct pckt_timestamps recv_timestamp;
+    int nr_replies = 0;
 
-        delete arg_parser;
-        return -1;
+    while (nr_replies < RECV_BUDGET) {
 
-    } else if (parse_result == ArgvParser::ParserHelpRequested) {
+        if (recv_ring != NULL) {
 
-        delete arg_parser;
-        return -1;
+            int received = recv_ring->receive(socket_fd);
 
-    } else {
+            if (received < 0)
+                break;
 
-        if (arg_parser->foundOption(OPTION_HOSTNAME))
-            strncpy(hostname, (char *) arg_parser->optionValue(OPTION_HOSTNAME).c_str(), MAX_STRING_SIZE);
+            // each slot carries its own kernel timestamp, so replies in the 
+            // same batch keep their individual arrival times
+            for (int i = 0; i < received; i++) {
+
+                get_recv_timestamp(recv_ring->get_msg(i), &recv_timestamp);
+
+                proccess_icmp_ipv4_reply(
+                    recv_ring->get_len(i), recv_ring->get_msg(i), &recv_timestamp, ctx);
+            }
+
+            nr_replies += received;
+
+        } else {
+
+            recv_msg->msg_namelen = sizeof(struct sockaddr);
+            recv_msg->msg_controllen = MAX_BUFFER_SIZE;
+
+            int recv_bytes = recvmsg(socket_fd, recv_msg, 0);
+
+            if (recv_bytes < 0)
+                break;
+
+            // gather the reception timestamp from the ancillary data
+            get_recv_timestamp(recv_msg, &recv_timestamp);
+
+            proccess_icmp_ipv4_reply(recv_bytes, recv_msg, &recv_timestamp, ctx);
+
+            nr_replies++;
+        }
     }
 
-    delete arg_parser;
+    // EAGAIN just means we've emptied the socket. EINTR can't really happen 
+    // on a non-blocking socket, but it's harmless too.
+    if (nr_replies < RECV_BUDGET 
+        && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+
+        std::cerr << "pingy::receive_replies() : [ERROR] error reading "\
+            "replies: " << strerror(errno) << std::endl;
+
+        return -1;              
+    }
+
+    return nr_replies;
+}
+
+// the io_uring backend's receive handler (see uring-backend.h) : msg holds a 
+// single packet, laid out as if read by recvmsg()
+void handle_uring_reply(struct msghdr * msg, int len, void * arg) {
+
+    struct pckt_timestamps recv_timestamp;
+    get_recv_timestamp(msg, &recv_timestamp);
+
+    proccess_icmp_ipv4_reply(len, msg, &recv_timestamp, (struct reply_context *) arg);
+}
+
+// the rx ring's receive handler (see packet-ring.h) : msg points straight 
+// into the ring, at the ip header of a single packet
+void handle_ring_reply(
+    struct msghdr * msg, int len, const struct timespec * rx_ts, void * arg) {
+
+    struct pckt_timestamps recv_timestamp;
+    recv_timestamp.sw = *rx_ts;
+    recv_timestamp.has_sw = true;
+    recv_timestamp.has_hw = false;
+
+    proccess_icmp_ipv4_reply(len, msg, &recv_timestamp, (struct reply_context *) arg);
+}
+
+// the timing wheel's expiry handler : an echo request got no reply w/in the 
+// timeout. data holds the target's index and the request's seq number.
+void handle_timeout(uint64_t data, void * arg) {
+
+    struct reply_context * ctx = (struct reply_context *) arg;
+    struct ping_target * target = ctx->targets->get((size_t) (data >> 16));
+
+    target->timed_out++;
+
+    if (ctx->quiet)
+        return;
+
+    pthread_mutex_lock(&print_lock);
+
+    std::cout << target->hostname << " : no reply for icmp_seq = " 
+        << (uint16_t) data << " after " 
+        << TimestampUtils::nsec_to_msec(ctx->timeout_nsec) << " ms" << std::endl;
+
+    pthread_mutex_unlock(&print_lock);
+}
+
+// sweep mode (see icmp-sweep.h) : probes every address in range once, at up 
+// to rate pps (0 for no limit), then waits timeout msec for the last replies. 
+// it has an event loop of its own, around the same (raw) socket as the 
+// regular mode's. returns pingy's exit code.
+int run_sweep(
+    int socket_fd, 
+    const char * range,
+    const char * exclude_file,
+    uint64_t rate,
+    int timeout,
+    bool quiet,
+    bool use_filter) {
+
+    IcmpSweep sweep(SWEEP_BATCH);
+
+    if (sweep.set_range(range) < 0)
+        return -1;              
+
+    if (strlen(exclude_file)) {
+
+        int added = sweep.load_exclusions(exclude_file);
+
+        if (added < 0)
+            return -1;            
+
+        std::cout << "pingy::run_sweep() : [INFO] loaded " << added 
+            << " exclusions from " << exclude_file << std::endl;
+    }
+
+    if (sweep.start() < 0)
+        return -1;              
+
+    std::cout << "pingy::run_sweep() : [INFO] sweeping " << range << " (" 
+        << sweep.get_range_size() << " addresses) at " ;
+
+    if (rate > 0)
+        std::cout << rate << " pps" << std::endl;
+    else
+        std::cout << "full speed" << std::endl;
+
+    // the probes' identifiers are (part of) their cookies, i.e. anything : 
+    // the filter can't check them, but still drops all icmp other than echo 
+    // replies and errors quoting echo requests
+    uint64_t icmp_in_msgs_start = 0, icmp_in_msgs_end = 0;
+
+    if (use_filter) {
+
+        if (ICMPFilter::attach_echo_filter(socket_fd, 0, 65536) < 0) {
+
+            std::cerr << "pingy::run_sweep() : [WARNING] running w/o the kernel "\
+                "filter." << std::endl;
+
+            use_filter = false;
+        }
+
+        ICMPFilter::get_icmp_in_msgs(icmp_in_msgs_start);
+    }
+
+    int sckt_flags = fcntl(socket_fd, F_GETFL, 0);
+
+    if (sckt_flags < 0 || fcntl(socket_fd, F_SETFL, sckt_flags | O_NONBLOCK) < 0) {
+
+        std::cerr << "pingy::run_sweep() : [ERROR] error setting O_NONBLOCK: " 
+            << strerror(errno) << std::endl;
+
+        return -1;              
+    }
+
+    if (TimestampUtils::enable_rx_timestamps(socket_fd) < 0) {
+
+        std::cerr << "pingy::run_sweep() : [WARNING] no kernel rx timestamps : "\
+            "rtts will include user-space receive delays." << std::endl;
+    }
+
+    EventLoop event_loop;
+
+    int exit_signals[] = { SIGINT, SIGTERM };
+    int signal_fd = event_loop.add_signals(exit_signals, 2);
+
+    if (signal_fd < 0)
+        return -1;              
+
+    // w/ a rate limit, probes go out on every tick of a periodic timer, as 
+    // many as the token bucket allows (i.e. ~rate / 1000 per tick). w/o a 
+    // limit, whenever the socket is writable (EPOLLOUT), as in flood mode. 
+    // either way, the bucket lets through up to 10 msec worth of probes at 
+    // once, e.g. to catch up after the send buffer was full.
+    uint64_t bucket_size = (rate / 100 > SWEEP_BATCH ? rate / 100 : SWEEP_BATCH);
+    TokenBucket bucket(rate, bucket_size);
+
+    int timer_fd = event_loop.add_timer();
+
+    if (timer_fd < 0 || event_loop.add_fd(socket_fd, EPOLLIN | (rate == 0 ? EPOLLOUT : 0)) < 0)
+        return -1;              
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    if (rate > 0 && EventLoop::arm_timer(timer_fd, deadline, SWEEP_TICK) < 0)
+        return -1;              
+
+    RecvRing recv_ring(SWEEP_RECV_BATCH);
+
+    // the send rate is measured up to sending_end, the end of the probing
+    struct timeval start, sending_end, end;
+    gettimeofday(&start, NULL);
+    sending_end = start;
+
+    // once every address has been probed, the timer is re-armed (once) for 
+    // the end of the sweep, timeout msec later
+    bool draining = false;
+    bool done = false;
+
+    auto send_probes = [&] () -> int {
+
+        uint64_t budget = bucket.refill();
+
+        while (budget > 0 && !sweep.is_done()) {
+
+            int sent = sweep.send(socket_fd, (int) (budget < SWEEP_BATCH ? budget : SWEEP_BATCH));
+
+            if (sent < 0)
+                return -1;
+
+            // the send buffer is full (or only excluded addresses came up) : 
+            // carry on w/ the next event
+            if (sent == 0)
+                break;
+
+            bucket.consume(sent);
+            budget -= (uint64_t) sent;
+        }
+
+        if (sweep.is_done() && !draining) {
+
+            draining = true;
+            gettimeofday(&sending_end, NULL);
+
+            struct timespec drain_deadline;
+            clock_gettime(CLOCK_MONOTONIC, &drain_deadline);
+            drain_deadline.tv_sec += timeout / 1000;
+            drain_deadline.tv_nsec += (timeout % 1000) * 1000000L;
+
+            if (drain_deadline.tv_nsec >= 1000000000L) {
+                drain_deadline.tv_sec++;
+                drain_deadline.tv_nsec -= 1000000000L;
+            }
+
+            if (EventLoop::arm_timer(timer_fd, drain_deadline, 0) < 0 
+                || event_loop.mod_fd(socket_fd, EPOLLIN) < 0)
+                return -1;
+        }
+
+        return 0;
+    };
+
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+
+    while (!done) {
+
+        int nr_events = event_loop.wait(events, EVENT_LOOP_MAX_EVENTS, -1);
+
+        if (nr_events < 0)
+            break;
+
+        for (int i = 0; i < nr_events && !done; i++) {
+
+            int fd = events[i].data.fd;
+
+            if (fd == signal_fd) {
+
+                EventLoop::read_signal(signal_fd);
+                done = true;
+
+            } else if (fd == timer_fd) {
+
+                if (EventLoop::read_timer(timer_fd) == 0)
+                    continue;
+
+                if (draining)
+                    done = true;
+                else if (send_probes() < 0)
+                    done = true;
+
+            } else if (fd == socket_fd) {
+
+                // e.g. icmp errors for our own probes, queued as socket 
+                // errors : clear them, the replies themselves are read below
+                if (events[i].events & EPOLLERR) {
+
+                    int err = 0;
+                    socklen_t err_len = sizeof(err);
+                    getsockopt(socket_fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+                }
+
+                if (events[i].events & EPOLLIN) {
+
+                    for (int read = 0; read < RECV_BUDGET; ) {
+
+                        int received = recv_ring.receive(socket_fd);
+
+                        if (received <= 0)
+                            break;
+
+                        for (int r = 0; r < received; r++) {
+
+                            struct pckt_timestamps recv_timestamp;
+                            get_recv_timestamp(recv_ring.get_msg(r), &recv_timestamp);
+
+                            sweep.process_reply(
+                                (char *) recv_ring.get_msg(r)->msg_iov->iov_base, 
+                                recv_ring.get_len(r), 
+                                (struct sockaddr_in *) recv_ring.get_msg(r)->msg_name, 
+                                &recv_timestamp.sw, quiet);
+                        }
+
+                        read += received;
+                    }
+                }
+
+                if ((events[i].events & EPOLLOUT) && send_probes() < 0)
+                    done = true;
+            }
+        }
+    }
+
+    gettimeofday(&end, NULL);
+
+    // interrupted before the end
+    if (!draining)
+        sending_end = end;
+
+    double elapsed = (sending_end.tv_sec - start.tv_sec) 
+        + (sending_end.tv_usec - start.tv_usec) / 1000000.0;
+
+    std::cout << "--- " << range << " sweep statistics ---" << std::endl;
+    std::cout << sweep.get_nr_sent() << " probes sent (" 
+        << sweep.get_nr_excluded() << " addresses excluded) in " << elapsed << " sec, " 
+        << (elapsed > 0.0 ? sweep.get_nr_sent() / elapsed : 0.0) << " pps" << std::endl;
+    std::cout << sweep.get_nr_alive() << " hosts alive, " 
+        << sweep.get_nr_unreachable() << " unreachable, " 
+        << sweep.get_nr_duplicates() << " duplicate replies, " 
+        << sweep.get_nr_invalid() << " w/ invalid cookies" << std::endl;
+
+    if (use_filter && ICMPFilter::get_icmp_in_msgs(icmp_in_msgs_end) == 0) {
+
+        std::cout << "pingy::run_sweep() : [INFO] kernel filter : " 
+            << recv_ring.get_nr_packets() << " packets delivered (" 
+            << (icmp_in_msgs_end - icmp_in_msgs_start) << " icmp packets received "\
+            "by the host)" << std::endl;
+    }
+
+    return 0;
+}
+
+// runs a pinger (see struct pinger) until its exit_fd is readable.
+// everything happens in a single thread, around an epoll event loop (see
+// event-loop.h). returns 0 on success, -1 on error.
+int run_pinger(struct pinger * p) {
+
+    const struct pinger_options * options = p->options;
+    TargetTable * targets = p->targets;
+    int raw_sckt_fd = p->socket_fd;
+
+    // one thread per core : w/ replies steered to the same core (e.g. by
+    // rss), nothing bounces between caches
+    if (p->cpu >= 0) {
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(p->cpu, &cpus);
+
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+        if (rc != 0) {
+
+            std::cerr << "pingy::run_pinger() : [WARNING] can't pin to cpu "
+                << p->cpu << ": " << strerror(rc) << std::endl;
+        }
+    }
+
+    // w/ the rx ring, replies are read from the ring only. the raw socket 
+    // still gets a copy of each one, which we'd never read : a filter which 
+    // drops everything keeps them from piling up in its receive queue.
+    if (p->rx_ring != NULL) {
+
+        if (p->rx_ring->setup(options->rx_ring_ifname, p->id_base, targets->size()) < 0
+            || ICMPFilter::attach_drop_filter(raw_sckt_fd) < 0)
+            return -1;            
+
+        p->filtered = true;
+    }
+
+    // the raw socket is only read or written when epoll says it's ready, and
+    // then until EAGAIN, so it must never block
+    int sckt_flags = fcntl(raw_sckt_fd, F_GETFL, 0);
+
+    if (sckt_flags < 0 || fcntl(raw_sckt_fd, F_SETFL, sckt_flags | O_NONBLOCK) < 0) {
+
+        std::cerr << "pingy::run_pinger() : [ERROR] error setting O_NONBLOCK: "
+            << strerror(errno) << std::endl;
+
+        return -1;              
+    }
+
+    EventLoop event_loop;
+
+    if (event_loop.add_fd(p->exit_fd, EPOLLIN) < 0)
+        return -1;              
+
+    // prepare the icmp ECHO packets for sending, once : probe i goes to 
+    // target i, and so gets its identifier (see TargetTable)
+    ICMPProbePool probes((int) targets->size(), ICMP_DATA_LEN + 8, ICMP_ECHO, 0, p->id_base);
+
+    // decides when each round of echo requests goes out
+    ProbeScheduler scheduler(options->schedule, options->interval, options->train_len);
 
-    int raw_sckt_fd = 0, recv_bytes = 0, rc = 0;
-    // icmp pckt to send
-    struct icmp * icmp_pckt = NULL;
     // structs used by the recvmsg() function. msghdr has an iovec attribute. 
     // iovec specifies a 'vector' of bytes in memory: its attributes are a base 
     // memory address and a number of bytes that follow.
@@ -293,54 +1052,8 @@ int main (int argc, char ** argv) {
     char ctrl_buffer[MAX_BUFFER_SIZE];
     // to hold the source address supplied to recvmsg()
     struct sockaddr recv_addr;
-    socklen_t recv_addr_len = 0; 
-    // addrinfo structs for hostname-to-ipv4 translation via getaddrinfo()
-    struct addrinfo hints, * answer;
-
-    raw_sckt_fd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
-
-    // following the lead of Steven's UNP, setuid(getuid()) gives up the 
-    // superuser privileges necessary to create RAW sockets. it is a good 
-    // practice to give up on superuser privileges as soon as these are not 
-    // necessary.
-    setuid(getuid());
 
-    // given the target hostname (e.g. google.com), extract its ip address 
-    // via getaddrinfo().
-    memset(&hints, 0, sizeof hints);
-    hints.ai_family = AF_INET;          // we're interested in ipv4 
-    hints.ai_socktype = SOCK_STREAM;    // tcp
-
-    if ((rc = getaddrinfo(hostname, SERVICE_HTTP, &hints, &answer)) != 0) {
-
-        // gai_error() translates a getaddrinfo() error code into 'english'
-        std::cerr << "pingy::main() : [ERROR] error while getting address "\
-            "of " << hostname << " (" << gai_strerror(rc) << ")" << std::endl;
-    }
-
-    // understand what's going on here? we want to translate a raw bit 
-    // representation of an ipv4 addr to its 'dotted-decimal' representation. 
-    // to do so, we use inet_ntoa(), which takes a sockaddr_in * as arg. 
-    // we get sockaddr_in * from the struct addrinfo * provided by 
-    // getaddrinfo(). struct addrinfo has one sockaddr * attribute, which can 
-    // be typecast to sockaddr_in * in this case, since we're dealing with 
-    // AF_INET family addresses.
-    std::cout << "pingy::main() : [INFO] " << hostname << " translated to IPv4 addr "\
-         << inet_ntoa(((struct sockaddr_in *) answer->ai_addr)->sin_addr) << std::endl;
-
-    // prepare the base icmp ECHO packet for sending
-    icmp_pckt = prepare_icmp_pckt(ICMP_ECHO, 0);
-
-    // start sending ping requests to hostname, using C++11's threads
-    std::thread icmp_msg_sender(
-        send_icmp_echo,     // the function to be called by the thread
-        1,                  // std::thread() accepts as many args as you want! 
-        raw_sckt_fd,
-        icmp_pckt,
-        answer->ai_addr,
-        answer->ai_addrlen);
-
-    // ECHO responses will start coming back now. initialize recv_msg and 
+    // ECHO responses will be read into recv_buffer. initialize recv_msg and 
     // recv_iovec structs:
     //  -# iovec's base addr & size are initialized to recv_buffer
     //  -# msg_name (which is void *) is set to the generic sockaddr pointer 
@@ -348,53 +1061,881 @@ int main (int argc, char ** argv) {
     recv_iovec.iov_base = recv_buffer;
     recv_iovec.iov_len = sizeof(recv_buffer);
 
+    memset(&recv_msg, 0, sizeof(recv_msg));
     recv_msg.msg_name = &recv_addr;
     recv_msg.msg_iov = &recv_iovec;
     recv_msg.msg_iovlen = 1;
     recv_msg.msg_control = ctrl_buffer;
 
-    // we take note of the reception timestamp, compare it to that carried 
-    // by the ECHO's payload, which should contain the 'send time' timestamps
-    struct timeval recv_timestamp;
+    if (TimestampUtils::enable_rx_timestamps(raw_sckt_fd) < 0) {
 
-    while (1) {
+        std::cerr << "pingy::run_pinger() : [WARNING] no kernel rx timestamps. "\
+            "rtts will include user-space receive delays." << std::endl;
+    }
 
-        recv_msg.msg_namelen = recv_addr_len;
-        recv_msg.msg_controllen = sizeof(ctrl_buffer);
+    // likewise for the send side : w/ kernel tx timestamps, rtt = rx kernel 
+    // timestamp - tx kernel timestamp, matched by target and seq
+    TxTimestampTable * tx_stamps = NULL;
 
-        recv_bytes = recvmsg(raw_sckt_fd, &recv_msg, 0);
+    if (strlen(options->tx_timestamps)) {
 
-        if (recv_bytes < 0) {
+        bool hardware = (strcmp(options->tx_timestamps, "hw") == 0);
 
-            // EINTR means 'interrupted function call', i.e. an asynchronous 
-            // signal occurred and prevented completion of recvmsg(). that's 
-            // we hit continue and call recvmsg() again.
-            if (errno == EINTR) {
+        if (TimestampUtils::enable_tx_timestamps(raw_sckt_fd, hardware) == 0)
+            tx_stamps = new TxTimestampTable(targets->size());
+    }
 
-                continue;
+    struct reply_context & reply_ctx = p->reply_ctx;
+    reply_ctx.targets = targets;
+    reply_ctx.tx_stamps = tx_stamps;
+    reply_ctx.dns_cache = options->dns_cache;
+    reply_ctx.quiet = options->quiet;
+    reply_ctx.timeout_nsec = (int64_t) options->timeout * 1000000LL;
+    reply_ctx.delivered = 0;
 
-            } else {
+    // every echo request gets a timeout, kept in a timing wheel (see 
+    // timing-wheel.h) which is moved along by a periodic timerfd
+    p->timeouts = new TimingWheel(MAX_TIMEOUTS, (uint64_t) TIMEOUT_TICK * 1000);
+    TimingWheel & timeouts = *p->timeouts;
+    reply_ctx.timeouts = p->timeouts;
 
-                std::cerr << "pingy::main() : [ERROR] error in recvmsg(): " 
-                    << strerror(errno) << std::endl;
+    // the io_uring backend, if asked for (and available). it takes over both 
+    // the send and receive paths : the socket is then only watched for tx 
+    // timestamps, and replies come in through the ring's eventfd.
+    UringBackend * uring = NULL;
 
-                break;
-            }
+    if (strcmp(options->io_backend, "uring") == 0) {
 
-        } else {
+        uring = new UringBackend(raw_sckt_fd, handle_uring_reply, &reply_ctx);
+
+        if (uring->init() < 0) {
+
+            std::cerr << "pingy::run_pinger() : [WARNING] io_uring not available. "\
+                "falling back to syscalls." << std::endl;
 
-            // gather the reception timestamp (now)
-            gettimeofday(&recv_timestamp, NULL);
-            proccess_icmp_ipv4_reply(recv_bytes, &recv_msg, &recv_timestamp);
+            delete uring;
+            uring = NULL;
         }
     }
 
-    // join the icmp_msg_sender thread with the main thread
-    icmp_msg_sender.join();
+    p->uring = uring;
+
+    // batched receive mode: replies are drained from the socket up to 
+    // recv_batch at a time, w/ a single recvmmsg() call into a preallocated 
+    // ring of msghdrs (see recv-ring.h). the io_uring backend batches 
+    // receives on its own.
+    RecvRing * recv_ring = NULL;
+    if (options->recv_batch > 1 && uring == NULL)
+        recv_ring = new RecvRing(options->recv_batch);
+
+    p->recv_ring = recv_ring;
+
+    // the socket is watched for replies (EPOLLIN) and tx timestamps, which 
+    // are queued on its error queue (flagged by EPOLLERR). in flood mode, 
+    // there's no send deadline : a new burst goes out whenever there's room 
+    // in the send buffer (EPOLLOUT), or, w/ io_uring, whenever earlier sends 
+    // complete.
+    EchoBurst * burst = NULL;
+    size_t next_target = 0;
+    int burst_size = options->burst_size;
+    bool flood = (burst_size > 0);
+
+    if (flood && uring == NULL) {
+
+        burst = new EchoBurst(burst_size, probes.get(0), probes.get_pckt_len());
+        burst->set_timeouts(&timeouts, (uint64_t) reply_ctx.timeout_nsec);
+    }
+
+    p->burst = burst;
+
+    if (uring != NULL) {
+
+        // EPOLLERR is always reported, even w/ no events asked for
+        if (event_loop.add_fd(raw_sckt_fd, 0) < 0 
+            || event_loop.add_fd(uring->get_event_fd(), EPOLLIN) < 0)
+            return -1;            
+
+    } else {
+
+        if (event_loop.add_fd(raw_sckt_fd, EPOLLIN | (flood ? EPOLLOUT : 0)) < 0)
+            return -1;            
+    }
+
+    PacketRing * rx_ring = p->rx_ring;
+
+    if (rx_ring != NULL && event_loop.add_fd(rx_ring->get_fd(), EPOLLIN) < 0)
+        return -1;              
+
+    // otherwise, a timerfd fires at each of the scheduler's (absolute) 
+    // deadlines. as w/ clock_nanosleep() before, the time it takes to send a 
+    // round doesn't add up as drift.
+    int send_timer_fd = -1;
+
+    if (!flood) {
+
+        if ((send_timer_fd = event_loop.add_timer()) < 0 
+            || EventLoop::arm_timer(send_timer_fd, scheduler.get_next_deadline(), 0) < 0)
+            return -1;            
+    }
+
+    int timeout_timer_fd = -1;
+    struct timespec first_tick;
+    clock_gettime(CLOCK_MONOTONIC, &first_tick);
+
+    if ((timeout_timer_fd = event_loop.add_timer()) < 0 
+        || EventLoop::arm_timer(timeout_timer_fd, first_tick, TIMEOUT_TICK) < 0)
+        return -1;              
+
+    // periodic reports get a timerfd of their own
+    int report_timer_fd = -1;
+
+    if (options->report_interval > 0) {
+
+        struct timespec first_report;
+        clock_gettime(CLOCK_MONOTONIC, &first_report);
+        first_report.tv_sec += options->report_interval;
+
+        if ((report_timer_fd = event_loop.add_timer()) < 0 
+            || EventLoop::arm_timer(
+                report_timer_fd, first_report, (uint64_t) options->report_interval * 1000000) < 0)
+            return -1;            
+    }
+
+    // flood mode w/ io_uring : queues up to burst_size echo requests 
+    // (round-robin over the targets, as EchoBurst does), as long as there 
+    // are free send slots, and submits them all at once
+    auto uring_flood = [&] () {
+
+        for (int n = 0; n < burst_size && uring->get_free_send_slots() > 0; n++) {
+
+            send_icmp_echo(raw_sckt_fd, &probes, targets->get(next_target), uring, &reply_ctx);
+            next_target = (next_target + 1) % targets->size();
+        }
+
+        return uring->submit();
+    };
+
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+
+    // the 1st flood of sends. the following ones are triggered by their 
+    // completions.
+    if (flood && uring != NULL && uring_flood() < 0)
+        return -1;              
+
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    bool done = false;
+
+    while (!done) {
+
+        int nr_events = event_loop.wait(events, EVENT_LOOP_MAX_EVENTS, -1);
+
+        if (nr_events < 0)
+            break;
+
+        for (int i = 0; i < nr_events && !done; i++) {
+
+            int fd = events[i].data.fd;
+
+            if (fd == p->exit_fd) {
+
+                if (!p->exit_on_signal || EventLoop::read_signal(p->exit_fd) > 0)
+                    done = true;
+
+            } else if (fd == send_timer_fd) {
+
+                EventLoop::read_timer(send_timer_fd);
+
+                // send all rounds whose deadline has passed : more than one 
+                // if we're late (we catch up, the schedule isn't shifted), or 
+                // for back-to-back rounds (e.g. trains w/ --schedule burst). 
+                // at most MAX_ROUNDS_PER_EVENT at a time, so that a very short 
+                // interval can't starve the receive side.
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+
+                for (int rounds = 0; 
+                    rounds < MAX_ROUNDS_PER_EVENT 
+                    && TimestampUtils::ts_sub_nsec(&now, &scheduler.get_next_deadline()) >= 0; 
+                    rounds++) {
+
+                    // one round of echo requests, one per target, all 
+                    // through the same raw socket
+                    for (size_t t = 0; t < targets->size(); t++)
+                        send_icmp_echo(raw_sckt_fd, &probes, targets->get(t), uring, &reply_ctx);
+
+                    scheduler.advance();
+                }
+
+                // w/ io_uring, all the rounds above go out w/ a single 
+                // io_uring_enter()
+                if (uring != NULL && uring->submit() < 0)
+                    done = true;
+
+                if (EventLoop::arm_timer(send_timer_fd, scheduler.get_next_deadline(), 0) < 0)
+                    done = true;
 
-    // all the storage returned by getaddrinfo() are allocated dynamically 
-    // (i.e. w/ malloc()). so one must free it w/ freeaddrinfo()
-    freeaddrinfo(answer);
+            } else if (fd == timeout_timer_fd) {
+
+                EventLoop::read_timer(timeout_timer_fd);
+                timeouts.advance(handle_timeout, &reply_ctx);
+
+            } else if (fd == report_timer_fd) {
+
+                EventLoop::read_timer(report_timer_fd);
+
+                pthread_mutex_lock(&print_lock);
+                print_rtt_stats(targets);
+                pthread_mutex_unlock(&print_lock);
+
+            } else if (uring != NULL && fd == uring->get_event_fd()) {
+
+                // the eventfd only says 'there are completions' : reset it, 
+                // then reap them all
+                uint64_t nr_signals = 0;
+                if (read(fd, &nr_signals, sizeof(nr_signals)) < 0 && errno != EAGAIN)
+                    done = true;
+
+                if (uring->reap() < 0)
+                    done = true;
+
+                if (flood && !done && uring_flood() < 0)
+                    done = true;
+
+            } else if (rx_ring != NULL && fd == rx_ring->get_fd()) {
+
+                if (rx_ring->receive(handle_ring_reply, &reply_ctx) < 0)
+                    done = true;
+
+            } else if (fd == raw_sckt_fd) {
+
+                // read tx timestamps before the replies, so that they're 
+                // available when the replies are processed
+                if (events[i].events & EPOLLERR) {
+
+                    if (tx_stamps != NULL) {
+
+                        read_tx_timestamps(raw_sckt_fd, targets, tx_stamps);
+
+                    } else {
+
+                        // a pending socket error would be reported forever 
+                        // (epoll is level-triggered). reading it clears it.
+                        int sckt_error = 0;
+                        socklen_t sckt_error_len = sizeof(sckt_error);
+                        getsockopt(raw_sckt_fd, SOL_SOCKET, SO_ERROR, &sckt_error, &sckt_error_len);
+                    }
+                }
+
+                if ((events[i].events & EPOLLIN) 
+                    && receive_replies(raw_sckt_fd, recv_ring, &recv_msg, &reply_ctx) < 0)
+                    done = true;
+
+                if ((events[i].events & EPOLLOUT) 
+                    && burst->send(raw_sckt_fd, targets, next_target) < 0)
+                    done = true;
+            }
+        }
+    }
+
+    gettimeofday(&end, NULL);
+    p->elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+
+    // the replies are all in : the kernel timestamps of their requests are
+    // no longer needed
+    if (tx_stamps != NULL)
+        delete tx_stamps;
+
+    reply_ctx.tx_stamps = NULL;
 
     return 0;
-}
\ No newline at end of file
+}
+
+// a pinger's thread (see --threads). whatever ends the pinger (an error, 
+// or main() telling it to) ends the others too.
+void * pinger_thread(void * arg) {
+
+    struct pinger * p = (struct pinger *) arg;
+    p->rc = run_pinger(p);
+
+    uint64_t one = 1;
+
+    if (write(p->exit_fd, &one, sizeof(one)) < 0) {
+
+        std::cerr << "pingy::pinger_thread() : [ERROR] error stopping the "\
+            "other pingers: " << strerror(errno) << std::endl;
+    }
+
+    return NULL;
+}
+
+int main (int argc, char ** argv) {
+
+    char hostname[MAX_STRING_SIZE] = "";
+    char targets_file[MAX_STRING_SIZE] = "";
+    int recv_batch = 0;
+    int burst_size = 0;
+    uint64_t interval = DEFAULT_INTERVAL;
+    int schedule = SCHEDULE_FIXED;
+    int train_len = 1;
+    char tx_timestamps[MAX_STRING_SIZE] = "";
+    bool quiet = false;
+    int report_interval = 0;
+    int timeout = DEFAULT_TIMEOUT;
+    bool use_filter = true;
+    char io_backend[MAX_STRING_SIZE] = "syscalls";
+    char rx_ring_ifname[MAX_STRING_SIZE] = "";
+    char sweep_range[MAX_STRING_SIZE] = "";
+    char exclude_file[MAX_STRING_SIZE] = "";
+    uint64_t rate = DEFAULT_SWEEP_RATE;
+    int nr_threads = 1;
+
+    ArgvParser * arg_parser = create_argv_parser();
+    int parse_result = arg_parser->parse(argc, argv);
+
+    if (parse_result != ArgvParser::NoParserError) {
+
+        std::cerr << arg_parser->parseErrorDescription(parse_result).c_str() << std::endl;
+        std::cerr << "pingy::main() : [ERROR] use option -h for help." << std::endl;
+
+        delete arg_parser;
+        return -1;              
+
+    } else if (parse_result == ArgvParser::ParserHelpRequested) {
+
+        delete arg_parser;
+        return -1;              
+
+    } else {
+
+        if (arg_parser->foundOption(OPTION_HOSTNAME))
+            strncpy(hostname, (char *) arg_parser->optionValue(OPTION_HOSTNAME).c_str(), MAX_STRING_SIZE);
+
+        if (arg_parser->foundOption(OPTION_TARGETS))
+            strncpy(targets_file, (char *) arg_parser->optionValue(OPTION_TARGETS).c_str(), MAX_STRING_SIZE);
+
+        if (arg_parser->foundOption(OPTION_RECV_BATCH))
+            recv_batch = atoi(arg_parser->optionValue(OPTION_RECV_BATCH).c_str());
+
+        if (arg_parser->foundOption(OPTION_BURST))
+            burst_size = atoi(arg_parser->optionValue(OPTION_BURST).c_str());
+
+        if (arg_parser->foundOption(OPTION_INTERVAL))
+            interval = strtoull(arg_parser->optionValue(OPTION_INTERVAL).c_str(), NULL, 10);
+
+        if (arg_parser->foundOption(OPTION_TX_TIMESTAMPS))
+            strncpy(tx_timestamps, (char *) arg_parser->optionValue(OPTION_TX_TIMESTAMPS).c_str(), MAX_STRING_SIZE);
+
+        if (arg_parser->foundOption(OPTION_QUIET))
+            quiet = true;
+
+        if (arg_parser->foundOption(OPTION_REPORT_INTERVAL))
+            report_interval = atoi(arg_parser->optionValue(OPTION_REPORT_INTERVAL).c_str());
+
+        if (arg_parser->foundOption(OPTION_IO_BACKEND))
+            strncpy(io_backend, (char *) arg_parser->optionValue(OPTION_IO_BACKEND).c_str(), MAX_STRING_SIZE - 1);
+
+        if (arg_parser->foundOption(OPTION_RX_RING))
+            strncpy(rx_ring_ifname, (char *) arg_parser->optionValue(OPTION_RX_RING).c_str(), MAX_STRING_SIZE - 1);
+
+        if (arg_parser->foundOption(OPTION_NO_FILTER))
+            use_filter = false;
+
+        if (arg_parser->foundOption(OPTION_SWEEP))
+            strncpy(sweep_range, (char *) arg_parser->optionValue(OPTION_SWEEP).c_str(), MAX_STRING_SIZE - 1);
+
+        if (arg_parser->foundOption(OPTION_EXCLUDE))
+            strncpy(exclude_file, (char *) arg_parser->optionValue(OPTION_EXCLUDE).c_str(), MAX_STRING_SIZE - 1);
+
+        if (arg_parser->foundOption(OPTION_RATE))
+            rate = strtoull(arg_parser->optionValue(OPTION_RATE).c_str(), NULL, 10);
+
+        if (arg_parser->foundOption(OPTION_TIMEOUT))
+            timeout = atoi(arg_parser->optionValue(OPTION_TIMEOUT).c_str());
+
+        if (arg_parser->foundOption(OPTION_TRAIN))
+            train_len = atoi(arg_parser->optionValue(OPTION_TRAIN).c_str());
+
+        if (arg_parser->foundOption(OPTION_THREADS))
+            nr_threads = atoi(arg_parser->optionValue(OPTION_THREADS).c_str());
+
+        if (arg_parser->foundOption(OPTION_SCHEDULE)) {
+
+            if ((schedule = ProbeScheduler::parse_pattern(arg_parser->optionValue(OPTION_SCHEDULE).c_str())) < 0) {
+
+                std::cerr << "pingy::main() : [ERROR] unknown schedule '" 
+                    << arg_parser->optionValue(OPTION_SCHEDULE) << "'. use option -h "\
+                    "for help." << std::endl;
+
+                delete arg_parser;
+                return -1;
+            }
+        }
+    }
+
+    delete arg_parser;
+
+    if (strcmp(io_backend, "syscalls") != 0 && strcmp(io_backend, "uring") != 0) {
+
+        std::cerr << "pingy::main() : [ERROR] unknown io backend '" 
+            << io_backend << "'. use option -h for help." << std::endl;
+
+        return -1;              
+    }
+
+    if (strlen(tx_timestamps) && strcmp(tx_timestamps, "sw") != 0 && strcmp(tx_timestamps, "hw") != 0) {
+
+        std::cerr << "pingy::main() : [ERROR] unknown tx timestamp type '" 
+            << tx_timestamps << "'. use option -h for help." << std::endl;
+
+        return -1;              
+    }
+
+    // a sweep runs in a single thread, whatever --threads says
+    if (strlen(sweep_range))
+        nr_threads = 1;
+
+    if (nr_threads < 1 || (nr_threads > 1 && strlen(rx_ring_ifname))) {
+
+        std::cerr << "pingy::main() : [ERROR] invalid nr. of threads (" 
+            << nr_threads << "). --" << OPTION_THREADS << " must be at least 1, "\
+            "and 1 w/ --" << OPTION_RX_RING << ". use option -h for help." << std::endl;
+
+        return -1;              
+    }
+
+    if (!strlen(hostname) && !strlen(targets_file) && !strlen(sweep_range)) {
+
+        std::cerr << "pingy::main() : [ERROR] either --" << OPTION_HOSTNAME 
+            << ", --" << OPTION_TARGETS << " or --" << OPTION_SWEEP << " must "\
+            "be given. use option -h for help." << std::endl;
+
+        return -1;              
+    }
+
+    // a raw socket per pinger (see struct pinger), opened while we still
+    // have the privileges to
+    std::vector<int> raw_sckt_fds(nr_threads, -1);
+
+    for (int i = 0; i < nr_threads; i++) {
+
+        if ((raw_sckt_fds[i] = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP)) < 0) {
+
+            std::cerr << "pingy::main() : [ERROR] error opening raw socket: "
+                << strerror(errno) << std::endl;
+
+            return -1;            
+        }
+    }
+
+    int raw_sckt_fd = raw_sckt_fds[0];
+    // the list of targets to ping. each target is assigned an icmp 
+    // identifier, starting at our pid.
+    uint16_t id_base = (uint16_t) (getpid() & 0xFFFF);
+    TargetTable targets(id_base);
+
+    // the packet socket of the rx ring needs superuser privileges too, so it 
+    // must be created now. the ring itself is set up once the targets (and 
+    // so the identifiers for its filter) are known.
+    PacketRing * rx_ring = NULL;
+
+    if (strlen(rx_ring_ifname) && !strlen(sweep_range)) {
+
+        rx_ring = new PacketRing();
+
+        if (rx_ring->open_socket() < 0)
+            return -1;            
+    }
+
+    // following the lead of Steven's UNP, setuid(getuid()) gives up the 
+    // superuser privileges necessary to create RAW sockets. it is a good 
+    // practice to give up on superuser privileges as soon as these are not 
+    // necessary.
+    setuid(getuid());
+
+    if (strlen(sweep_range))
+        return run_sweep(raw_sckt_fd, sweep_range, exclude_file, rate, timeout, quiet, use_filter);
+
+    // given the target hostname (e.g. google.com), extract its ip address. 
+    // TargetTable::add_target() does it via getaddrinfo(), unless hostname 
+    // is already in dotted-decimal form.
+    if (strlen(hostname)) {
+
+        if (targets.add_target(hostname) < 0)
+            return -1;            
+
+        // understand what's going on here? we want to translate a raw bit 
+        // representation of an ipv4 addr to its 'dotted-decimal' 
+        // representation. to do so, we use inet_ntoa(), which takes a 
+        // struct in_addr as arg, here taken from the target's sockaddr_in.
+        std::cout << "pingy::main() : [INFO] " << hostname << " translated to IPv4 addr "\
+             << inet_ntoa(targets.get(0)->addr.sin_addr) << std::endl;
+    }
+
+    // multi-target mode: all targets listed in targets_file are added to the 
+    // same table (and pinged from the same raw socket)
+    if (strlen(targets_file)) {
+
+        int added = targets.load_targets(targets_file);
+
+        if (added < 0)
+            return -1;            
+
+        std::cout << "pingy::main() : [INFO] loaded " << added << " targets "\
+            "from " << targets_file << std::endl;
+    }
+
+    if (targets.size() == 0) {
+
+        std::cerr << "pingy::main() : [ERROR] no targets to ping." << std::endl;
+        return -1;              
+    }
+
+    // each pinger needs a target at least
+    if ((size_t) nr_threads > targets.size()) {
+
+        std::cerr << "pingy::main() : [WARNING] only " << targets.size()
+            << " targets : running " << targets.size() << " threads." << std::endl;
+
+        for (int i = (int) targets.size(); i < nr_threads; i++)
+            close(raw_sckt_fds[i]);
+
+        nr_threads = (int) targets.size();
+    }
+
+    // catch SIGINT (CTRL+C) and SIGTERM, so that we can leave the event loop 
+    // gracefully and print a summary. w/ a signalfd, these arrive as events, 
+    // in between the others, rather than interrupting whatever syscall 
+    // happens to be running. this must come before any thread is created
+    // (incl. the dns cache's), so that the signals are blocked in all of
+    // them.
+    EventLoop event_loop;
+    int exit_signals[] = { SIGINT, SIGTERM };
+    int signal_fd = event_loop.add_signals(exit_signals, 2);
+
+    if (signal_fd < 0)
+        return -1;              
+
+    // reverse dns lookups of the repliers' addresses, done in the background.
+    // the cache is thread-safe, so all pingers share it.
+    DnsCache dns_cache(DNS_CACHE_SIZE);
+
+    struct pinger_options options;
+    options.recv_batch = recv_batch;
+    options.burst_size = burst_size;
+    options.interval = interval;
+    options.schedule = schedule;
+    options.train_len = train_len;
+    options.tx_timestamps = tx_timestamps;
+    options.quiet = quiet;
+    options.report_interval = report_interval;
+    options.timeout = timeout;
+    options.use_filter = use_filter;
+    options.io_backend = io_backend;
+    options.rx_ring_ifname = rx_ring_ifname;
+    options.dns_cache = &dns_cache;
+
+    // w/ more than one pinger, main() only waits for a signal, and then
+    // tells the pingers to stop through exit_fd (see struct pinger)
+    int exit_fd = signal_fd;
+
+    if (nr_threads > 1) {
+
+        if ((exit_fd = eventfd(0, EFD_NONBLOCK)) < 0
+            || event_loop.add_fd(exit_fd, EPOLLIN) < 0) {
+
+            std::cerr << "pingy::main() : [ERROR] error creating eventfd: "
+                << strerror(errno) << std::endl;
+
+            return -1;            
+        }
+    }
+
+    // the targets are split into nr_threads slices (of sizes which differ
+    // by 1 at most), one per pinger. a slice keeps the targets' identifiers,
+    // so its id_base is that of its 1st target.
+    std::vector<struct pinger> pingers(nr_threads);
+    long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (nr_threads > 1 && nr_threads > nr_cpus) {
+
+        std::cerr << "pingy::main() : [WARNING] " << nr_threads << " threads for "
+            << nr_cpus << " cpus : some will share a cpu." << std::endl;
+    }
+
+    for (int i = 0, first = 0; i < nr_threads; i++) {
+
+        int slice = (int) (targets.size() / nr_threads)
+            + (i < (int) (targets.size() % nr_threads) ? 1 : 0);
+
+        struct pinger & p = pingers[i];
+        p.options = &options;
+        p.socket_fd = raw_sckt_fds[i];
+        p.id_base = (uint16_t) (id_base + first);
+        p.targets = new TargetTable(p.id_base);
+        p.cpu = (nr_threads > 1 && nr_cpus > 0 ? (int) (i % nr_cpus) : -1);
+        p.exit_fd = exit_fd;
+        p.exit_on_signal = (nr_threads == 1);
+        p.rx_ring = (i == 0 ? rx_ring : NULL);
+        p.reply_ctx.delivered = 0;
+        p.timeouts = NULL;
+        p.uring = NULL;
+        p.recv_ring = NULL;
+        p.burst = NULL;
+        p.elapsed = 0.0;
+        p.rc = 0;
+
+        for (int t = first; t < first + slice; t++)
+            p.targets->add_target(targets.get(t)->hostname, targets.get(t)->addr.sin_addr);
+
+        first += slice;
+
+        // let the kernel drop icmp packets which aren't for this pinger (e.g. 
+        // replies to other ping processes, or to the other pingers), before 
+        // they're queued on its socket. the filter checks the icmp identifiers 
+        // of its targets. all filters are in place before any pinger sends.
+        p.filtered = use_filter;
+
+        if (p.filtered
+            && ICMPFilter::attach_echo_filter(p.socket_fd, p.id_base, p.targets->size()) < 0) {
+
+            std::cerr << "pingy::main() : [WARNING] running w/o the kernel "\
+                "filter." << std::endl;
+
+            p.filtered = false;
+        }
+    }
+
+    // the kernel doesn't count what the filters drop : we estimate it from
+    // the host-wide icmp counter (see below)
+    uint64_t icmp_in_msgs_start = 0, icmp_in_msgs_end = 0;
+
+    if (use_filter || rx_ring != NULL)
+        ICMPFilter::get_icmp_in_msgs(icmp_in_msgs_start);
+
+    int rc = 0;
+
+    if (nr_threads == 1) {
+
+        // a single pinger runs right here
+        rc = run_pinger(&pingers[0]);
+
+    } else {
+
+        std::cout << "pingy::main() : [INFO] " << nr_threads << " threads, "
+            << targets.size() << " targets (" << pingers[0].targets->size()
+            << " per thread)" << std::endl;
+
+        std::vector<pthread_t> threads(nr_threads);
+        int nr_started = 0;
+
+        for ( ; nr_started < nr_threads; nr_started++) {
+
+            int err = pthread_create(&threads[nr_started], NULL, pinger_thread, &pingers[nr_started]);
+
+            if (err != 0) {
+
+                std::cerr << "pingy::main() : [ERROR] error creating thread: "
+                    << strerror(err) << std::endl;
+
+                rc = -1;
+                break;
+            }
+        }
+
+        // wait for a signal, or for a pinger to stop on its own (i.e. on an
+        // error). either way, all of them are stopped.
+        struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+        bool done = (rc < 0);
+
+        while (!done) {
+
+            int nr_events = event_loop.wait(events, EVENT_LOOP_MAX_EVENTS, -1);
+
+            if (nr_events < 0)
+                break;
+
+            for (int i = 0; i < nr_events; i++) {
+
+                if (events[i].data.fd == exit_fd
+                    || EventLoop::read_signal(signal_fd) > 0)
+                    done = true;
+            }
+        }
+
+        uint64_t one = 1;
+
+        if (write(exit_fd, &one, sizeof(one)) < 0) {
+
+            std::cerr << "pingy::main() : [ERROR] error stopping the pingers: "
+                << strerror(errno) << std::endl;
+        }
+
+        for (int i = 0; i < nr_started; i++) {
+
+            pthread_join(threads[i], NULL);
+
+            if (pingers[i].rc < 0)
+                rc = -1;
+        }
+
+        close(exit_fd);
+    }
+
+    if (rc < 0)
+        return -1;              
+
+    // the report, merged over all pingers
+    uint64_t nr_burst_sent = 0, nr_bursts = 0;
+    uint64_t nr_expired = 0, nr_cancelled = 0, nr_pending = 0, timer_slab_size = 0;
+    uint64_t delivered = 0;
+    uint64_t nr_recv_batches = 0, nr_recv_packets = 0;
+    uint64_t nr_uring_sent = 0, nr_uring_received = 0, nr_uring_enters = 0;
+    bool filtered = true;
+    double elapsed = 0.0;
+    EchoBurst * burst = NULL;
+    RecvRing * recv_ring = NULL;
+    UringBackend * uring = NULL;
+
+    for (int i = 0; i < nr_threads; i++) {
+
+        struct pinger & p = pingers[i];
+
+        // the pingers run side by side : the longest one is the run's length
+        elapsed = std::max(elapsed, p.elapsed);
+        delivered += p.reply_ctx.delivered;
+        filtered = filtered && p.filtered;
+
+        if (p.burst != NULL) {
+
+            nr_burst_sent += p.burst->get_nr_sent();
+            nr_bursts += p.burst->get_nr_bursts();
+            burst = p.burst;
+        }
+
+        if (p.timeouts != NULL) {
+
+            nr_expired += p.timeouts->get_nr_expired();
+            nr_cancelled += p.timeouts->get_nr_cancelled();
+            nr_pending += p.timeouts->size();
+            timer_slab_size += p.timeouts->get_slab_size();
+        }
+
+        if (p.recv_ring != NULL) {
+
+            nr_recv_batches += p.recv_ring->get_nr_batches();
+            nr_recv_packets += p.recv_ring->get_nr_packets();
+            recv_ring = p.recv_ring;
+        }
+
+        if (p.uring != NULL) {
+
+            nr_uring_sent += p.uring->get_nr_sent();
+            nr_uring_received += p.uring->get_nr_received();
+            nr_uring_enters += p.uring->get_nr_enters();
+            uring = p.uring;
+        }
+    }
+
+    if (burst != NULL) {
+
+        std::cout << "pingy::main() : [INFO] sent " 
+            << nr_burst_sent << " echo requests in "
+            << nr_bursts << " bursts (" << elapsed << " sec, "
+            << (elapsed > 0.0 ? nr_burst_sent / elapsed : 0.0) << " pps)" << std::endl;
+    }
+
+    for (int i = 0; i < nr_threads; i++)
+        print_rtt_stats(pingers[i].targets);
+
+    std::cout << "pingy::main() : [INFO] timeouts : " 
+        << nr_expired << " expired, "
+        << nr_cancelled << " cancelled by replies, "
+        << nr_pending << " pending at exit ("
+        << timer_slab_size / 1024 << " kB of timers)" << std::endl;
+
+    // the kernel doesn't tell us how many packets the filter dropped, so we 
+    // estimate it from the host-wide icmp counter
+    if (filtered && ICMPFilter::get_icmp_in_msgs(icmp_in_msgs_end) == 0) {
+
+        uint64_t host_icmp = icmp_in_msgs_end - icmp_in_msgs_start;
+
+        std::cout << "pingy::main() : [INFO] kernel filter : " 
+            << delivered << " packets delivered, ~"
+            << (host_icmp > delivered ? host_icmp - delivered : 0)
+            << " filtered out (" << host_icmp << " icmp packets received by "\
+            "the host)" << std::endl;
+    }
+
+    if (recv_ring != NULL) {
+
+        std::cout << "pingy::main() : [INFO] recvmmsg() batches : " 
+            << nr_recv_batches << ", packets : "
+            << nr_recv_packets << ", avg. batch size : "
+            << (nr_recv_batches > 0 ? (double) nr_recv_packets / nr_recv_batches : 0.0)
+            << " (max. " << recv_ring->get_slots() << ")" << std::endl;
+    }
+
+    if (rx_ring != NULL) {
+
+        uint64_t nr_blocks = rx_ring->get_nr_blocks();
+
+        std::cout << "pingy::main() : [INFO] rx ring : " 
+            << rx_ring->get_nr_packets() << " packets in " << nr_blocks 
+            << " blocks (avg. " 
+            << (nr_blocks > 0 ? (double) rx_ring->get_nr_packets() / nr_blocks : 0.0) 
+            << " per block), " << rx_ring->get_drops() << " dropped by the "\
+            "kernel (ring full)" << std::endl;
+
+        delete rx_ring;
+    }
+
+    const char * io_backend_used = (uring != NULL ? "uring" : "syscalls");
+
+    if (uring != NULL) {
+
+        std::cout << "pingy::main() : [INFO] io_uring : " 
+            << nr_uring_sent << " packets sent, "
+            << nr_uring_received << " received, w/ "
+            << nr_uring_enters << " io_uring_enter() calls" << std::endl;
+    }
+
+    // to compare io backends (or receive modes) : packet rate and cpu time 
+    // (user + system, all threads) per packet, sent or received
+    uint64_t nr_sent = 0;
+    for (int i = 0; i < nr_threads; i++) {
+        for (size_t t = 0; t < pingers[i].targets->size(); t++)
+            nr_sent += pingers[i].targets->get(t)->sent;
+    }
+
+    uint64_t nr_pckts = nr_sent + delivered;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu_usec = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000.0 
+        + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+
+    std::cout << "pingy::main() : [INFO] io backend : " 
+        << io_backend_used << ", " 
+        << nr_pckts << " packets (sent + received) in " << elapsed << " sec, " 
+        << (elapsed > 0.0 ? nr_pckts / elapsed : 0.0) << " pps, " 
+        << (nr_pckts > 0 ? cpu_usec / nr_pckts : 0.0) << " usec of cpu per packet" 
+        << std::endl;
+
+    ICMPProbePool::print_alloc_stats();
+
+    for (int i = 0; i < nr_threads; i++) {
+
+        struct pinger & p = pingers[i];
+
+        delete p.burst;
+        delete p.recv_ring;
+        delete p.uring;
+        delete p.timeouts;
+        delete p.targets;
+
+        close(p.socket_fd);
+    }
+
+    return 0;
+}
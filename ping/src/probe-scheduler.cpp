@@ -0,0 +1,74 @@
+#include <string.h>
+
+#include "probe-scheduler.h"
+
+// adds usec microseconds to an absolute timespec, keeping tv_nsec in 
+// [0, 10^9)
+static void ts_add_usec(struct timespec * ts, uint64_t usec) {
+
+    ts->tv_sec += usec / 1000000;
+    ts->tv_nsec += (usec % 1000000) * 1000;
+
+    if (ts->tv_nsec >= 1000000000) {
+
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+ProbeScheduler::ProbeScheduler(int pattern, uint64_t interval_usec, int train_len)
+    : pattern(pattern), interval_usec(interval_usec),
+      train_len(train_len > 0 ? train_len : 1), train_pos(0),
+      rng(std::random_device()()),
+      // std::exponential_distribution takes the rate, i.e. 1 / mean
+      exp_gap(1.0 / (interval_usec > 0 ? (double) interval_usec : 1.0)) {
+
+    // the 1st tick fires right away
+    clock_gettime(CLOCK_MONOTONIC, &next_deadline);
+}
+
+void ProbeScheduler::advance() {
+
+    switch (pattern) {
+
+        case SCHEDULE_POISSON:
+
+            // RFC 2330, section 11.1.1 : poisson sampling avoids synchronizing 
+            // w/ periodic network behavior, and makes the sample unbiased 
+            // w.r.t. when the network is observed. the gaps between ticks 
+            // follow an exponential distribution w/ mean interval_usec.
+            ts_add_usec(&next_deadline, (uint64_t) exp_gap(rng));
+            break;
+
+        case SCHEDULE_BURST:
+
+            // the ticks within a train share the same deadline (i.e. are sent 
+            // back-to-back). the next train starts interval_usec after the 
+            // start of this one.
+            if (++train_pos >= train_len) {
+
+                train_pos = 0;
+                ts_add_usec(&next_deadline, interval_usec);
+            }
+
+            break;
+
+        case SCHEDULE_FIXED:
+        default:
+
+            ts_add_usec(&next_deadline, interval_usec);
+            break;
+    }
+}
+
+int ProbeScheduler::parse_pattern(const char * name) {
+
+    if (strcmp(name, "fixed") == 0)
+        return SCHEDULE_FIXED;
+    else if (strcmp(name, "poisson") == 0)
+        return SCHEDULE_POISSON;
+    else if (strcmp(name, "burst") == 0)
+        return SCHEDULE_BURST;
+
+    return -1;
+}
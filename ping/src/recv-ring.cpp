@@ -0,0 +1,71 @@
+#include <string.h>
+
+#include "recv-ring.h"
+
+RecvRing::RecvRing(int slots)
+    : slots(slots), nr_batches(0), nr_packets(0) {
+
+    // one contiguous block per kind of buffer, so that slot i's buffers are 
+    // simply at offset i * size
+    buffers = new char[slots * RECV_RING_BUFFER_SIZE];
+    ctrl_buffers = new char[slots * RECV_RING_CTRL_SIZE];
+    addrs = new struct sockaddr_in[slots];
+    iovecs = new struct iovec[slots];
+    msgs = new struct mmsghdr[slots];
+
+    memset(msgs, 0, slots * sizeof(struct mmsghdr));
+
+    // wire each msghdr to its own buffers. this is done once: receive() 
+    // only has to reset the fields the kernel overwrites.
+    for (int i = 0; i < slots; i++) {
+
+        iovecs[i].iov_base = buffers + (i * RECV_RING_BUFFER_SIZE);
+        iovecs[i].iov_len = RECV_RING_BUFFER_SIZE;
+
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = ctrl_buffers + (i * RECV_RING_CTRL_SIZE);
+    }
+}
+
+RecvRing::~RecvRing() {
+
+    delete [] buffers;
+    delete [] ctrl_buffers;
+    delete [] addrs;
+    delete [] iovecs;
+    delete [] msgs;
+}
+
+int RecvRing::receive(int socket_fd) {
+
+    // recvmmsg() overwrites the name and control lengths w/ the sizes 
+    // actually used, so these must be reset before every call
+    for (int i = 0; i < slots; i++) {
+
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs[i].msg_hdr.msg_controllen = RECV_RING_CTRL_SIZE;
+    }
+
+    // MSG_WAITFORONE : block until the 1st packet arrives, then grab whatever 
+    // else is already queued w/o blocking again. this is what keeps latency 
+    // low at low rates while batching at high rates.
+    int received = recvmmsg(socket_fd, msgs, slots, MSG_WAITFORONE, NULL);
+
+    if (received > 0) {
+
+        nr_batches++;
+        nr_packets += received;
+    }
+
+    return received;
+}
+
+double RecvRing::get_avg_batch_size() {
+
+    if (nr_batches == 0)
+        return 0.0;
+
+    return (double) nr_packets / (double) nr_batches;
+}
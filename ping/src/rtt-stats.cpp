@@ -0,0 +1,101 @@
+#include <string.h>
+#include <math.h>
+
+#include "rtt-stats.h"
+
+RttStats::RttStats()
+    : count(0), min_nsec(0), max_nsec(0), mean(0.0), m2(0.0) {
+
+    memset(buckets, 0, sizeof(buckets));
+}
+
+int RttStats::bucket_index(uint64_t rtt_usec) {
+
+    // values below 2^RTT_HIST_SUB_BITS usec get a bucket each
+    if (rtt_usec < RTT_HIST_SUB_BUCKETS)
+        return (int) rtt_usec;
+
+    // m : position of the most significant bit, i.e. rtt_usec is in 
+    // [2^m, 2^(m + 1)). dropping the (m - RTT_HIST_SUB_BITS) lower bits 
+    // leaves a value in [RTT_HIST_SUB_BUCKETS, 2 * RTT_HIST_SUB_BUCKETS), 
+    // which gives the linear sub-bucket.
+    int m = 63 - __builtin_clzll(rtt_usec);
+
+    if (m > RTT_HIST_MAX_EXP - 1)
+        return RTT_HIST_BUCKETS - 1;
+
+    int shift = m - RTT_HIST_SUB_BITS;
+    int sub = (int) (rtt_usec >> shift) - RTT_HIST_SUB_BUCKETS;
+
+    return RTT_HIST_SUB_BUCKETS + (shift * RTT_HIST_SUB_BUCKETS) + sub;
+}
+
+double RttStats::bucket_value(int index) {
+
+    if (index < RTT_HIST_SUB_BUCKETS)
+        return (double) index;
+
+    int shift = (index - RTT_HIST_SUB_BUCKETS) / RTT_HIST_SUB_BUCKETS;
+    int sub = (index - RTT_HIST_SUB_BUCKETS) % RTT_HIST_SUB_BUCKETS;
+
+    double lower = (double) ((uint64_t) (RTT_HIST_SUB_BUCKETS + sub) << shift);
+    double width = (double) ((uint64_t) 1 << shift);
+
+    return lower + (width / 2.0);
+}
+
+void RttStats::add(int64_t rtt_nsec) {
+
+    // clock adjustments may make an rtt look negative
+    if (rtt_nsec < 0)
+        rtt_nsec = 0;
+
+    if (count == 0 || rtt_nsec < min_nsec)
+        min_nsec = rtt_nsec;
+    if (count == 0 || rtt_nsec > max_nsec)
+        max_nsec = rtt_nsec;
+
+    // Welford : update the mean w/ the new sample, and accumulate the 
+    // product of the sample's distance to the old and new means
+    count++;
+    double delta = rtt_nsec - mean;
+    mean += delta / count;
+    m2 += delta * (rtt_nsec - mean);
+
+    buckets[bucket_index((uint64_t) rtt_nsec / 1000)]++;
+}
+
+double RttStats::get_stdev() {
+
+    if (count < 2)
+        return 0.0;
+
+    return sqrt(m2 / count) / 1000000.0;
+}
+
+double RttStats::get_percentile(double p) {
+
+    if (count == 0)
+        return 0.0;
+
+    // the rank of the sample we're looking for (1-based)
+    uint64_t rank = (uint64_t) ceil(p * count);
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t seen = 0;
+
+    for (int i = 0; i < RTT_HIST_BUCKETS; i++) {
+
+        seen += buckets[i];
+
+        if (seen >= rank) {
+
+            // a bucket's midpoint may fall outside the range actually seen
+            double value = bucket_value(i) / 1000.0;
+            return fmin(fmax(value, get_min()), get_max());
+        }
+    }
+
+    return get_max();
+}
@@ -0,0 +1,100 @@
+#include <string.h>
+
+#include "seq-window.h"
+
+SeqWindow::SeqWindow()
+    : started(false), max_seq(0), on_time(0), late(0), duplicates(0), reordered(0) {
+
+    memset(bitmap, 0, sizeof(bitmap));
+}
+
+bool SeqWindow::test_and_set(uint16_t seq) {
+
+    int bit = seq & (SEQ_WINDOW_SIZE - 1);
+    uint64_t mask = (uint64_t) 1 << (bit & 63);
+    bool was_set = (bitmap[bit >> 6] & mask) != 0;
+
+    bitmap[bit >> 6] |= mask;
+
+    return was_set;
+}
+
+void SeqWindow::clear(uint16_t seq) {
+
+    int bit = seq & (SEQ_WINDOW_SIZE - 1);
+    bitmap[bit >> 6] &= ~((uint64_t) 1 << (bit & 63));
+}
+
+int SeqWindow::classify(uint16_t seq, int64_t rtt_nsec, int64_t timeout_nsec) {
+
+    bool is_late = (rtt_nsec > timeout_nsec);
+
+    if (!started) {
+
+        started = true;
+        max_seq = seq;
+        test_and_set(seq);
+
+        if (is_late) {
+            late++;
+            return REPLY_LATE;
+        }
+
+        on_time++;
+        return REPLY_ON_TIME;
+    }
+
+    // distance from the window's right edge, modulo 2^16 : a positive 
+    // distance means seq is ahead of anything seen before
+    int16_t distance = (int16_t) (uint16_t) (seq - max_seq);
+
+    if (distance > 0) {
+
+        // slide the window forward, clearing the bits of the seq numbers 
+        // it skips over (which haven't been received yet). if it moves by 
+        // the whole window or more, just start over.
+        if (distance >= SEQ_WINDOW_SIZE) {
+
+            memset(bitmap, 0, sizeof(bitmap));
+
+        } else {
+
+            for (uint16_t s = max_seq + 1; s != seq; s++)
+                clear(s);
+        }
+
+        clear(seq);
+        max_seq = seq;
+        test_and_set(seq);
+
+        if (is_late) {
+            late++;
+            return REPLY_LATE;
+        }
+
+        on_time++;
+        return REPLY_ON_TIME;
+    }
+
+    // behind the window's left edge : we can't tell if it's a duplicate, 
+    // and it's surely late
+    if (-distance >= SEQ_WINDOW_SIZE) {
+
+        late++;
+        return REPLY_LATE;
+    }
+
+    if (test_and_set(seq)) {
+
+        duplicates++;
+        return REPLY_DUPLICATE;
+    }
+
+    if (is_late) {
+        late++;
+        return REPLY_LATE;
+    }
+
+    reordered++;
+    return REPLY_REORDERED;
+}
@@ -0,0 +1,160 @@
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <linux/net_tstamp.h>   // SOF_TIMESTAMPING_*
+#include <linux/errqueue.h>     // struct scm_timestamping
+
+#include <iostream>
+
+#include "timestamp-utils.h"
+
+int TimestampUtils::enable_rx_timestamps(int socket_fd) {
+
+    int on = 1;
+
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+
+        std::cerr << "timestamp-utils::enable_rx_timestamps() : [ERROR] error "\
+            "setting SO_TIMESTAMPNS: " << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int64_t TimestampUtils::ts_sub_nsec(const struct timespec * a, const struct timespec * b) {
+
+    return ((int64_t) a->tv_sec - (int64_t) b->tv_sec) * 1000000000LL 
+        + ((int64_t) a->tv_nsec - (int64_t) b->tv_nsec);
+}
+
+int TimestampUtils::enable_tx_timestamps(int socket_fd, bool hardware) {
+
+    // SOF_TIMESTAMPING_TX_* flags ask the kernel to generate timestamps, 
+    // the SOF_TIMESTAMPING_SOFTWARE and _RAW_HARDWARE flags ask it to 
+    // report them to us
+    int flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+    if (hardware) {
+
+        flags |= SOF_TIMESTAMPING_TX_HARDWARE 
+            | SOF_TIMESTAMPING_RX_HARDWARE 
+            | SOF_TIMESTAMPING_RAW_HARDWARE;
+    }
+
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+
+        std::cerr << "timestamp-utils::enable_tx_timestamps() : [ERROR] error "\
+            "setting SO_TIMESTAMPING: " << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int TimestampUtils::get_pckt_timestamps(struct msghdr * msg, struct pckt_timestamps * ts) {
+
+    memset(ts, 0, sizeof(struct pckt_timestamps));
+
+    // the ancillary data is a sequence of cmsghdrs, each w/ a level, type 
+    // and data. CMSG_FIRSTHDR() and CMSG_NXTHDR() walk through it, taking 
+    // care of alignment and of msg_controllen (as set by recvmsg()).
+    for (struct cmsghdr * cmsg = CMSG_FIRSTHDR(msg); 
+        cmsg != NULL; 
+        cmsg = CMSG_NXTHDR(msg, cmsg)) {
+
+        if (cmsg->cmsg_level != SOL_SOCKET)
+            continue;
+
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+
+            memcpy(&ts->sw, CMSG_DATA(cmsg), sizeof(struct timespec));
+            ts->has_sw = true;
+
+        } else if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+
+            // struct scm_timestamping holds 3 timespecs : ts[0] is the 
+            // software timestamp, ts[1] is deprecated and ts[2] is the raw 
+            // hardware timestamp. unused ones are zeroed.
+            struct scm_timestamping stamps;
+            memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+
+            if (stamps.ts[0].tv_sec || stamps.ts[0].tv_nsec) {
+
+                ts->sw = stamps.ts[0];
+                ts->has_sw = true;
+            }
+
+            if (stamps.ts[2].tv_sec || stamps.ts[2].tv_nsec) {
+
+                ts->hw = stamps.ts[2];
+                ts->has_hw = true;
+            }
+        }
+    }
+
+    return ((ts->has_sw || ts->has_hw) ? 0 : -1);
+}
+
+int TimestampUtils::read_tx_timestamp(
+    int socket_fd, 
+    char * buffer, int buffer_len, 
+    struct pckt_timestamps * ts) {
+
+    char ctrl_buffer[512];
+    struct iovec iov;
+    struct msghdr msg;
+
+    iov.iov_base = buffer;
+    iov.iov_len = buffer_len;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl_buffer;
+    msg.msg_controllen = sizeof(ctrl_buffer);
+
+    int len = recvmsg(socket_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+
+    if (len < 0)
+        return -1;
+
+    if (get_pckt_timestamps(&msg, ts) < 0) {
+
+        // not a timestamp (e.g. a regular icmp error queued by the kernel). 
+        // callers just skip it.
+        return 0;
+    }
+
+    return len;
+}
+
+TxTimestampTable::TxTimestampTable(size_t nr_targets) 
+    : slots(nr_targets * TX_TS_SLOTS) {
+
+    for (size_t i = 0; i < slots.size(); i++)
+        slots[i].valid = false;
+}
+
+void TxTimestampTable::put(size_t target_index, uint16_t seq, const struct pckt_timestamps * ts) {
+
+    struct tx_slot & slot = slots[(target_index * TX_TS_SLOTS) + (seq % TX_TS_SLOTS)];
+
+    slot.seq = seq;
+    slot.ts = *ts;
+    slot.valid = true;
+}
+
+int TxTimestampTable::get(size_t target_index, uint16_t seq, struct pckt_timestamps * ts) {
+
+    struct tx_slot & slot = slots[(target_index * TX_TS_SLOTS) + (seq % TX_TS_SLOTS)];
+
+    if (!slot.valid || slot.seq != seq)
+        return -1;
+
+    *ts = slot.ts;
+
+    return 0;
+}
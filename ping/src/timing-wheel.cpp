@@ -0,0 +1,253 @@
+#include "timing-wheel.h"
+
+#define NSEC_PER_SEC        1000000000ULL
+// marks a node as free (in its prev link)
+#define TIMER_NODE_FREE     0xFFFFFFFF
+// the end of the free list
+#define TIMER_NODE_NONE     0xFFFFFFFF
+// nr. of sentinel nodes, a list head per slot
+#define TIMER_NODE_HEADS    (TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS)
+#define TIMER_CHUNK_SIZE    (1 << TIMING_WHEEL_CHUNK_BITS)
+#define TIMER_SLOT_MASK     (TIMING_WHEEL_SLOTS - 1)
+// the farthest a timer can be scheduled, in ticks
+#define TIMER_MAX_TICKS     0xFFFFFFFFULL
+
+TimingWheel::TimingWheel(uint32_t capacity, uint64_t tick_nsec)
+    : capacity(capacity), tick_nsec(tick_nsec > 0 ? tick_nsec : 1), current(0),
+    nr_nodes(TIMER_NODE_HEADS), free_list(TIMER_NODE_NONE), nr_pending(0),
+    nr_expired(0), nr_cancelled(0) {
+
+    // node indexes (sentinels included) must stay clear of TIMER_NODE_FREE
+    if (this->capacity > 0x80000000)
+        this->capacity = 0x80000000;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // the 1st chunk holds the sentinels, each an empty (circular) list
+    chunks.push_back(new struct timer_node[TIMER_CHUNK_SIZE]);
+
+    for (uint32_t i = 0; i < TIMER_NODE_HEADS; i++) {
+        node(i).next = i;
+        node(i).prev = i;
+    }
+}
+
+TimingWheel::~TimingWheel() {
+
+    for (size_t i = 0; i < chunks.size(); i++)
+        delete [] chunks[i];
+}
+
+uint64_t TimingWheel::get_clock_tick() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    uint64_t elapsed = (uint64_t) (now.tv_sec - start.tv_sec) * NSEC_PER_SEC
+        + now.tv_nsec - start.tv_nsec;
+
+    return elapsed / tick_nsec;
+}
+
+uint64_t TimingWheel::get_slab_size() {
+
+    return (uint64_t) chunks.size() * TIMER_CHUNK_SIZE * sizeof(struct timer_node);
+}
+
+uint32_t TimingWheel::alloc_node() {
+
+    uint32_t i = free_list;
+
+    if (i != TIMER_NODE_NONE) {
+
+        free_list = node(i).next;
+        return i;
+    }
+
+    // free list empty : hand out a node never used before, in a new chunk
+    // if needed
+    if (nr_nodes - TIMER_NODE_HEADS >= capacity)
+        return TIMER_NODE_NONE;
+
+    if ((nr_nodes >> TIMING_WHEEL_CHUNK_BITS) >= chunks.size())
+        chunks.push_back(new struct timer_node[TIMER_CHUNK_SIZE]);
+
+    i = nr_nodes++;
+    node(i).generation = 1;
+
+    return i;
+}
+
+void TimingWheel::free_node(uint32_t i) {
+
+    struct timer_node & n = node(i);
+
+    // generation 0 would allow TIMER_NONE as a valid handle
+    if (++n.generation == 0)
+        n.generation = 1;
+
+    n.prev = TIMER_NODE_FREE;
+    n.next = free_list;
+    free_list = i;
+
+    nr_pending--;
+}
+
+void TimingWheel::place(uint32_t i) {
+
+    struct timer_node & n = node(i);
+    uint32_t delta = n.expiry - (uint32_t) current;
+
+    // the lowest level w/ a span larger than delta : level l spans
+    // 2^(8 * (l + 1)) ticks
+    int level = 0;
+    while (level < TIMING_WHEEL_LEVELS - 1
+        && (delta >> (TIMING_WHEEL_BITS * (level + 1))) != 0)
+        level++;
+
+    uint32_t head = (level * TIMING_WHEEL_SLOTS)
+        + ((n.expiry >> (TIMING_WHEEL_BITS * level)) & TIMER_SLOT_MASK);
+
+    // append at the tail of the slot's list
+    struct timer_node & h = node(head);
+    n.next = head;
+    n.prev = h.prev;
+    node(h.prev).next = i;
+    h.prev = i;
+}
+
+void TimingWheel::unlink(uint32_t i) {
+
+    struct timer_node & n = node(i);
+    node(n.prev).next = n.next;
+    node(n.next).prev = n.prev;
+}
+
+uint64_t TimingWheel::insert(uint64_t timeout_nsec, uint64_t data) {
+
+    // due at the end of the tick the timeout ends in
+    return insert_at(get_clock_tick() + (timeout_nsec + tick_nsec - 1) / tick_nsec, data);
+}
+
+uint64_t TimingWheel::insert_at(uint64_t expiry, uint64_t data) {
+
+    uint32_t i = alloc_node();
+
+    if (i == TIMER_NODE_NONE)
+        return TIMER_NONE;
+
+    // never in the tick we're in, which may have been processed already
+    if (expiry <= current)
+        expiry = current + 1;
+
+    if (expiry - current > TIMER_MAX_TICKS)
+        expiry = current + TIMER_MAX_TICKS;
+
+    struct timer_node & n = node(i);
+    n.expiry = (uint32_t) expiry;
+    n.data = data;
+
+    place(i);
+    nr_pending++;
+
+    return ((uint64_t) n.generation << 32) | i;
+}
+
+bool TimingWheel::cancel(uint64_t handle) {
+
+    uint32_t i = (uint32_t) handle;
+
+    if (i < TIMER_NODE_HEADS || i >= nr_nodes)
+        return false;
+
+    struct timer_node & n = node(i);
+
+    if (n.prev == TIMER_NODE_FREE || n.generation != (uint32_t) (handle >> 32))
+        return false;
+
+    unlink(i);
+    free_node(i);
+    nr_cancelled++;
+
+    return true;
+}
+
+void TimingWheel::cascade(int level, uint32_t slot) {
+
+    uint32_t head = (level * TIMING_WHEEL_SLOTS) + slot;
+    struct timer_node & h = node(head);
+
+    if (h.next == head)
+        return;
+
+    // detach the whole list, then re-place its timers one by one : all of
+    // them are now due w/in the span of a lower level
+    uint32_t i = h.next;
+    node(h.prev).next = TIMER_NODE_NONE;
+    h.next = head;
+    h.prev = head;
+
+    while (i != TIMER_NODE_NONE) {
+
+        uint32_t next = node(i).next;
+        place(i);
+        i = next;
+    }
+}
+
+uint64_t TimingWheel::advance_to(
+    uint64_t tick, void (* on_expire)(uint64_t data, void * arg), void * arg) {
+
+    uint64_t expired = 0;
+
+    while (current < tick) {
+
+        // nothing pending : no need to visit the slots in between
+        if (nr_pending == 0) {
+            current = tick;
+            break;
+        }
+
+        current++;
+
+        uint32_t slot = current & TIMER_SLOT_MASK;
+
+        // level 0 wrapped around : bring down the timers of level 1's next
+        // slot, and those of level 2's if level 1 wrapped too, etc.
+        if (slot == 0) {
+
+            for (int level = 1; level < TIMING_WHEEL_LEVELS; level++) {
+
+                uint32_t level_slot = (current >> (TIMING_WHEEL_BITS * level)) & TIMER_SLOT_MASK;
+                cascade(level, level_slot);
+
+                if (level_slot != 0)
+                    break;
+            }
+        }
+
+        // everything in level 0's current slot is due now
+        struct timer_node & h = node(slot);
+
+        while (h.next != slot) {
+
+            uint32_t i = h.next;
+            uint64_t data = node(i).data;
+
+            unlink(i);
+            free_node(i);
+
+            expired++;
+            on_expire(data, arg);
+        }
+    }
+
+    nr_expired += expired;
+
+    return expired;
+}
+
+uint64_t TimingWheel::advance(void (* on_expire)(uint64_t data, void * arg), void * arg) {
+
+    return advance_to(get_clock_tick(), on_expire, arg);
+}
@@ -0,0 +1,43 @@
+#include "token-bucket.h"
+
+#define NSEC_PER_SEC    1000000000ULL
+
+TokenBucket::TokenBucket(uint64_t rate, uint64_t burst)
+    : rate(rate), burst(burst), tokens(0) {
+
+    clock_gettime(CLOCK_MONOTONIC, &last);
+}
+
+uint64_t TokenBucket::refill() {
+
+    if (rate == 0)
+        return burst;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    uint64_t elapsed = (uint64_t) (now.tv_sec - last.tv_sec) * NSEC_PER_SEC
+        + now.tv_nsec - last.tv_nsec;
+    last = now;
+
+    // the bucket is full after burst / rate sec anyway. capping the elapsed
+    // time keeps elapsed * rate from overflowing after a long pause.
+    if (elapsed > NSEC_PER_SEC)
+        elapsed = NSEC_PER_SEC;
+
+    tokens += elapsed * rate;
+
+    if (tokens > burst * NSEC_PER_SEC)
+        tokens = burst * NSEC_PER_SEC;
+
+    return tokens / NSEC_PER_SEC;
+}
+
+void TokenBucket::consume(uint64_t n) {
+
+    if (rate == 0)
+        return;
+
+    uint64_t cost = n * NSEC_PER_SEC;
+    tokens = (cost > tokens ? 0 : tokens - cost);
+}
@@ -0,0 +1,494 @@
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <iostream>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+
+#include "uring-backend.h"
+
+// user_data of the multishot receive and of the entries which hand buffers 
+// to the kernel. sends use their slot index.
+#define URING_RECV_TAG      0xFFFFFFFFFFFFFFFFULL
+#define URING_PROVIDE_TAG   0xFFFFFFFFFFFFFFFEULL
+// buffer group id of the receive buffers
+#define URING_BUFFER_GROUP  0
+
+// the rings are shared w/ the kernel : the producer publishes a new tail w/ a
+// release store (after filling the entries), and the consumer reads it w/ an
+// acquire load (before reading the entries)
+#define load_acquire(p)         __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define store_release(p, v)     __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+UringBackend::UringBackend(int socket_fd, uring_recv_handler handler, void * handler_arg)
+    : socket_fd(socket_fd), handler(handler), handler_arg(handler_arg),
+      ring_fd(-1), event_fd(-1),
+      sq_ptr(MAP_FAILED), sq_size(0), cq_ptr(MAP_FAILED), cq_size(0),
+      sqes((struct io_uring_sqe *) MAP_FAILED), sqes_size(0),
+      sq_local_tail(0), to_submit(0),
+      nr_sent(0), nr_received(0), nr_enters(0) {
+
+    recv_buffers = new char[URING_RECV_BUFFERS * URING_RECV_BUFFER_SIZE];
+
+    memset(&recv_msg, 0, sizeof(recv_msg));
+    recv_msg.msg_namelen = sizeof(struct sockaddr_in);
+    recv_msg.msg_controllen = URING_RECV_CTRL_SIZE;
+
+    // as w/ RecvRing, each send slot's msghdr is wired to its buffers once
+    send_buffers = new char[URING_SEND_SLOTS * URING_SEND_BUFFER_SIZE];
+    send_addrs = new struct sockaddr_in[URING_SEND_SLOTS];
+    send_iovecs = new struct iovec[URING_SEND_SLOTS];
+    send_msgs = new struct msghdr[URING_SEND_SLOTS];
+
+    memset(send_msgs, 0, URING_SEND_SLOTS * sizeof(struct msghdr));
+
+    for (int i = 0; i < URING_SEND_SLOTS; i++) {
+
+        send_iovecs[i].iov_base = send_buffers + (i * URING_SEND_BUFFER_SIZE);
+
+        send_msgs[i].msg_name = &send_addrs[i];
+        send_msgs[i].msg_namelen = sizeof(struct sockaddr_in);
+        send_msgs[i].msg_iov = &send_iovecs[i];
+        send_msgs[i].msg_iovlen = 1;
+
+        free_slots.push_back(i);
+    }
+}
+
+UringBackend::~UringBackend() {
+
+    // closing the ring cancels the pending receive, and unregisters the
+    // buffers and the eventfd
+    if (ring_fd >= 0)
+        close(ring_fd);
+
+    if (event_fd >= 0)
+        close(event_fd);
+
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sqes_size);
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+        munmap(cq_ptr, cq_size);
+    if (sq_ptr != MAP_FAILED)
+        munmap(sq_ptr, sq_size);
+
+    delete [] recv_buffers;
+    delete [] send_buffers;
+    delete [] send_addrs;
+    delete [] send_iovecs;
+    delete [] send_msgs;
+}
+
+int UringBackend::init() {
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_ENTRIES * 4;
+
+    if ((ring_fd = (int) syscall(__NR_io_uring_setup, URING_ENTRIES, &params)) < 0) {
+
+        std::cerr << "uring-backend::init() : [WARNING] io_uring_setup() failed: "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    // map the submission and completion rings, and the sq entries. since
+    // 5.4, both rings can share a single mapping.
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+
+        if (cq_size > sq_size)
+            sq_size = cq_size;
+        cq_size = sq_size;
+    }
+
+    sq_ptr = mmap(NULL, sq_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+
+    if (sq_ptr == MAP_FAILED) {
+
+        std::cerr << "uring-backend::init() : [WARNING] error mapping the sq ring: "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+
+        cq_ptr = sq_ptr;
+
+    } else {
+
+        cq_ptr = mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+
+        if (cq_ptr == MAP_FAILED) {
+
+            std::cerr << "uring-backend::init() : [WARNING] error mapping the cq ring: "
+                << strerror(errno) << std::endl;
+
+            return -1;
+        }
+    }
+
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = (struct io_uring_sqe *) mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+
+    if (sqes == MAP_FAILED) {
+
+        std::cerr << "uring-backend::init() : [WARNING] error mapping the sq entries: "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    char * sq = (char *) sq_ptr;
+    char * cq = (char *) cq_ptr;
+
+    sq_head = (unsigned *) (sq + params.sq_off.head);
+    sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    sq_mask = *(unsigned *) (sq + params.sq_off.ring_mask);
+    sq_entries = *(unsigned *) (sq + params.sq_off.ring_entries);
+    sq_array = (unsigned *) (sq + params.sq_off.array);
+    sq_local_tail = *sq_tail;
+
+    cq_head = (unsigned *) (cq + params.cq_off.head);
+    cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    cq_mask = *(unsigned *) (cq + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    // the sq array maps ring positions to sq entries. we always use entry i
+    // for position i, so it's filled once.
+    for (unsigned i = 0; i < sq_entries; i++)
+        sq_array[i] = i;
+
+    if ((event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+
+        std::cerr << "uring-backend::init() : [WARNING] error in eventfd(): "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_EVENTFD, &event_fd, 1) < 0) {
+
+        std::cerr << "uring-backend::init() : [WARNING] error registering the "\
+            "eventfd: " << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    // hand all receive buffers to the kernel (they're contiguous, so a 
+    // single entry does it), then arm the receive. both are checked 
+    // synchronously, so that an old kernel makes init() fail (and the 
+    // caller fall back) instead of the 1st receive.
+    if (provide_recv_buffers(0, URING_RECV_BUFFERS) < 0 || arm_recv() < 0)
+        return -1;
+
+    store_release(sq_tail, sq_local_tail);
+
+    int submitted = enter(to_submit, 1, IORING_ENTER_GETEVENTS);
+
+    if (submitted < 0) {
+
+        std::cerr << "uring-backend::init() : [WARNING] error in io_uring_enter(): "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    to_submit -= submitted;
+
+    // we waited for the buffers' completion. invalid requests (e.g. a 
+    // multishot receive on linux < 6.0) fail while being submitted, so 
+    // their errors are posted by now too. we only peek : the completions 
+    // are consumed by reap(), since one might already be a packet.
+    unsigned tail = load_acquire(cq_tail);
+
+    for (unsigned head = *cq_head; head != tail; head++) {
+
+        struct io_uring_cqe * cqe = &cqes[head & cq_mask];
+
+        if (cqe->res < 0) {
+
+            std::cerr << "uring-backend::init() : [WARNING] " 
+                << (cqe->user_data == URING_RECV_TAG ? "multishot receive" : "providing buffers") 
+                << " failed: " << strerror(-cqe->res) << std::endl;
+
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+struct io_uring_sqe * UringBackend::get_sqe() {
+
+    if (sq_local_tail - load_acquire(sq_head) >= sq_entries)
+        return NULL;
+
+    struct io_uring_sqe * sqe = &sqes[sq_local_tail & sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+
+    sq_local_tail++;
+    to_submit++;
+
+    return sqe;
+}
+
+int UringBackend::enter(unsigned int nr_submit, unsigned int min_complete, unsigned int flags) {
+
+    int rc = 0;
+
+    do {
+
+        rc = (int) syscall(__NR_io_uring_enter, ring_fd, nr_submit, min_complete, flags, NULL, 0);
+
+    } while (rc < 0 && errno == EINTR);
+
+    nr_enters++;
+
+    return rc;
+}
+
+int UringBackend::arm_recv() {
+
+    struct io_uring_sqe * sqe = get_sqe();
+
+    if (sqe == NULL && (submit() < 0 || (sqe = get_sqe()) == NULL))
+        return -1;
+
+    // w/ IOSQE_BUFFER_SELECT, the kernel picks the buffers. IORING_RECV_MULTISHOT
+    // keeps the request armed after each packet (needs linux 6.0).
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = socket_fd;
+    sqe->addr = (uint64_t) (uintptr_t) &recv_msg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = URING_RECV_TAG;
+
+    return 0;
+}
+
+int UringBackend::provide_recv_buffers(uint16_t bid, int nr_buffers) {
+
+    struct io_uring_sqe * sqe = get_sqe();
+
+    if (sqe == NULL && (submit() < 0 || (sqe = get_sqe()) == NULL))
+        return -1;
+
+    // nr_buffers consecutive buffers, w/ ids bid, bid + 1, ...
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = nr_buffers;
+    sqe->addr = (uint64_t) (uintptr_t) (recv_buffers + (bid * URING_RECV_BUFFER_SIZE));
+    sqe->len = URING_RECV_BUFFER_SIZE;
+    sqe->off = bid;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = URING_PROVIDE_TAG;
+
+    return 0;
+}
+
+int UringBackend::submit() {
+
+    if (to_submit == 0)
+        return 0;
+
+    store_release(sq_tail, sq_local_tail);
+
+    int submitted = enter(to_submit, 0, 0);
+
+    if (submitted < 0) {
+
+        std::cerr << "uring-backend::submit() : [ERROR] error in io_uring_enter(): "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    to_submit -= submitted;
+
+    return submitted;
+}
+
+int UringBackend::queue_send(const void * pckt, int len, const struct sockaddr_in * addr) {
+
+    if (len > URING_SEND_BUFFER_SIZE)
+        return -1;
+
+    // all slots in flight : push what's queued, and wait for some of it to
+    // complete
+    if (free_slots.empty()) {
+
+        store_release(sq_tail, sq_local_tail);
+
+        int submitted = enter(to_submit, 1, IORING_ENTER_GETEVENTS);
+
+        if (submitted < 0) {
+
+            std::cerr << "uring-backend::queue_send() : [ERROR] error in "\
+                "io_uring_enter(): " << strerror(errno) << std::endl;
+
+            return -1;
+        }
+
+        to_submit -= submitted;
+
+        if (reap() < 0 || free_slots.empty())
+            return -1;
+    }
+
+    struct io_uring_sqe * sqe = get_sqe();
+
+    if (sqe == NULL && (submit() < 0 || (sqe = get_sqe()) == NULL))
+        return -1;
+
+    int slot = free_slots.back();
+    free_slots.pop_back();
+
+    memcpy(send_buffers + (slot * URING_SEND_BUFFER_SIZE), pckt, len);
+    send_iovecs[slot].iov_len = len;
+    send_addrs[slot] = *addr;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = socket_fd;
+    sqe->addr = (uint64_t) (uintptr_t) &send_msgs[slot];
+    sqe->len = 1;
+    sqe->user_data = (uint64_t) slot;
+
+    return 0;
+}
+
+int UringBackend::reap() {
+
+    unsigned head = *cq_head;
+    unsigned tail = load_acquire(cq_tail);
+    bool rearm = false;
+    bool failed = false;
+    int nr_cqes = 0;
+
+    for (; head != tail; head++, nr_cqes++) {
+
+        struct io_uring_cqe * cqe = &cqes[head & cq_mask];
+
+        // besides the 1st one (see init()), only failed buffer handovers 
+        // post completions (see recycle_recv_buffer())
+        if (cqe->user_data == URING_PROVIDE_TAG) {
+
+            if (cqe->res >= 0)
+                continue;
+
+            std::cerr << "uring-backend::reap() : [ERROR] error providing "\
+                "buffers: " << strerror(-cqe->res) << std::endl;
+
+            failed = true;
+            continue;
+        }
+
+        if (cqe->user_data != URING_RECV_TAG) {
+
+            // a send completed : its slot can be re-used
+            free_slots.push_back((int) cqe->user_data);
+
+            if (cqe->res < 0) {
+
+                std::cerr << "uring-backend::reap() : [ERROR] error sending: "
+                    << strerror(-cqe->res) << std::endl;
+
+            } else {
+
+                nr_sent++;
+            }
+
+            continue;
+        }
+
+        // the kernel ends a multishot receive w/o IORING_CQE_F_MORE, e.g.
+        // when it runs out of buffers (-ENOBUFS). we re-arm it once the
+        // buffers of this batch are recycled.
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+            rearm = true;
+
+        if (cqe->res < 0) {
+
+            if (cqe->res != -ENOBUFS) {
+
+                std::cerr << "uring-backend::reap() : [ERROR] error receiving: "
+                    << strerror(-cqe->res) << std::endl;
+
+                failed = true;
+            }
+
+            continue;
+        }
+
+        if (!(cqe->flags & IORING_CQE_F_BUFFER))
+            continue;
+
+        // the buffer starts w/ a struct io_uring_recvmsg_out, followed by
+        // regions for the source address and ancillary data (sized as in
+        // recv_msg), and then the packet
+        uint16_t bid = (uint16_t) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        char * buffer = recv_buffers + (bid * URING_RECV_BUFFER_SIZE);
+        struct io_uring_recvmsg_out * out = (struct io_uring_recvmsg_out *) buffer;
+
+        char * name = buffer + sizeof(struct io_uring_recvmsg_out);
+        char * control = name + recv_msg.msg_namelen;
+        char * payload = control + recv_msg.msg_controllen;
+
+        struct iovec iov;
+        iov.iov_base = payload;
+        iov.iov_len = out->payloadlen;
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = name;
+        msg.msg_namelen = out->namelen;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = out->controllen;
+        msg.msg_flags = out->flags;
+
+        nr_received++;
+        handler(&msg, (int) out->payloadlen, handler_arg);
+
+        // hand the buffer back. this needs an sq entry per buffer, but no 
+        // syscall : it goes out w/ the next submit() (below, or w/ the next 
+        // batch of sends)
+        if (recycle_recv_buffer(bid) < 0)
+            failed = true;
+    }
+
+    store_release(cq_head, head);
+
+    if (failed)
+        return -1;
+
+    if (rearm && (arm_recv() < 0 || submit() < 0))
+        return -1;
+
+    return nr_cqes;
+}
+
+int UringBackend::recycle_recv_buffer(uint16_t bid) {
+
+    if (provide_recv_buffers(bid, 1) < 0)
+        return -1;
+
+    // the entry just filled is the last one. successful handovers post no 
+    // completions : nothing to do w/ them.
+    sqes[(sq_local_tail - 1) & sq_mask].flags |= IOSQE_CQE_SKIP_SUCCESS;
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <stdlib.h>
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "timing-wheel.h"
+
+// randomized check of TimingWheel against a reference model : a tick by
+// tick simulation, w/ timers inserted (timeouts from 1 tick to 2^25 ticks,
+// so that all levels cascade) and cancelled at random. the model keeps the
+// tick each timer is due, and every expiry is checked against it : a timer
+// must expire exactly on its tick, once, and only if it wasn't cancelled.
+// also checks that cancel() tells pending timers from stale handles, that
+// nothing is inserted past capacity, and that the slab stays within it.
+// exits w/ 1 on the 1st error. run it w/ 'make check'.
+
+#define CAPACITY        400000
+#define NR_TICKS        (1ULL << 23)
+// max. timeout, 2^MAX_TIMEOUT_BITS ticks
+#define MAX_TIMEOUT_BITS 25
+
+// the model's view of a timer (data is its index in the model)
+struct model_timer {
+    uint64_t handle;
+    // the tick it's due, 0 if it's not pending
+    uint64_t due;
+};
+
+struct model {
+    std::vector<struct model_timer> timers;
+    std::vector<uint32_t> free_ids;
+    // nr. of timers due at each tick
+    std::map<uint64_t, uint32_t> nr_due;
+    uint64_t tick;
+    uint64_t nr_errors;
+    uint64_t nr_expired;
+};
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t rng() {
+
+    // xorshift64
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+
+    return rng_state;
+}
+
+static void on_expire(uint64_t data, void * arg) {
+
+    struct model * m = (struct model *) arg;
+    struct model_timer & t = m->timers[data];
+
+    if (t.due != m->tick) {
+
+        if (m->nr_errors++ < 10) {
+            std::cerr << "timing-wheel-check::on_expire() : [ERROR] timer " << data << " expired at tick "
+                << m->tick << " : " << (t.due == 0 ? "not pending" : (t.due > m->tick ? "early" : "late"))
+                << " (due at " << t.due << ")" << std::endl;
+        }
+
+        return;
+    }
+
+    if (--m->nr_due[t.due] == 0)
+        m->nr_due.erase(t.due);
+
+    t.due = 0;
+    m->free_ids.push_back((uint32_t) data);
+    m->nr_expired++;
+}
+
+static void insert(TimingWheel & wheel, struct model & m) {
+
+    uint64_t timeout = 1 + rng() % (1ULL << (rng() % (MAX_TIMEOUT_BITS + 1)));
+    // now and then, a tick already processed (i.e. due on the next one)
+    uint64_t tick = (rng() % 64 == 0 ? m.tick - (m.tick > 0 ? rng() % 2 : 0) : m.tick + timeout);
+
+    if (m.free_ids.empty()) {
+
+        if (wheel.insert_at(tick, 0) != TIMER_NONE && m.nr_errors++ < 10)
+            std::cerr << "timing-wheel-check::insert() : [ERROR] insert past capacity" << std::endl;
+
+        return;
+    }
+
+    uint32_t id = m.free_ids.back();
+    m.free_ids.pop_back();
+
+    struct model_timer & t = m.timers[id];
+    t.handle = wheel.insert_at(tick, id);
+    t.due = (tick <= m.tick ? m.tick + 1 : tick);
+    m.nr_due[t.due]++;
+
+    if (t.handle == TIMER_NONE && m.nr_errors++ < 10)
+        std::cerr << "timing-wheel-check::insert() : [ERROR] insert failed w/ room left" << std::endl;
+}
+
+static void cancel(TimingWheel & wheel, struct model & m) {
+
+    struct model_timer & t = m.timers[rng() % CAPACITY];
+    bool pending = (t.due != 0);
+
+    // a stale handle (expired, cancelled or never used) must not cancel
+    // anything
+    if (wheel.cancel(t.handle) != pending && m.nr_errors++ < 10) {
+        std::cerr << "timing-wheel-check::cancel() : [ERROR] cancel() says the timer was "
+            << (pending ? "not " : "") << "pending" << std::endl;
+    }
+
+    if (!pending)
+        return;
+
+    if (--m.nr_due[t.due] == 0)
+        m.nr_due.erase(t.due);
+
+    t.due = 0;
+    m.free_ids.push_back((uint32_t) (&t - &m.timers[0]));
+}
+
+int main(int argc, char **argv) {
+
+    TimingWheel wheel(CAPACITY, 1000000);
+
+    struct model m;
+    struct model_timer unused = { TIMER_NONE, 0 };
+    m.timers.assign(CAPACITY, unused);
+    m.tick = 0;
+    m.nr_errors = 0;
+    m.nr_expired = 0;
+
+    for (uint32_t id = CAPACITY; id > 0; id--)
+        m.free_ids.push_back(id - 1);
+
+    uint64_t nr_inserts = 0, nr_cancels = 0;
+
+    for (uint64_t n = 0; n < NR_TICKS && m.nr_errors == 0; n++) {
+
+        // bursts of inserts, filling the wheel up to capacity now and then
+        int nr = (int) (rng() % (n < CAPACITY / 4 ? 8 : 3));
+
+        for (int i = 0; i < nr; i++, nr_inserts++)
+            insert(wheel, m);
+
+        if (rng() % 2 == 0) {
+            cancel(wheel, m);
+            nr_cancels++;
+        }
+
+        m.tick++;
+        wheel.advance_to(m.tick, on_expire, &m);
+
+        // whatever was due now and didn't expire is lost
+        if (!m.nr_due.empty() && m.nr_due.begin()->first <= m.tick && m.nr_errors++ < 10) {
+            std::cerr << "timing-wheel-check::main() : [ERROR] " << m.nr_due.begin()->second
+                << " timer(s) due at tick " << m.nr_due.begin()->first << " lost" << std::endl;
+        }
+
+        if (wheel.size() != CAPACITY - m.free_ids.size() && m.nr_errors++ < 10) {
+            std::cerr << "timing-wheel-check::main() : [ERROR] " << wheel.size() << " timers pending, "
+                << (CAPACITY - m.free_ids.size()) << " expected" << std::endl;
+        }
+    }
+
+    // the wheel and model agree on what's pending : drain it, w/ jumps
+    // rather than tick by tick
+    while (!m.nr_due.empty() && m.nr_errors == 0) {
+        m.tick = m.nr_due.begin()->first;
+        wheel.advance_to(m.tick, on_expire, &m);
+    }
+
+    if (wheel.size() != 0 && m.nr_errors++ < 10)
+        std::cerr << "timing-wheel-check::main() : [ERROR] " << wheel.size() << " timers left" << std::endl;
+
+    // a node per timer, plus the slots' sentinels, rounded up to a chunk
+    uint64_t chunk_size = (1ULL << TIMING_WHEEL_CHUNK_BITS) * 24;
+    uint64_t max_slab_size = ((CAPACITY + TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS) * 24ULL + chunk_size - 1)
+        / chunk_size * chunk_size;
+
+    if (wheel.get_slab_size() > max_slab_size && m.nr_errors++ < 10) {
+        std::cerr << "timing-wheel-check::main() : [ERROR] slab of " << wheel.get_slab_size()
+            << " byte, for a capacity of " << CAPACITY << std::endl;
+    }
+
+    if (m.nr_errors > 0) {
+        std::cerr << "timing-wheel-check::main() : [ERROR] " << m.nr_errors << " error(s)" << std::endl;
+        return 1;
+    }
+
+    std::cout << "timing-wheel-check::main() : [INFO] " << nr_inserts << " inserts, " << nr_cancels
+        << " cancels, " << m.nr_expired << " expiries over " << m.tick << " ticks : OK" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef HOP_STATS_H
+#define HOP_STATS_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// nr. of most recent probes the stats are kept over
+#define HOP_STATS_WINDOW    256
+// marks a probe w/o a reply in the window
+#define HOP_STATS_LOST      0xFFFFFFFF
+
+// rolling statistics for the probes to a hop, in constant memory (~1 KB),
+// however long it's probed for : the outcome of each of the last
+// HOP_STATS_WINDOW probes (its rtt in usec, or a loss) is kept in a ring,
+// and the stats are worked out over it when asked for. only the nr. of
+// probes (answered or timed out) and of replies are kept for the hop's
+// whole lifetime.
+class HopStats {
+
+    public:
+
+        HopStats();
+        ~HopStats() {}
+
+        // a probe answered after rtt_nsec
+        void add(int64_t rtt_nsec);
+        // a probe which timed out
+        void add_loss();
+
+        // over the hop's lifetime
+        uint64_t get_sent() { return sent; }
+        uint64_t get_received() { return received; }
+
+        // over the window. rtts in msec, 0.0 if there are no replies in it.
+        // loss in %.
+        double get_loss();
+        double get_last() { return last_nsec / 1000000.0; }
+        double get_mean();
+        double get_min();
+        double get_max();
+        double get_stdev();
+        // p in [0.0, 1.0], e.g. 0.95 for the 95th percentile
+        double get_percentile(double p);
+
+    private:
+
+        void push(uint32_t sample);
+
+        // the window : the next sample goes in samples[next]
+        uint32_t samples[HOP_STATS_WINDOW];
+        uint32_t next;
+        uint32_t count;
+
+        uint64_t sent;
+        uint64_t received;
+        int64_t last_nsec;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef MULTIPATH_TRACE_H
+#define MULTIPATH_TRACE_H
+
+#include <stdint.h>
+
+#include <iostream>
+#include <vector>
+
+#include <netinet/in.h>
+
+// max. nr. of flows per trace
+#define MDA_MAX_FLOWS           512
+// default confidence of the stopping rule, in %
+#define MDA_DEFAULT_CONFIDENCE  95.0
+
+// a probe for MultipathTrace::schedule() to send
+struct mda_probe {
+    uint16_t flow;
+    int ttl;
+};
+
+// an interface found at some hop
+struct mda_interface {
+    struct in_addr addr;
+    // the destination (or an unreachable) : nothing answers past it
+    bool is_dst;
+    // nr. of flows which got to it, and the sum of their rtts (msec)
+    uint32_t nr_flows;
+    double rtt_sum;
+    // the interfaces at the next hop reached by flows through this one
+    // (s_addr)
+    std::vector<uint32_t> next;
+};
+
+// the multipath detection algorithm (mda), as in paris traceroute (Veitch
+// et al., infocom '09) : finds all the interfaces at each hop of the paths
+// to a destination, behind per-flow load balancers, and which one leads to
+// which (i.e. the 'diamonds' between them). probes carry a flow identifier
+// (e.g. the udp dst port), which load balancers hash on : probes w/ the
+// same flow take the same path, and new flows explore new ones.
+// the stopping rule : given k next hops seen so far, n(k) probes rule out
+// a (k + 1)th one (w/ all next hops equally likely), w/ the given
+// confidence. the next hops of each interface are enumerated separately
+// ('node control') : the flows known to go through an interface at ttl - 1
+// are sent at ttl, and if there aren't enough of them, new flows are sent at
+// ttl - 1 until enough go through it. a hop w/o any interface before it
+// (ttl 1, or after a silent hop) is enumerated as a whole.
+// this class only keeps the state and decides what to send : sending the
+// probes, and matching replies to them, is up to the caller (see
+// trace_mda() in traceroute.cpp). hops are worked on all at once (up to the
+// last one w/ an interface past which the path goes on), not one after the
+// other.
+class MultipathTrace {
+
+    public:
+
+        // max_ttl : ttls go from 1 to max_ttl
+        // gap_limit : nr. of silent hops in a row after which the trace ends
+        // confidence : in %, e.g. 95.0
+        MultipathTrace(int max_ttl, int gap_limit, double confidence);
+        ~MultipathTrace() {}
+
+        // adds the probes to send next to probes, up to max of them, lowest
+        // ttls 1st. they're in flight from then on, until on_reply() or
+        // on_timeout() is called for them. the trace is over once there's
+        // nothing in flight, and nothing more to send.
+        void schedule(std::vector<struct mda_probe> & probes, int max);
+
+        // a reply to the probe of flow at ttl, from addr, after rtt msec
+        void on_reply(uint16_t flow, int ttl, struct in_addr addr, bool is_dst, double rtt);
+        void on_timeout(uint16_t flow, int ttl);
+
+        // prints the hops : each interface, its flows, avg. rtt, and the
+        // interfaces it leads to
+        void print(std::ostream & out);
+        // prints the hops as a graph, in graphviz's dot format
+        void print_dot(std::ostream & out);
+
+        // nr. of probes needed to rule out a (k + 1)th next hop, having
+        // seen k
+        uint32_t get_stopping_point(uint32_t k);
+
+        uint32_t get_nr_in_flight() { return nr_in_flight; }
+        uint64_t get_nr_sent() { return nr_sent; }
+        uint32_t get_nr_flows() { return nr_flows; }
+
+    private:
+
+        enum probe_state { NOT_SENT = 0, IN_FLIGHT, REPLIED, SILENT };
+
+        // the probe of a flow at some ttl
+        struct flow_hop {
+            uint8_t state;
+            // the interface which replied, in hops[ttl].ifaces
+            uint16_t iface;
+        };
+
+        struct mda_hop {
+            std::vector<struct mda_interface> ifaces;
+            uint32_t nr_sent;
+            uint32_t nr_in_flight;
+            uint32_t nr_replies;
+        };
+
+        struct flow_hop & get_flow_hop(uint16_t flow, int ttl) {
+            return flow_hops[(size_t) flow * (max_ttl + 1) + ttl];
+        }
+
+        // true if the path goes on past some interface at ttl
+        bool goes_on(int ttl);
+        // true if flow may be sent at ttl, i.e. it didn't reach the
+        // destination at a lower one
+        bool is_eligible(uint16_t flow, int ttl);
+        // adds a new flow, if there's room for one. returns false if not.
+        bool add_flow(uint16_t & flow);
+        void send(uint16_t flow, int ttl, std::vector<struct mda_probe> & probes);
+        void add_next(struct mda_interface & iface, uint32_t addr);
+
+        int max_ttl;
+        int gap_limit;
+
+        // n(k), for k = 1, 2, ... (index k - 1), as long as it's within
+        // MDA_MAX_FLOWS
+        std::vector<uint32_t> stopping_points;
+
+        // indexed by ttl (0 unused)
+        std::vector<struct mda_hop> hops;
+        // flow_hops[flow * (max_ttl + 1) + ttl]
+        std::vector<struct flow_hop> flow_hops;
+        // the ttl at which each flow reached the destination, 0 if it didn't
+        std::vector<uint8_t> end_ttls;
+
+        uint32_t nr_flows;
+        uint32_t nr_in_flight;
+        uint64_t nr_sent;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef PROBE_TABLE_H
+#define PROBE_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/time.h>
+
+#include <vector>
+
+// a probe which is (or was) in flight, as kept in the ProbeTable
+struct inflight_probe {
+    // the identifiers an icmp reply quotes back (see ProbeTable::make_key()).
+    // 0 marks an empty slot.
+    uint64_t key;
+    uint16_t ttl;
+    uint16_t seq;
+    // free for the caller to use, e.g. the probe's position in an array of
+    // its own
+    uint32_t index;
+    // time at which the probe left
+    struct timeval snd_timestamp;
+};
+
+// the probes in flight, keyed on the identifiers an icmp reply quotes back
+// from them : (icmp id, icmp seq) for icmp echos, (src port, dst port) for
+// udp, or (src port, seq) for tcp. this lets any reply be attributed to its
+// probe in O(1), whichever it is, e.g. a late reply to a probe w/ a lower
+// ttl than the one we're waiting on.
+// it's an open addressing hash table, w/ linear probing and a load factor of
+// at most 1/2. the slots are allocated once, by the constructor. deletions
+// shift the following entries back (no tombstones), so lookups don't slow
+// down w/ churn.
+class ProbeTable {
+
+    public:
+
+        // max_probes : max. nr. of probes kept at once
+        ProbeTable(uint32_t max_probes);
+        ~ProbeTable() {}
+
+        // the key for a probe of ip protocol proto, w/ the 16 bit identifier
+        // id (icmp id, or src port) and the up to 32 bit seq (icmp seq, dst
+        // port, or tcp seq), all in host byte order
+        static uint64_t make_key(uint8_t proto, uint16_t id, uint32_t seq) {
+            return ((uint64_t) proto << 48) | ((uint64_t) id << 32) | seq;
+        }
+
+        // adds a probe. a probe w/ the same key is replaced. returns 0 on
+        // success, -1 if the table is full.
+        int insert(const struct inflight_probe & probe);
+
+        // returns the probe w/ the given key, NULL if there's none. the
+        // pointer is valid until the next insert() or remove().
+        struct inflight_probe * lookup(uint64_t key);
+
+        // removes the probe w/ the given key. returns true if it was there.
+        bool remove(uint64_t key);
+
+        uint32_t size() { return nr_probes; }
+
+    private:
+
+        uint32_t get_home(uint64_t key) {
+            // fibonacci hashing : the top bits of key * 2^64 / phi
+            return (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+        }
+
+        uint32_t max_probes;
+        uint32_t nr_probes;
+        // the table has 2^bits slots
+        int bits;
+        uint32_t mask;
+        std::vector<struct inflight_probe> slots;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef STATELESS_TRACE_H
+#define STATELESS_TRACE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include <iostream>
+
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>        // struct udphdr
+
+#include "cyclic-permutation.h"
+
+// the udp payload : a single 16 bit word, which sets the udp checksum (see
+// below)
+#define STATELESS_DATA_LEN      2
+#define STATELESS_PCKT_LEN      (20 + 8 + STATELESS_DATA_LEN)
+// send times are kept in msec, modulo 2^24 (~4.6 hours)
+#define STATELESS_TIME_MASK     0xFFFFFF
+
+// a stateless traceroute over an address range, as yarrp does (Beverly, imc
+// '16) : each (destination, ttl) pair in range x [1, max_ttl] gets a single
+// udp probe, in a pseudo-random order (see CyclicPermutation), so that
+// consecutive probes don't load the same path, or the same router. nothing
+// is kept per probe or per destination. instead, the probe's headers carry
+// all that's needed to make sense of a reply, and an icmp error quotes them
+// back (the ip header and the 1st 8 byte of udp) :
+//  -# ip id : the ttl (low byte), and bits 16 to 23 of the send time (high
+//     byte). probes are built w/ their own ip header (IP_HDRINCL), so that
+//     the kernel leaves it alone.
+//  -# udp src port : a cookie, i.e. a keyed hash (siphash-2-4, w/ a random
+//     key per run) of the destination, to validate replies against. it's
+//     the same for every probe to a destination (and so is the dst port),
+//     so that they all take the same path through per-flow load balancers.
+//  -# udp checksum : bits 0 to 15 of the send time. the payload word is
+//     picked so that the checksum comes out as that value.
+// send times are msecs since start(). hops are written out as their replies
+// come in : there's no table to match them against.
+class StatelessTrace {
+
+    public:
+
+        // max_ttl : ttls go from 1 to max_ttl
+        // dst_port : the udp dst port of all probes
+        StatelessTrace(int max_ttl, uint16_t dst_port);
+        ~StatelessTrace();
+
+        // sets the range to trace, e.g. "10.0.0.0/16" (a plain address is a
+        // /32). returns 0 on success, -1 on error.
+        int set_range(const char * cidr);
+
+        // sets up the permutation, the cookie key and our src address (the
+        // one the kernel picks towards the range). must be called after
+        // set_range(), and before send(). returns 0 on success, -1 on error.
+        int start();
+
+        // sends the probe for the next (destination, ttl) pair in the
+        // permutation, w/ a raw (IPPROTO_RAW) socket. returns 1 if sent, 0 if
+        // the send buffer is full (the probe is sent by the next call), -1
+        // on error.
+        int send(int socket_fd);
+
+        // true once every (destination, ttl) pair was sent a probe
+        bool is_done() { return (exhausted && !pending); }
+
+        // decodes an icmp packet (ip header included) from src. if it's a
+        // valid reply to one of our probes, writes a line for the hop to
+        // out : destination, ttl, hop address, rtt (msec), icmp type and
+        // code. returns 1 for a valid reply, 0 otherwise.
+        int process_reply(
+            char * buff, int len,
+            struct sockaddr_in * src,
+            std::ostream & out);
+
+        uint64_t get_space_size() { return range_size * max_ttl; }
+        uint64_t get_nr_sent() { return nr_sent; }
+        uint64_t get_nr_hops() { return nr_hops; }
+        uint64_t get_nr_reached() { return nr_reached; }
+        uint64_t get_nr_invalid() { return nr_invalid; }
+
+        // parses "a.b.c.d/prefix" into the 1st address of the range (host
+        // byte order) and its size. returns 0 on success, -1 on error.
+        static int parse_cidr(const char * cidr, uint32_t & first, uint64_t & size);
+
+    private:
+
+        uint64_t get_cookie(uint32_t addr);
+        uint32_t get_elapsed_ms();
+        // builds the probe for (addr, ttl) in pckt
+        void build(uint32_t addr, int ttl);
+
+        int max_ttl;
+        uint16_t dst_port;
+
+        // the range, in host byte order
+        uint32_t range_first;
+        uint64_t range_size;
+
+        CyclicPermutation * permutation;
+        bool exhausted;
+
+        // siphash key
+        uint64_t key[2];
+
+        struct in_addr src_addr;
+        struct timespec start_time;
+
+        // the probe being sent. pending if it didn't make it into the send
+        // buffer yet.
+        char pckt[STATELESS_PCKT_LEN];
+        struct sockaddr_in dst_addr;
+        bool pending;
+
+        uint64_t nr_sent;
+        uint64_t nr_hops;
+        uint64_t nr_reached;
+        uint64_t nr_invalid;
+};
+
+#endif
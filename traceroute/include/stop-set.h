@@ -0,0 +1,68 @@
+#ifndef STOP_SET_H
+#define STOP_SET_H
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include <netinet/in.h>
+
+// destinations are grouped by prefixes of this length in the stop set
+#define STOP_SET_PREFIX_LEN     24
+
+// what a multi-destination trace (see trace_batch() in traceroute.cpp) has
+// learnt so far, a la doubletree (Donnet et al., sigmetrics '05), so that
+// the next traces don't probe the same hops over and over :
+//  -# the interfaces seen so far ('local' stop set). the paths from here to
+//     many destinations form a tree rooted at us : once an interface is
+//     known, the hops before it are known too, so probing backwards (from
+//     a mid-path ttl towards us) stops at the 1st known interface.
+//  -# the (interface, destination prefix) pairs seen so far ('global' stop
+//     set). past an interface, the path to destinations in the same prefix
+//     is likely the same, so probing forwards (towards the destination)
+//     stops at the 1st known pair.
+// each pair keeps the nr. of hops known to lie beyond its interface (0 until
+// the trace which added it is over), for estimating the probes saved.
+class StopSet {
+
+    public:
+
+        // prefix_len : length of the destination prefixes, in bit
+        StopSet(int prefix_len);
+        ~StopSet() {}
+
+        bool has_interface(struct in_addr iface) {
+            return (interfaces.count(iface.s_addr) > 0);
+        }
+
+        void add_interface(struct in_addr iface) {
+            interfaces.insert(iface.s_addr);
+        }
+
+        // true if (iface, dst's prefix) was seen before. if so, the nr. of
+        // hops known past iface goes in remaining.
+        bool lookup(struct in_addr iface, struct in_addr dst, int & remaining);
+
+        // adds (iface, dst's prefix), w/ remaining hops known past iface. a
+        // pair already there keeps the longest of the two.
+        void add(struct in_addr iface, struct in_addr dst, int remaining);
+
+        uint32_t get_nr_interfaces() { return interfaces.size(); }
+        uint32_t get_nr_pairs() { return pairs.size(); }
+        int get_prefix_len() { return prefix_len; }
+
+    private:
+
+        uint64_t get_key(struct in_addr iface, struct in_addr dst) {
+            return ((uint64_t) ntohl(iface.s_addr) << 32) | (ntohl(dst.s_addr) & prefix_mask);
+        }
+
+        int prefix_len;
+        uint32_t prefix_mask;
+        // in network byte order
+        std::unordered_set<uint32_t> interfaces;
+        std::unordered_map<uint64_t, int> pairs;
+};
+
+#endif
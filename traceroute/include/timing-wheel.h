@@ -0,0 +1,126 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <vector>
+
+// 4 levels of 256 slots each : w/ a 1 ms tick, timeouts of up to 2^32 ms
+// (~49 days) can be scheduled
+#define TIMING_WHEEL_LEVELS     4
+#define TIMING_WHEEL_BITS       8
+#define TIMING_WHEEL_SLOTS      (1 << TIMING_WHEEL_BITS)
+// timer nodes are allocated in chunks of this many, as needed
+#define TIMING_WHEEL_CHUNK_BITS 16
+// a handle which never refers to a timer
+#define TIMER_NONE              0
+
+// a hierarchical timing wheel (as in Varghese & Lauck, or the linux kernel's
+// timer wheel), for keeping a timeout per in-flight probe, however many there
+// are. time moves in ticks of tick_nsec. level 0 has a slot per tick, for
+// timers due in the next 256 ticks. each level above covers 256x the span of
+// the one below, w/ 256x coarser slots. a timer goes in the lowest level
+// whose span covers it. when level 0 wraps around, the next slot of level 1
+// is 'cascaded' : its timers are moved down to level 0 (and so on upwards).
+// insert, cancel and expire are all O(1) : no sorting, and no searching.
+//
+// timers live in a slab of fixed-size nodes (24 byte each), linked into
+// their slot w/ 32 bit indexes. the slab grows in chunks up to capacity
+// nodes, and is never shrunk : memory is bounded by capacity, and nothing is
+// allocated once a chunk has been used. a handle is a node index plus a
+// generation nr., bumped every time the node is freed, so that a stale handle
+// (e.g. for a timer which already expired) can't cancel the node's next
+// timer.
+class TimingWheel {
+
+    public:
+
+        // capacity : max. nr. of timers pending at once
+        // tick_nsec : the wheel's resolution. timeouts are rounded up to it.
+        TimingWheel(uint32_t capacity, uint64_t tick_nsec);
+        ~TimingWheel();
+
+        // schedules a timer to expire timeout_nsec from now (on
+        // CLOCK_MONOTONIC), carrying data. returns its handle, TIMER_NONE if
+        // capacity timers are pending already.
+        uint64_t insert(uint64_t timeout_nsec, uint64_t data);
+
+        // same as insert(), w/ the tick the timer is due (ticks count from
+        // the wheel's creation). ticks already processed by advance() are
+        // moved to the next one.
+        uint64_t insert_at(uint64_t tick, uint64_t data);
+
+        // cancels the timer w/ the given handle. returns true if it was
+        // pending, false if it already expired or was cancelled (or if the
+        // handle is bogus).
+        bool cancel(uint64_t handle);
+
+        // moves the wheel up to now (CLOCK_MONOTONIC), expiring the timers
+        // due by then : on_expire(data, arg) is called for each, after the
+        // timer is freed (so it may insert new ones). returns the nr. of
+        // timers expired.
+        uint64_t advance(void (* on_expire)(uint64_t data, void * arg), void * arg);
+
+        // same as advance(), up to the given tick (ticks count from the
+        // wheel's creation)
+        uint64_t advance_to(uint64_t tick, void (* on_expire)(uint64_t data, void * arg), void * arg);
+
+        // the tick we're in now, by CLOCK_MONOTONIC
+        uint64_t get_clock_tick();
+
+        uint32_t size() { return nr_pending; }
+        uint32_t get_capacity() { return capacity; }
+        uint64_t get_tick_nsec() { return tick_nsec; }
+        uint64_t get_nr_expired() { return nr_expired; }
+        uint64_t get_nr_cancelled() { return nr_cancelled; }
+        // bytes allocated for nodes so far
+        uint64_t get_slab_size();
+
+    private:
+
+        struct timer_node {
+            // links to the neighbours in the slot's (circular) list. for a
+            // free node, prev is TIMER_NODE_FREE and next links the free list.
+            uint32_t next;
+            uint32_t prev;
+            uint32_t generation;
+            // lower 32 bit of the tick the timer is due. the full tick is
+            // never more than 2^32 - 1 ticks ahead, so this is enough.
+            uint32_t expiry;
+            uint64_t data;
+        };
+
+        struct timer_node & node(uint32_t i) {
+            return chunks[i >> TIMING_WHEEL_CHUNK_BITS][i & ((1 << TIMING_WHEEL_CHUNK_BITS) - 1)];
+        }
+
+        uint32_t alloc_node();
+        void free_node(uint32_t i);
+        // links node i into the slot its expiry falls in
+        void place(uint32_t i);
+        void unlink(uint32_t i);
+        // moves the timers in a slot of a level > 0 down to lower levels
+        void cascade(int level, uint32_t slot);
+
+        uint32_t capacity;
+        uint64_t tick_nsec;
+        struct timespec start;
+        // the last tick processed by advance()
+        uint64_t current;
+
+        // the 1st TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS nodes are the
+        // slots' list heads (sentinels), so that a node can be unlinked w/o
+        // knowing which slot it's in
+        std::vector<struct timer_node *> chunks;
+        // nodes handed out so far (sentinels included). nodes beyond this
+        // have never been used.
+        uint32_t nr_nodes;
+        uint32_t free_list;
+        uint32_t nr_pending;
+
+        uint64_t nr_expired;
+        uint64_t nr_cancelled;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include <math.h>
+
+#include <algorithm>
+
+#include "hop-stats.h"
+
+HopStats::HopStats()
+    : next(0), count(0), sent(0), received(0), last_nsec(0) {}
+
+void HopStats::push(uint32_t sample) {
+
+    samples[next] = sample;
+    next = (next + 1) % HOP_STATS_WINDOW;
+
+    if (count < HOP_STATS_WINDOW)
+        count++;
+
+    sent++;
+}
+
+void HopStats::add(int64_t rtt_nsec) {
+
+    // clock adjustments may make an rtt look negative
+    if (rtt_nsec < 0)
+        rtt_nsec = 0;
+
+    uint64_t rtt_usec = (uint64_t) rtt_nsec / 1000;
+
+    if (rtt_usec >= HOP_STATS_LOST)
+        rtt_usec = HOP_STATS_LOST - 1;
+
+    push((uint32_t) rtt_usec);
+
+    received++;
+    last_nsec = rtt_nsec;
+}
+
+void HopStats::add_loss() {
+
+    push(HOP_STATS_LOST);
+}
+
+double HopStats::get_loss() {
+
+    if (count == 0)
+        return 0.0;
+
+    uint32_t lost = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (samples[i] == HOP_STATS_LOST)
+            lost++;
+    }
+
+    return 100.0 * (double) lost / (double) count;
+}
+
+double HopStats::get_mean() {
+
+    double sum = 0.0;
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+
+        if (samples[i] != HOP_STATS_LOST) {
+            sum += samples[i];
+            n++;
+        }
+    }
+
+    return (n ? (sum / n) / 1000.0 : 0.0);
+}
+
+double HopStats::get_min() {
+
+    uint32_t min = HOP_STATS_LOST;
+
+    for (uint32_t i = 0; i < count; i++)
+        min = std::min(min, samples[i]);
+
+    return (min != HOP_STATS_LOST ? min / 1000.0 : 0.0);
+}
+
+double HopStats::get_max() {
+
+    uint32_t max = 0;
+    bool any = false;
+
+    for (uint32_t i = 0; i < count; i++) {
+
+        if (samples[i] != HOP_STATS_LOST) {
+            max = std::max(max, samples[i]);
+            any = true;
+        }
+    }
+
+    return (any ? max / 1000.0 : 0.0);
+}
+
+double HopStats::get_stdev() {
+
+    // the window is small, so 2 passes (mean, then the squared differences
+    // to it) rather than a running sum of squares
+    double mean = get_mean() * 1000.0, sum = 0.0;
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+
+        if (samples[i] != HOP_STATS_LOST) {
+            sum += (samples[i] - mean) * (samples[i] - mean);
+            n++;
+        }
+    }
+
+    return (n > 1 ? sqrt(sum / n) / 1000.0 : 0.0);
+}
+
+double HopStats::get_percentile(double p) {
+
+    uint32_t replies[HOP_STATS_WINDOW];
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (samples[i] != HOP_STATS_LOST)
+            replies[n++] = samples[i];
+    }
+
+    if (n == 0)
+        return 0.0;
+
+    // the rank of the sample we're looking for (1-based)
+    uint32_t rank = (uint32_t) ceil(p * n);
+
+    if (rank < 1)
+        rank = 1;
+
+    if (rank > n)
+        rank = n;
+
+    std::nth_element(replies, replies + (rank - 1), replies + n);
+
+    return replies[rank - 1] / 1000.0;
+}
@@ -0,0 +1,389 @@
+#include <math.h>
+
+#include <iomanip>
+
+#include <arpa/inet.h>
+
+#include "multipath-trace.h"
+
+MultipathTrace::MultipathTrace(int max_ttl, int gap_limit, double confidence)
+    : max_ttl(max_ttl), gap_limit(gap_limit), nr_flows(0), nr_in_flight(0), nr_sent(0) {
+
+    struct mda_hop hop;
+    hop.nr_sent = 0;
+    hop.nr_in_flight = 0;
+    hop.nr_replies = 0;
+    hops.assign(max_ttl + 1, hop);
+
+    struct flow_hop flow_hop;
+    flow_hop.state = NOT_SENT;
+    flow_hop.iface = 0;
+    flow_hops.assign((size_t) MDA_MAX_FLOWS * (max_ttl + 1), flow_hop);
+    end_ttls.assign(MDA_MAX_FLOWS, 0);
+
+    double alpha = 1.0 - (confidence / 100.0);
+
+    if (!(alpha > 0.0 && alpha < 1.0))
+        alpha = 1.0 - (MDA_DEFAULT_CONFIDENCE / 100.0);
+
+    // n(k) is the least n for which the odds of n probes, spread evenly
+    // over k + 1 next hops, missing any of them are at most alpha. by
+    // inclusion-exclusion over the next hops missed :
+    // sum(i = 1..k) (-1)^(i + 1) * C(k + 1, i) * (1 - i / (k + 1))^n
+    uint32_t n = 1;
+
+    for (uint32_t k = 1; ; k++) {
+
+        for ( ; n <= MDA_MAX_FLOWS; n++) {
+
+            double miss = 0.0, binom = 1.0;
+
+            for (uint32_t i = 1; i <= k; i++) {
+
+                binom = binom * (k + 2 - i) / i;
+                miss += ((i & 1) ? 1.0 : -1.0) * binom * pow((double) (k + 1 - i) / (k + 1), n);
+            }
+
+            if (miss <= alpha)
+                break;
+        }
+
+        if (n > MDA_MAX_FLOWS)
+            break;
+
+        stopping_points.push_back(n);
+    }
+}
+
+uint32_t MultipathTrace::get_stopping_point(uint32_t k) {
+
+    // a hop w/o replies (so far) still needs as many probes as one w/ a
+    // single next hop
+    if (k == 0)
+        k = 1;
+
+    // more next hops than flows can tell apart
+    if (k > stopping_points.size())
+        return MDA_MAX_FLOWS + 1;
+
+    return stopping_points[k - 1];
+}
+
+bool MultipathTrace::goes_on(int ttl) {
+
+    for (size_t i = 0; i < hops[ttl].ifaces.size(); i++) {
+        if (!hops[ttl].ifaces[i].is_dst)
+            return true;
+    }
+
+    return false;
+}
+
+bool MultipathTrace::is_eligible(uint16_t flow, int ttl) {
+
+    return (end_ttls[flow] == 0 || ttl <= end_ttls[flow]);
+}
+
+bool MultipathTrace::add_flow(uint16_t & flow) {
+
+    if (nr_flows >= MDA_MAX_FLOWS)
+        return false;
+
+    flow = (uint16_t) nr_flows++;
+
+    return true;
+}
+
+void MultipathTrace::send(uint16_t flow, int ttl, std::vector<struct mda_probe> & probes) {
+
+    get_flow_hop(flow, ttl).state = IN_FLIGHT;
+
+    hops[ttl].nr_sent++;
+    hops[ttl].nr_in_flight++;
+    nr_in_flight++;
+    nr_sent++;
+
+    struct mda_probe probe;
+    probe.flow = flow;
+    probe.ttl = ttl;
+    probes.push_back(probe);
+}
+
+void MultipathTrace::add_next(struct mda_interface & iface, uint32_t addr) {
+
+    for (size_t i = 0; i < iface.next.size(); i++) {
+        if (iface.next[i] == addr)
+            return;
+    }
+
+    iface.next.push_back(addr);
+}
+
+void MultipathTrace::schedule(std::vector<struct mda_probe> & probes, int max) {
+
+    // silent hops in a row
+    int silent = 0;
+
+    for (int ttl = 1; ttl <= max_ttl; ttl++) {
+
+        struct mda_hop & hop = hops[ttl];
+
+        if (ttl == 1 || !goes_on(ttl - 1)) {
+
+            // no interface to start from : the hop is enumerated as a
+            // whole, w/ the flows sent at lower ttls 1st
+            int64_t need = (int64_t) get_stopping_point(hop.ifaces.size()) - hop.nr_sent;
+            uint16_t flow = 0;
+
+            for (flow = 0; flow < nr_flows && need > 0 && (int) probes.size() < max; flow++) {
+
+                if (get_flow_hop(flow, ttl).state == NOT_SENT && is_eligible(flow, ttl)) {
+                    send(flow, ttl, probes);
+                    need--;
+                }
+            }
+
+            for ( ; need > 0 && (int) probes.size() < max && add_flow(flow); need--)
+                send(flow, ttl, probes);
+
+        } else {
+
+            struct mda_hop & prev = hops[ttl - 1];
+            // flows still to be found through interfaces at ttl - 1
+            int64_t deficit = 0;
+
+            for (size_t i = 0; i < prev.ifaces.size(); i++) {
+
+                if (prev.ifaces[i].is_dst)
+                    continue;
+
+                // node control : the next hops of interface i are
+                // enumerated w/ the flows known to go through it
+                int64_t need = get_stopping_point(prev.ifaces[i].next.size());
+
+                for (uint16_t flow = 0; flow < nr_flows; flow++) {
+
+                    struct flow_hop & before = get_flow_hop(flow, ttl - 1);
+
+                    if (before.state == REPLIED && before.iface == i
+                        && get_flow_hop(flow, ttl).state != NOT_SENT)
+                        need--;
+                }
+
+                for (uint16_t flow = 0; flow < nr_flows && need > 0 && (int) probes.size() < max; flow++) {
+
+                    struct flow_hop & before = get_flow_hop(flow, ttl - 1);
+
+                    if (before.state == REPLIED && before.iface == i
+                        && get_flow_hop(flow, ttl).state == NOT_SENT) {
+                        send(flow, ttl, probes);
+                        need--;
+                    }
+                }
+
+                if (need > 0)
+                    deficit += need;
+            }
+
+            // not enough flows go through some interfaces (as far as we
+            // know) : new ones are sent at ttl - 1, to find more. those in
+            // flight there already may do.
+            uint16_t flow = 0;
+
+            for (int64_t n = deficit - prev.nr_in_flight; n > 0 && (int) probes.size() < max && add_flow(flow); n--)
+                send(flow, ttl - 1, probes);
+
+            // interfaces found by flows not sent at ttl - 1 (i.e. new
+            // flows, sent after a silent hop) have no known interface
+            // before them : one of their flows is sent at ttl - 1, to link
+            // them to one
+            for (size_t j = 0; j < hop.ifaces.size() && (int) probes.size() < max; j++) {
+
+                bool linked = false;
+
+                for (size_t i = 0; i < prev.ifaces.size() && !linked; i++) {
+                    for (size_t k = 0; k < prev.ifaces[i].next.size() && !linked; k++)
+                        linked = (prev.ifaces[i].next[k] == hop.ifaces[j].addr.s_addr);
+                }
+
+                int32_t unsent = -1;
+
+                for (uint16_t flow = 0; flow < nr_flows && !linked; flow++) {
+
+                    struct flow_hop & at = get_flow_hop(flow, ttl);
+
+                    if (at.state != REPLIED || at.iface != j)
+                        continue;
+
+                    uint8_t state = get_flow_hop(flow, ttl - 1).state;
+
+                    // one's on its way already
+                    if (state == IN_FLIGHT)
+                        linked = true;
+                    else if (state == NOT_SENT && unsent < 0)
+                        unsent = flow;
+                }
+
+                if (!linked && unsent >= 0)
+                    send((uint16_t) unsent, ttl - 1, probes);
+            }
+        }
+
+        if (goes_on(ttl)) {
+            silent = 0;
+            continue;
+        }
+
+        // the path ends at ttl (all replies came from the destination), or
+        // there's nothing to go on yet
+        if (hop.nr_replies > 0 || hop.nr_in_flight > 0 || hop.nr_sent < get_stopping_point(0))
+            break;
+
+        if (++silent >= gap_limit)
+            break;
+    }
+}
+
+void MultipathTrace::on_reply(uint16_t flow, int ttl, struct in_addr addr, bool is_dst, double rtt) {
+
+    if (flow >= nr_flows || ttl < 1 || ttl > max_ttl)
+        return;
+
+    struct flow_hop & at = get_flow_hop(flow, ttl);
+
+    if (at.state != IN_FLIGHT)
+        return;
+
+    struct mda_hop & hop = hops[ttl];
+    size_t i = 0;
+
+    for (i = 0; i < hop.ifaces.size() && hop.ifaces[i].addr.s_addr != addr.s_addr; i++);
+
+    if (i == hop.ifaces.size()) {
+
+        struct mda_interface iface;
+        iface.addr = addr;
+        iface.is_dst = false;
+        iface.nr_flows = 0;
+        iface.rtt_sum = 0.0;
+        hop.ifaces.push_back(iface);
+    }
+
+    struct mda_interface & iface = hop.ifaces[i];
+    iface.is_dst |= is_dst;
+    iface.nr_flows++;
+    iface.rtt_sum += rtt;
+
+    at.state = REPLIED;
+    at.iface = (uint16_t) i;
+    hop.nr_in_flight--;
+    hop.nr_replies++;
+    nr_in_flight--;
+
+    if (is_dst && (end_ttls[flow] == 0 || ttl < end_ttls[flow]))
+        end_ttls[flow] = (uint8_t) ttl;
+
+    // the flow links its interfaces at ttl - 1, ttl and ttl + 1, whichever
+    // reply comes 1st
+    if (ttl > 1) {
+
+        struct flow_hop & before = get_flow_hop(flow, ttl - 1);
+
+        if (before.state == REPLIED)
+            add_next(hops[ttl - 1].ifaces[before.iface], addr.s_addr);
+    }
+
+    if (ttl < max_ttl) {
+
+        struct flow_hop & after = get_flow_hop(flow, ttl + 1);
+
+        if (after.state == REPLIED)
+            add_next(iface, hops[ttl + 1].ifaces[after.iface].addr.s_addr);
+    }
+}
+
+void MultipathTrace::on_timeout(uint16_t flow, int ttl) {
+
+    if (flow >= nr_flows || ttl < 1 || ttl > max_ttl)
+        return;
+
+    struct flow_hop & at = get_flow_hop(flow, ttl);
+
+    if (at.state != IN_FLIGHT)
+        return;
+
+    at.state = SILENT;
+    hops[ttl].nr_in_flight--;
+    nr_in_flight--;
+}
+
+void MultipathTrace::print(std::ostream & out) {
+
+    for (int ttl = 1; ttl <= max_ttl; ttl++) {
+
+        struct mda_hop & hop = hops[ttl];
+
+        // past the end of the path
+        if (hop.nr_sent == 0)
+            continue;
+
+        out << std::setw(3) << ttl;
+
+        if (hop.ifaces.empty())
+            out << " ? (" << hop.nr_sent << " probes)" << std::endl;
+
+        for (size_t i = 0; i < hop.ifaces.size(); i++) {
+
+            struct mda_interface & iface = hop.ifaces[i];
+
+            if (i > 0)
+                out << std::setw(3) << "";
+
+            out << " " << inet_ntoa(iface.addr) << " (" << iface.nr_flows << "/"
+                << hop.nr_sent << " probes, avg. " << (iface.rtt_sum / iface.nr_flows) << " msec)";
+
+            for (size_t k = 0; k < iface.next.size(); k++) {
+
+                struct in_addr next;
+                next.s_addr = iface.next[k];
+                out << (k == 0 ? " -> " : ", ") << inet_ntoa(next);
+            }
+
+            out << std::endl;
+        }
+    }
+}
+
+void MultipathTrace::print_dot(std::ostream & out) {
+
+    out << "digraph mda {" << std::endl;
+    out << "    rankdir=LR;" << std::endl;
+    out << "    node [shape=box];" << std::endl;
+
+    // an interface may show up at more than one hop (e.g. on paths of
+    // diff. lengths), so nodes are named after (ttl, addr)
+    for (int ttl = 1; ttl <= max_ttl; ttl++) {
+
+        for (size_t i = 0; i < hops[ttl].ifaces.size(); i++) {
+
+            struct mda_interface & iface = hops[ttl].ifaces[i];
+
+            out << "    \"" << ttl << " " << inet_ntoa(iface.addr) << "\" [label=\""
+                << inet_ntoa(iface.addr) << "\\n" << (iface.rtt_sum / iface.nr_flows)
+                << " msec\"" << (iface.is_dst ? ", style=bold" : "") << "];" << std::endl;
+
+            for (size_t k = 0; k < iface.next.size(); k++) {
+
+                struct in_addr next;
+                next.s_addr = iface.next[k];
+
+                // inet_ntoa() returns a static buffer : one call per
+                // statement
+                out << "    \"" << ttl << " " << inet_ntoa(iface.addr) << "\" -> ";
+                out << "\"" << (ttl + 1) << " " << inet_ntoa(next) << "\";" << std::endl;
+            }
+        }
+    }
+
+    out << "}" << std::endl;
+}
@@ -0,0 +1,76 @@
+#include "probe-table.h"
+
+ProbeTable::ProbeTable(uint32_t max_probes)
+    : max_probes(max_probes), nr_probes(0), bits(1) {
+
+    // at least 2x as many slots as probes
+    while ((1ULL << bits) < 2ULL * max_probes)
+        bits++;
+
+    mask = (1U << bits) - 1;
+    slots.assign(1U << bits, inflight_probe());
+}
+
+int ProbeTable::insert(const struct inflight_probe & probe) {
+
+    uint32_t i = get_home(probe.key);
+
+    while (slots[i].key != 0 && slots[i].key != probe.key)
+        i = (i + 1) & mask;
+
+    if (slots[i].key == 0) {
+
+        if (nr_probes >= max_probes)
+            return -1;
+
+        nr_probes++;
+    }
+
+    slots[i] = probe;
+
+    return 0;
+}
+
+struct inflight_probe * ProbeTable::lookup(uint64_t key) {
+
+    if (key == 0)
+        return NULL;
+
+    // the load factor is at most 1/2, so there's always an empty slot to
+    // stop at
+    for (uint32_t i = get_home(key); slots[i].key != 0; i = (i + 1) & mask) {
+        if (slots[i].key == key)
+            return &slots[i];
+    }
+
+    return NULL;
+}
+
+bool ProbeTable::remove(uint64_t key) {
+
+    struct inflight_probe * probe = lookup(key);
+
+    if (probe == NULL)
+        return false;
+
+    uint32_t hole = (uint32_t) (probe - &slots[0]);
+    slots[hole].key = 0;
+    nr_probes--;
+
+    // backward shift : entries after the hole which can't be found w/o it
+    // (i.e. whose home slot isn't in (hole, i]) are moved into it, which
+    // leaves a new hole behind, until an empty slot is reached
+    for (uint32_t i = (hole + 1) & mask; slots[i].key != 0; i = (i + 1) & mask) {
+
+        uint32_t home = get_home(slots[i].key);
+
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+
+            slots[hole] = slots[i];
+            slots[i].key = 0;
+            hole = i;
+        }
+    }
+
+    return true;
+}
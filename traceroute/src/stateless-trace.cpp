@@ -0,0 +1,347 @@
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <string>
+#include <random>
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/ip_icmp.h>
+#include <sys/random.h>         // getrandom()
+
+#include "stateless-trace.h"
+#include "icmp-utils.h"
+
+// the udp src port is the cookie's lower 15 bit, above 32768
+#define STATELESS_SRC_PORT(cookie)  ((uint16_t) (0x8000 | ((cookie) & 0x7FFF)))
+
+StatelessTrace::StatelessTrace(int max_ttl, uint16_t dst_port)
+    : max_ttl(max_ttl), dst_port(dst_port), range_first(0), range_size(0),
+      permutation(NULL), exhausted(false), pending(false),
+      nr_sent(0), nr_hops(0), nr_reached(0), nr_invalid(0) {
+
+    memset(pckt, 0, sizeof(pckt));
+    memset(&dst_addr, 0, sizeof(dst_addr));
+    dst_addr.sin_family = AF_INET;
+    src_addr.s_addr = INADDR_ANY;
+}
+
+StatelessTrace::~StatelessTrace() {
+
+    delete permutation;
+}
+
+int StatelessTrace::parse_cidr(const char * cidr, uint32_t & first, uint64_t & size) {
+
+    std::string str(cidr);
+    int prefix = 32;
+    size_t slash = str.find('/');
+
+    if (slash != std::string::npos) {
+
+        char * end = NULL;
+        prefix = (int) strtol(str.c_str() + slash + 1, &end, 10);
+
+        if (end == str.c_str() + slash + 1 || *end != '\0' || prefix < 0 || prefix > 32) {
+
+            std::cerr << "stateless-trace::parse_cidr() : [ERROR] invalid prefix "\
+                "length in " << cidr << std::endl;
+
+            return -1;
+        }
+
+        str = str.substr(0, slash);
+    }
+
+    struct in_addr addr;
+
+    if (inet_pton(AF_INET, str.c_str(), &addr) != 1) {
+
+        std::cerr << "stateless-trace::parse_cidr() : [ERROR] invalid address in "
+            << cidr << std::endl;
+
+        return -1;
+    }
+
+    // host bits set in the address (e.g. 10.0.0.1/16) are ignored
+    uint32_t mask = (prefix == 0 ? 0 : ~((1ULL << (32 - prefix)) - 1));
+    first = ntohl(addr.s_addr) & mask;
+    size = 1ULL << (32 - prefix);
+
+    return 0;
+}
+
+int StatelessTrace::set_range(const char * cidr) {
+
+    return parse_cidr(cidr, range_first, range_size);
+}
+
+int StatelessTrace::start() {
+
+    // the permutation walks indexes of up to 32 bit
+    if (max_ttl < 1 || max_ttl > 255 || range_size * max_ttl > (1ULL << 32)) {
+
+        std::cerr << "stateless-trace::start() : [ERROR] too many (destination, "\
+            "ttl) pairs (" << range_size << " x " << max_ttl << ")." << std::endl;
+
+        return -1;
+    }
+
+    // a new key per run : cookies can't be predicted (or replayed from an
+    // earlier run) by whoever sees our probes
+    if (getrandom(key, sizeof(key), 0) != sizeof(key)) {
+
+        std::random_device rd;
+        key[0] = ((uint64_t) rd() << 32) | rd();
+        key[1] = ((uint64_t) rd() << 32) | rd();
+    }
+
+    // the udp checksum covers our address (in the pseudo-header), so we
+    // need to know it up front : it's the one the kernel would pick to
+    // reach the range (connect() on a udp socket sends nothing)
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (fd < 0) {
+
+        std::cerr << "stateless-trace::start() : [ERROR] error opening socket: "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(range_first);
+    addr.sin_port = htons(dst_port);
+
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0
+        || getsockname(fd, (struct sockaddr *) &addr, &addr_len) < 0) {
+
+        std::cerr << "stateless-trace::start() : [ERROR] no src address towards "
+            << inet_ntoa(addr.sin_addr) << ": " << strerror(errno) << std::endl;
+
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    src_addr = addr.sin_addr;
+
+    permutation = new CyclicPermutation(range_size * max_ttl);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    return 0;
+}
+
+#define ROTL(x, b) (uint64_t) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND                                        \
+    do {                                                \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0;          \
+        v0 = ROTL(v0, 32);                              \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2;          \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0;          \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2;          \
+        v2 = ROTL(v2, 32);                              \
+    } while (0)
+
+uint64_t StatelessTrace::get_cookie(uint32_t addr) {
+
+    // siphash-2-4 of a single 8 byte block (the address), as in pingy's
+    // IcmpSweep
+    uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+
+    uint64_t m = addr;
+    v3 ^= m;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= m;
+
+    uint64_t b = ((uint64_t) 8) << 56;
+    v3 ^= b;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+uint32_t StatelessTrace::get_elapsed_ms() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    uint64_t elapsed = (uint64_t) (now.tv_sec - start_time.tv_sec) * 1000ULL
+        + (now.tv_nsec - start_time.tv_nsec) / 1000000L;
+
+    return (uint32_t) (elapsed & STATELESS_TIME_MASK);
+}
+
+void StatelessTrace::build(uint32_t addr, int ttl) {
+
+    uint32_t elapsed = get_elapsed_ms();
+
+    struct ip * ip_hdr = (struct ip *) pckt;
+    struct udphdr * udp_hdr = (struct udphdr *) (pckt + 20);
+    uint16_t * data = (uint16_t *) (pckt + 20 + 8);
+
+    dst_addr.sin_addr.s_addr = htonl(addr);
+
+    // the kernel fills in ip_sum (and ip_len), and keeps ip_id since it
+    // isn't 0 (ttl >= 1)
+    ip_hdr->ip_v = 4;
+    ip_hdr->ip_hl = 5;
+    ip_hdr->ip_tos = 0;
+    ip_hdr->ip_len = htons(STATELESS_PCKT_LEN);
+    ip_hdr->ip_id = htons((uint16_t) (((elapsed >> 16) & 0xFF) << 8 | ttl));
+    ip_hdr->ip_off = 0;
+    ip_hdr->ip_ttl = ttl;
+    ip_hdr->ip_p = IPPROTO_UDP;
+    ip_hdr->ip_sum = 0;
+    ip_hdr->ip_src = src_addr;
+    ip_hdr->ip_dst = dst_addr.sin_addr;
+
+    udp_hdr->uh_sport = htons(STATELESS_SRC_PORT(get_cookie(addr)));
+    udp_hdr->uh_dport = htons(dst_port);
+    udp_hdr->uh_ulen = htons(8 + STATELESS_DATA_LEN);
+    udp_hdr->uh_sum = 0;
+    *data = 0;
+
+    // the checksum w/ a 0 payload word, over the pseudo-header (src, dst,
+    // protocol, udp length) and the udp datagram
+    uint16_t pseudo[6 + (8 + STATELESS_DATA_LEN) / 2];
+    memcpy(pseudo, &ip_hdr->ip_src, 4);
+    memcpy(pseudo + 2, &ip_hdr->ip_dst, 4);
+    pseudo[4] = htons(IPPROTO_UDP);
+    pseudo[5] = udp_hdr->uh_ulen;
+    memcpy(pseudo + 6, udp_hdr, 8 + STATELESS_DATA_LEN);
+
+    // the checksum we want (as it's in the packet)
+    uint16_t cksum = htons((uint16_t) (elapsed & 0xFFFF));
+
+    // a 0 checksum means 'no checksum' to the receiver : no payload
+    // tweaking needed for that one. otherwise, the payload word is set so
+    // that the checksum comes out as cksum.
+    if (cksum != 0)
+        *data = ICMPUtils::in_cksum_fixup(ICMPUtils::in_cksum(pseudo, sizeof(pseudo)), 0, cksum);
+
+    udp_hdr->uh_sum = cksum;
+}
+
+int StatelessTrace::send(int socket_fd) {
+
+    if (!pending) {
+
+        uint64_t index = 0;
+
+        if (!permutation->next(index)) {
+            exhausted = true;
+            return 0;
+        }
+
+        build(range_first + (uint32_t) (index / max_ttl), (int) (index % max_ttl) + 1);
+        pending = true;
+    }
+
+    if (sendto(socket_fd, pckt, STATELESS_PCKT_LEN, MSG_DONTWAIT,
+            (struct sockaddr *) &dst_addr, sizeof(dst_addr)) < 0) {
+
+        // send buffer full : try again on the next call. the send time is
+        // a bit off then, but never by more than a few msec.
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR)
+            return 0;
+
+        pending = false;
+
+        // e.g. EACCES for a broadcast address, or ENETUNREACH : skip the
+        // probe, and carry on w/ the rest
+        if (errno == EACCES || errno == ENETUNREACH || errno == EHOSTUNREACH
+            || errno == EPERM || errno == EINVAL)
+            return 1;
+
+        std::cerr << "stateless-trace::send() : [ERROR] error in sendto(): "
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    pending = false;
+    nr_sent++;
+
+    return 1;
+}
+
+int StatelessTrace::process_reply(
+    char * buff, int len,
+    struct sockaddr_in * src,
+    std::ostream & out) {
+
+    if (len < (int) sizeof(struct ip))
+        return 0;
+
+    struct ip * ip_hdr = (struct ip *) buff;
+    int ip_hdr_len = ip_hdr->ip_hl << 2;
+    int icmp_len = len - ip_hdr_len;
+
+    if (ip_hdr->ip_p != IPPROTO_ICMP || icmp_len < 8)
+        return 0;
+
+    struct icmp * icmp_hdr = (struct icmp *) (buff + ip_hdr_len);
+
+    if (icmp_hdr->icmp_type != ICMP_TIMXCEED && icmp_hdr->icmp_type != ICMP_UNREACH)
+        return 0;
+
+    // the quote : the probe's ip header and (at least) its udp header
+    struct ip * inner_ip_hdr = NULL;
+    struct udphdr * udp_hdr = NULL;
+
+    if (ICMPUtils::get_inner_ip_hdr(buff + ip_hdr_len, icmp_len, inner_ip_hdr) < 0
+        || inner_ip_hdr->ip_p != IPPROTO_UDP
+        || icmp_len < 8 + (inner_ip_hdr->ip_hl << 2) + 8
+        || ICMPUtils::get_inner_udp_hdr(buff + ip_hdr_len, icmp_len, udp_hdr) < 0)
+        return 0;
+
+    uint32_t addr = ntohl(inner_ip_hdr->ip_dst.s_addr);
+    uint16_t ip_id = ntohs(inner_ip_hdr->ip_id);
+    int ttl = ip_id & 0xFF;
+
+    // w/ the wrong cookie, it's not ours (e.g. another traceroute's) or it
+    // was mangled on the way
+    if (ntohs(udp_hdr->uh_dport) != dst_port
+        || ntohs(udp_hdr->uh_sport) != STATELESS_SRC_PORT(get_cookie(addr))
+        || ttl < 1 || ttl > max_ttl) {
+
+        nr_invalid++;
+        return 0;
+    }
+
+    uint32_t sent = ((uint32_t) (ip_id >> 8) << 16) | ntohs(udp_hdr->uh_sum);
+    uint32_t rtt = (get_elapsed_ms() - sent) & STATELESS_TIME_MASK;
+
+    char dst_str[INET_ADDRSTRLEN], hop_str[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &inner_ip_hdr->ip_dst, dst_str, sizeof(dst_str));
+    inet_ntop(AF_INET, &src->sin_addr, hop_str, sizeof(hop_str));
+
+    out << dst_str << " " << ttl << " " << hop_str << " " << rtt << " "
+        << (uint16_t) icmp_hdr->icmp_type << " " << (uint16_t) icmp_hdr->icmp_code << "\n";
+
+    if (src->sin_addr.s_addr == inner_ip_hdr->ip_dst.s_addr)
+        nr_reached++;
+
+    nr_hops++;
+
+    return 1;
+}
@@ -0,0 +1,34 @@
+#include "stop-set.h"
+
+StopSet::StopSet(int prefix_len)
+    : prefix_len(prefix_len) {
+
+    if (this->prefix_len < 0)
+        this->prefix_len = 0;
+
+    if (this->prefix_len > 32)
+        this->prefix_len = 32;
+
+    // a shift by 32 is undefined for an uint32_t
+    prefix_mask = (this->prefix_len == 0) ? 0 : (0xFFFFFFFFU << (32 - this->prefix_len));
+}
+
+bool StopSet::lookup(struct in_addr iface, struct in_addr dst, int & remaining) {
+
+    std::unordered_map<uint64_t, int>::iterator it = pairs.find(get_key(iface, dst));
+
+    if (it == pairs.end())
+        return false;
+
+    remaining = it->second;
+
+    return true;
+}
+
+void StopSet::add(struct in_addr iface, struct in_addr dst, int remaining) {
+
+    int & known = pairs[get_key(iface, dst)];
+
+    if (remaining > known)
+        known = remaining;
+}
@@ -1,14 +1,19 @@
 #include <string.h>
+#include <stdlib.h>
 #include <math.h>
 #include <unistd.h>
 #include <errno.h>
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <sys/signalfd.h>
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <sys/socket.h>
 #include <arpa/inet.h>
@@ -18,259 +23,1956 @@
 #include <netinet/in.h>
 #include <netinet/in_systm.h>
 #include <netdb.h>              // getaddrinfo()
+#include <poll.h>
 
 #include "argvparser.h"
-#include "signal-handler.h"
 #include "icmp-utils.h"
+#include "timing-wheel.h"
+#include "probe-table.h"
+#include "stop-set.h"
+#include "stateless-trace.h"
+#include "multipath-trace.h"
+#include "hop-stats.h"
+
+#define UNMATCHED_REPLY     -4
+#define TIMEOUT_REPLY       -3
+#define TTL_EXCEEDED_REPLY  -2
+#define HOSTNAME_HIT_REPLY  -1
+
+#define NUM_RETRIES     1       // send up to NUM_RETRIES udp packets per ttl
+#define REPLY_TIMEOUT   1000    // wait REPLY_TIMEOUT msecs for an icmp reply
+#define TIMEOUT_TICK    10      // resolution of per-probe timeouts (msec)
+#define DST_PORT        (32768 + 666) // this is how Stevens sets the upd dst 
+                                    // port. i'll follow the same (note that 
+                                    // the sockaddr_in->sin_port attr. is a 
+                                    // 16 bit unsigned value, which can go up 
+                                    // till 65536)
+
+#define MAX_TTL         30          // following Stevens' lead again
+
+// icmp echo probes carry less optional data than ICMP_DATA_LEN. after 
+// checking what the real traceroute does (and to avoid fragmentation), we set 
+// it to 32 byte, yielding a 60 byte ipv4 datagram (20 byte ipv4 header, 8 
+// byte icmp header, 32 byte of data).
+#define PROBE_DATA_LEN  32
+
+// paris mode : the checksum all icmp echo probes carry, plus their flow 
+// (see send_probe())
+#define PARIS_ICMP_CKSUM    0x4E4F
+
+// mda mode (see trace_mda()) : max. nr. of probes in flight
+#define MDA_WINDOW          32
+
+// continuous mode (see trace_continuous()) : default probing rate (pps per 
+// hop), and how often the stats are printed (msec)
+#define DEFAULT_CONTINUOUS_RATE     1
+#define CONTINUOUS_REPORT_INTERVAL  1000
+
+// multi-destination mode (see trace_batch()) : nr. of destinations traced 
+// at once, the ttl probing starts from (few paths are shorter), and the nr. 
+// of silent hops in a row after which a path is given up on
+#define BATCH_WINDOW        64
+#define DEFAULT_START_TTL   5
+#define GAP_LIMIT           3
+// seq numbers go from 1 to BATCH_MAX_SEQ, so that DST_PORT + seq fits in 
+// 16 bit
+#define BATCH_MAX_SEQ       (65535 - DST_PORT)
+
+// stateless mode (see trace_stateless()) : default probing rate (pps), and 
+// max. nr. of probes sent in a row before checking for replies
+#define DEFAULT_STATELESS_RATE  1000
+#define STATELESS_BURST         64
+
+#define SERVICE_HTTP    "http"
+// as defined in Steven's unp book, fig. 28.4
+#define MAX_BUFFER_SIZE 1500
+#define MAX_STRING_SIZE 256
+
+#define OPTION_HOSTNAME     (char *) "hostname"
+#define OPTION_USE_PING     (char *) "use-ping"
+#define OPTION_PARALLEL     (char *) "parallel"
+#define OPTION_TIMEOUT      (char *) "timeout"
+#define OPTION_TARGETS      (char *) "targets"
+#define OPTION_START_TTL    (char *) "start-ttl"
+#define OPTION_STATELESS    (char *) "stateless"
+#define OPTION_RATE         (char *) "rate"
+#define OPTION_OUTPUT       (char *) "output"
+#define OPTION_PARIS        (char *) "paris"
+#define OPTION_MDA          (char *) "mda"
+#define OPTION_CONFIDENCE   (char *) "confidence"
+#define OPTION_CONTINUOUS   (char *) "continuous"
+#define OPTION_COUNT        (char *) "count"
+
+using namespace CommandLineProcessing;
+
+struct trace_record {
+    uint16_t seq;
+    uint16_t ttl;
+    struct timeval timestamp;
+};
+
+struct icmp_response {
+    // address of replier
+    sockaddr reply_addr;
+    socklen_t reply_addrlen;
+    // src address as seen by replier
+    struct in_addr req_src_addr;
+    // the trace record of the respective request
+    struct trace_record rsp_rcrd;
+    // response timestamp
+    struct timeval rcv_timestamp;
+};
+
+ArgvParser * create_argv_parser() {
+
+    ArgvParser * parser = new ArgvParser();
+
+    parser->setIntroductoryDescription("\n\nmy traceroute\n\n\nby adamiaonr@gmail.com");
+    parser->setHelpOption("h", "help", "help page");
+
+    parser->defineOption(
+            OPTION_HOSTNAME,
+            "hostname to trace route to",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_USE_PING,
+            "use ICMP ECHO packets (instead of UDP packets) as probes",
+            ArgvParser::NoOptionAttribute);
+
+    parser->defineOption(
+            OPTION_PARALLEL,
+            "send the probes for all ttls at once, instead of one at a time, "\
+            "and print hops as their replies come in",
+            ArgvParser::NoOptionAttribute);
+
+    parser->defineOption(
+            OPTION_PARIS,
+            "paris traceroute : keep the flow identifier (i.e. the udp ports, "\
+            "or the icmp checksum) the same for all probes, so that per-flow "\
+            "load balancers send them all down the same path. udp probes are "\
+            "told apart by their checksum instead.",
+            ArgvParser::NoOptionAttribute);
+
+    parser->defineOption(
+            OPTION_MDA,
+            "w/ --hostname, find all the paths to it through per-flow load "\
+            "balancers (the multipath detection algorithm), w/ paris probes "\
+            "of many flows. hops are printed at the end, w/ the interfaces "\
+            "each one leads to.",
+            ArgvParser::NoOptionAttribute);
+
+    parser->defineOption(
+            OPTION_CONFIDENCE,
+            "w/ --mda, the odds (in %) that no next hop is missed at any "\
+            "interface. default : 95.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_CONTINUOUS,
+            "w/ --hostname, keep probing every hop (as mtr does), and print "\
+            "each hop's loss and rtt stats every second, until CTRL+C.",
+            ArgvParser::NoOptionAttribute);
+
+    parser->defineOption(
+            OPTION_COUNT,
+            "w/ --continuous, stop after this many probes per hop. default : "\
+            "0 (no limit).",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_TIMEOUT,
+            "time to wait for a reply to a probe, in msec. default : 1000.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_TARGETS,
+            "file w/ a list of hostnames to trace route to (one per line), "\
+            "instead of --hostname. hops already seen (by earlier traces) "\
+            "aren't probed again.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_START_TTL,
+            "w/ --targets, the ttl to start probing from (forwards, then "\
+            "backwards). default : 5.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_STATELESS,
+            "stateless mode : probe every (address, ttl) pair in a range (in "\
+            "cidr notation, e.g. 10.0.0.0/16) once, in a random order. "\
+            "replies are decoded from the quoted probe headers alone.",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_RATE,
+            "max. nr. of probes per second in --stateless mode, 0 for no "\
+            "limit (default : 1000), or nr. of probes per second per hop in "\
+            "--continuous mode (default : 1).",
+            ArgvParser::OptionRequiresValue);
+
+    parser->defineOption(
+            OPTION_OUTPUT,
+            "file to write the hops found in --stateless mode to (one per "\
+            "line, default : stdout), or the graph found in --mda mode (in "\
+            "graphviz's dot format).",
+            ArgvParser::OptionRequiresValue);
+
+    return parser;
+}
+
+struct timeval * tv_sub(struct timeval * out, struct timeval * in) {
+
+    if ((out->tv_usec -= in->tv_usec) < 0) {   /* out -= in */
+
+        --out->tv_sec;
+        out->tv_usec += 1000000;
+    }
+    
+    out->tv_sec -= in->tv_sec;
+
+    return out;
+}
+
+double to_msec(struct timeval tv) {
+
+    return (tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0);
+}
+
+// parses an icmp packet (ip header included) read from the reply socket. if 
+// it may be a reply to an icmp echo or udp probe, rsp_key is set to the 
+// probe's key in the ProbeTable (see probe-table.h), from the identifiers it 
+// quotes (or echoes) back, and the following is returned :
+//  -# TTL_EXCEEDED_REPLY : the probe's ttl expired at some router
+//  -# HOSTNAME_HIT_REPLY : the probe got to hostname (an icmp echo reply, or 
+//     an icmp port unreachable for udp probes)
+//  -# the icmp code (>= 0), for any other icmp unreachable
+// UNMATCHED_REPLY is returned for anything else. whether the probe is one of 
+// ours is up to the ProbeTable. in paris mode, udp probes are identified by 
+// their checksum (see send_probe()), so it goes in the key too.
+int parse_icmp_response(
+    char * rcv_buff,
+    int rcv_bytes,
+    bool paris,
+    uint64_t & rsp_key,
+    struct icmp_response & icmp_rsp) {
+
+    struct icmp * icmp_hdr = NULL, * inner_icmp_hdr = NULL;
+    struct udphdr * udp_hdr = NULL;
+
+    if (rcv_bytes < (int) sizeof(struct ip))
+        return UNMATCHED_REPLY;
+
+    // read ipv4 header encapsulating the icmp reply
+    struct ip * ipv4_hdr = (struct ip *) rcv_buff;
+    // 1) ipv4 header len : in ipv4, the header length isn't fixed (in 
+    //    ipv6, it is fixed as 40 byte). this is the total length of the header, 
+    //    including options. therefore we must retrieve it to know 'where' the 
+    //    icmp header starts. 
+    // 2) note the '<< 2': the length field is 4 bit long, represented in 
+    //    '4 byte blocks' units. thus, to get the length in byte units, we 
+    //     multiply it by 4, i.e. the same as left-shifting by 2 bit ('<< 2').
+    int ipv4_hdr_len = ipv4_hdr->ip_hl << 2;
+    // if the protocol field isn't ICMP, abort.
+    if (ipv4_hdr->ip_p != IPPROTO_ICMP) {
+        std::cerr << "traceroute::parse_icmp_response() : [ERROR] not an ICMP "\
+            "packet. skip processing." << std::endl;
+        return UNMATCHED_REPLY;
+    }
+
+    // with the ipv4 header length, get the start of the icmp header
+    icmp_hdr = (struct icmp *) (rcv_buff + ipv4_hdr_len);
+    // the icmp_len should be at least 8 byte (size of icmp header). if not, abort.
+    int icmp_len = 0;
+    if ((icmp_len = rcv_bytes - ipv4_hdr_len) < 8) {
+        std::cerr << "traceroute::parse_icmp_response() : [ERROR] malformed ICMP "\
+            "packet. header too short (" << icmp_len << " byte). skip "\
+            "processing." << std::endl;  
+        return UNMATCHED_REPLY;
+    }
+
+    // check if type = ICMP_TIMXCEED AND code = ICMP_TIMXCEED_INTRANS, or 
+    // an ICMP_UNREACH
+    if ((icmp_hdr->icmp_type == ICMP_TIMXCEED && icmp_hdr->icmp_code == ICMP_TIMXCEED_INTRANS) 
+        || icmp_hdr->icmp_type == ICMP_UNREACH) {
+
+        // 'icmp error messages contain a data section that includes a copy 
+        // of the entire ipv4 header, plus the first eight bytes of data 
+        // from the ipv4 packet that caused the error message' [wikipedia]
+
+        // we extract diff. info from the inner ipv4 packet, depending on 
+        // the probing method (probes can be icmp echo packets or udp packets)
+        //  - if udp, the src port (the same for all our probes) and the dst 
+        //    port (which gives away the seq number)
+        //  - if icmp echo, the identifier and seq number of the inner icmp 
+        //    echo copy
+
+        // get ip header of inner copy, and fetch the src address as 
+        // seen by the replier
+        struct ip * inner_ipv4_hdr = NULL;
+        if (ICMPUtils::get_inner_ip_hdr(rcv_buff + ipv4_hdr_len, icmp_len, inner_ipv4_hdr) < 0)
+            return UNMATCHED_REPLY;
+        icmp_rsp.req_src_addr = inner_ipv4_hdr->ip_src;
+
+        if (inner_ipv4_hdr->ip_p == IPPROTO_ICMP) {
+
+            // get icmp packet encapsulated within the inner ipv4 packet 
+            if (ICMPUtils::get_inner_icmp_hdr(rcv_buff + ipv4_hdr_len, icmp_len, inner_icmp_hdr) < 0)
+                return UNMATCHED_REPLY;
+
+            if (inner_icmp_hdr->icmp_type != ICMP_ECHO)
+                return UNMATCHED_REPLY;
+
+            rsp_key = ProbeTable::make_key(
+                IPPROTO_ICMP, ntohs(inner_icmp_hdr->icmp_id), ntohs(inner_icmp_hdr->icmp_seq));
+
+            // routers only have to quote the 1st 8 byte of the probe (i.e. 
+            // its icmp header). if they quote more, we get the trace_record 
+            // as well.
+            int inner_icmp_len = icmp_len - 8 - (inner_ipv4_hdr->ip_hl << 2);
+            if (inner_icmp_len >= 8 + (int) sizeof(struct trace_record))
+                icmp_rsp.rsp_rcrd = *((struct trace_record *) inner_icmp_hdr->icmp_data);
+
+        } else if (inner_ipv4_hdr->ip_p == IPPROTO_UDP) {
+
+            if (ICMPUtils::get_inner_udp_hdr(rcv_buff + ipv4_hdr_len, icmp_len, udp_hdr) < 0)
+                return UNMATCHED_REPLY;
+
+            if (!paris) {
+
+                rsp_key = ProbeTable::make_key(
+                    IPPROTO_UDP, ntohs(udp_hdr->uh_sport), ntohs(udp_hdr->uh_dport));
+
+            } else {
+
+                // the checksum is in the 2nd half of the udp header, which 
+                // get_inner_udp_hdr() doesn't check for
+                if (icmp_len < 8 + (inner_ipv4_hdr->ip_hl << 2) + 8)
+                    return UNMATCHED_REPLY;
+
+                rsp_key = ProbeTable::make_key(
+                    IPPROTO_UDP, ntohs(udp_hdr->uh_sport), 
+                    ((uint32_t) ntohs(udp_hdr->uh_dport) << 16) | ntohs(udp_hdr->uh_sum));
+            }
+
+        } else {
+
+            return UNMATCHED_REPLY;
+        }
+
+        if (icmp_hdr->icmp_type == ICMP_TIMXCEED)
+            return TTL_EXCEEDED_REPLY;
+
+        // an udp probe hitting an unused port means it got to hostname
+        if (inner_ipv4_hdr->ip_p == IPPROTO_UDP && icmp_hdr->icmp_code == ICMP_UNREACH_PORT)
+            return HOSTNAME_HIT_REPLY;
+
+        return icmp_hdr->icmp_code;
+
+    } else if (icmp_hdr->icmp_type == ICMP_ECHOREPLY) {
+
+        rsp_key = ProbeTable::make_key(
+            IPPROTO_ICMP, ntohs(icmp_hdr->icmp_id), ntohs(icmp_hdr->icmp_seq));
+        icmp_rsp.req_src_addr = ipv4_hdr->ip_dst;
+
+        // an echo reply carries the whole payload of the request
+        if (icmp_len >= 8 + (int) sizeof(struct trace_record))
+            icmp_rsp.rsp_rcrd = *((struct trace_record *) icmp_hdr->icmp_data);
+
+        return HOSTNAME_HIT_REPLY;
+    }
+
+    return UNMATCHED_REPLY;
+}
+
+// if this is an icmp packet but not of the intended type (or not for the 
+// probe we're waiting for), post the contents anyway...
+void print_unexpected_response(char * rcv_buff, int rcv_bytes) {
+
+    if (rcv_bytes < (int) sizeof(struct ip))
+        return;
+
+    struct ip * ipv4_hdr = (struct ip *) rcv_buff;
+    int ipv4_hdr_len = ipv4_hdr->ip_hl << 2;
+    int icmp_len = rcv_bytes - ipv4_hdr_len;
+
+    if (ipv4_hdr->ip_p != IPPROTO_ICMP || icmp_len < 8)
+        return;
+
+    struct icmp * icmp_hdr = (struct icmp *) (rcv_buff + ipv4_hdr_len);
+
+    std::cerr << "traceroute::get_icmp_response() : [WARNING] not an expected "\
+        << "ICMP reply. processing anyway..." << std::endl;
+
+    std::cout << "got " << icmp_len << " bytes from " 
+        << inet_ntoa(ipv4_hdr->ip_src)
+        << " : type = " << (uint16_t) icmp_hdr->icmp_type 
+        << ", code = " << (uint16_t) icmp_hdr->icmp_code << std::endl;    
+}
+
+// sets deadline to timeout_ms msecs from now. deadlines are kept on 
+// CLOCK_MONOTONIC, so that they aren't moved by changes to the wall clock.
+void set_deadline(struct timespec & deadline, int timeout_ms) {
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+}
+
+// msecs left until deadline, rounded up (so that poll() doesn't return 
+// early, only to be called again w/ a 0 timeout), or 0 if it's past
+int get_remaining_ms(struct timespec & deadline) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    int64_t remaining_ns = (int64_t) (deadline.tv_sec - now.tv_sec) * 1000000000LL 
+        + (deadline.tv_nsec - now.tv_nsec);
+
+    if (remaining_ns <= 0)
+        return 0;
+
+    return (int) ((remaining_ns + 999999) / 1000000);
+}
+
+// the key of our probe w/ seq number seq in the ProbeTable : icmp echos 
+// carry the (16 bit) pid as identifier, and udp probes leave from 
+// snd_src_port, to DST_PORT + seq. in paris mode, udp probes all go to 
+// DST_PORT + flow, w/ seq as their checksum.
+uint64_t get_probe_key(bool use_icmp_probe, bool paris, uint16_t flow, uint16_t snd_src_port, int seq) {
+
+    if (use_icmp_probe)
+        return ProbeTable::make_key(IPPROTO_ICMP, (uint16_t) (getpid() & 0xFFFF), (uint16_t) seq);
+
+    if (paris)
+        return ProbeTable::make_key(
+            IPPROTO_UDP, snd_src_port, ((uint32_t) (DST_PORT + flow) << 16) | (uint16_t) seq);
+
+    return ProbeTable::make_key(IPPROTO_UDP, snd_src_port, (uint16_t) (DST_PORT + seq));
+}
+
+// the address the kernel picks as src for packets to dst_addr (connect() 
+// on an udp socket sends nothing). returns 0 on success, -1 on error.
+int get_src_addr(struct sockaddr_in * dst_addr, struct in_addr & src_addr) {
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (fd < 0) {
+
+        std::cerr << "traceroute::get_src_addr() : [ERROR] error opening socket: " 
+            << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    memcpy(&addr, dst_addr, sizeof(addr));
+    addr.sin_port = htons(DST_PORT);
+
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 
+        || getsockname(fd, (struct sockaddr *) &addr, &addr_len) < 0) {
+
+        std::cerr << "traceroute::get_src_addr() : [ERROR] no src address towards " 
+            << inet_ntoa(dst_addr->sin_addr) << ": " << strerror(errno) << std::endl;
+
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    src_addr = addr.sin_addr;
+
+    return 0;
+}
+
+// sets the last 16 bit word of an udp payload (of even length), so that the 
+// checksum the kernel gives the datagram (from src_addr and src_port, to 
+// dst_addr) comes out as cksum (host byte order, not 0 nor 0xFFFF)
+void set_udp_cksum(
+    char * payload,
+    int payload_len,
+    struct in_addr src_addr,
+    struct sockaddr_in * dst_addr,
+    uint16_t src_port,
+    uint16_t cksum) {
+
+    // the pseudo-header (src, dst, protocol, udp length), the udp header 
+    // (w/ a 0 checksum) and the payload (w/ a 0 last word)
+    uint16_t pseudo[(12 + 8 + MAX_BUFFER_SIZE) / 2];
+    uint16_t udp_len = htons(8 + payload_len);
+
+    memcpy(pseudo, &src_addr, 4);
+    memcpy(pseudo + 2, &dst_addr->sin_addr, 4);
+    pseudo[4] = htons(IPPROTO_UDP);
+    pseudo[5] = udp_len;
+    pseudo[6] = htons(src_port);
+    pseudo[7] = dst_addr->sin_port;
+    pseudo[8] = udp_len;
+    pseudo[9] = 0;
+
+    memset(payload + payload_len - 2, 0, 2);
+    memcpy(pseudo + 10, payload, payload_len);
+
+    uint16_t word = ICMPUtils::in_cksum_fixup(
+        ICMPUtils::in_cksum(pseudo, 12 + 8 + payload_len), 0, htons(cksum));
+    memcpy(payload + payload_len - 2, &word, 2);
+}
+
+// a reply to a probe which already timed out (e.g. for a lower ttl than the 
+// one being probed now). it's too late for the trace, but we say who it 
+// came from anyway.
+void print_late_reply(struct inflight_probe & probe, struct icmp_response & icmp_rsp) {
+
+    std::cout << "traceroute : [INFO] late reply from " 
+        << inet_ntoa(((struct sockaddr_in *) &icmp_rsp.reply_addr)->sin_addr) 
+        << " to probe w/ ttl " << probe.ttl << " (seq " << probe.seq << "), after " 
+        << to_msec(*(tv_sub(&icmp_rsp.rcv_timestamp, &probe.snd_timestamp))) << " msec" 
+        << std::endl;
+}
+
+// waits up to timeout_ms msecs for the reply to the probe w/ key snd_key, 
+// w/ poll() on the reply socket. replies to other probes in inflight 
+// (i.e. late ones) are reported as such, and anything else received 
+// meanwhile is printed and dropped. probes are removed from inflight as 
+// their replies come in. returns TIMEOUT_REPLY if the reply doesn't make it 
+// in time, otherwise the same as parse_icmp_response().
+int get_icmp_response(
+    int rcv_sckt_fd,
+    ProbeTable * inflight,
+    bool paris,
+    uint64_t snd_key,
+    int timeout_ms,
+    struct icmp_response & icmp_rsp) {
+
+    int rcv_bytes = 0, return_code = 0;
+    uint64_t rsp_key = 0;
+    char rcv_buff[MAX_STRING_SIZE] = "";
+
+    struct timespec deadline;
+    set_deadline(deadline, timeout_ms);
+
+    struct pollfd rcv_poll;
+    rcv_poll.fd = rcv_sckt_fd;
+    rcv_poll.events = POLLIN;
+
+    for ( ; ; ) {
+
+        // unrelated packets don't extend the wait : each poll() only gets 
+        // what's left until the deadline
+        int remaining_ms = get_remaining_ms(deadline);
+
+        if (remaining_ms == 0)
+            return TIMEOUT_REPLY;
+
+        int rc = poll(&rcv_poll, 1, remaining_ms);
+
+        if (rc < 0) {
+
+            if (errno != EINTR) {
+                std::cerr << "traceroute::get_icmp_response() : [ERROR] error in poll(): " 
+                    << strerror(errno) << std::endl;
+            }
+
+            continue;
+        }
+
+        if (rc == 0)
+            return TIMEOUT_REPLY;
+
+        // get response bytes and fill the address of replier in icmp_rsp
+        icmp_rsp.reply_addrlen = sizeof(icmp_rsp.reply_addr);
+        if ((rcv_bytes = recvfrom(
+                            rcv_sckt_fd, rcv_buff, sizeof(rcv_buff), MSG_DONTWAIT, 
+                            &icmp_rsp.reply_addr, &icmp_rsp.reply_addrlen)) < 0) {
+
+            if (errno != EINTR && errno != EAGAIN) {
+                std::cerr << "traceroute::get_icmp_response() : [ERROR] error in recvfrom(): " 
+                    << strerror(errno) << std::endl;
+            }
+
+            continue;
+        }
+
+        return_code = parse_icmp_response(rcv_buff, rcv_bytes, paris, rsp_key, icmp_rsp);
+
+        struct inflight_probe * probe = NULL;
+
+        if (return_code == UNMATCHED_REPLY || (probe = inflight->lookup(rsp_key)) == NULL) {
+            print_unexpected_response(rcv_buff, rcv_bytes);
+            continue;
+        }
+
+        // save time of reception in icmp_rsp
+        gettimeofday(&icmp_rsp.rcv_timestamp, NULL);
+
+        // a reply to the probe we've just sent
+        if (rsp_key == snd_key) {
+            inflight->remove(rsp_key);
+            break;
+        }
+
+        print_late_reply(*probe, icmp_rsp);
+        inflight->remove(rsp_key);
+    }
+
+    return return_code;
+}
+
+// sends a probe w/ the given ttl and seq number to hostname's address 
+// (in answer) : an icmp echo (from probes) or a udp datagram (from 
+// snd_src_port), and adds it to inflight, w/ the given index. in paris 
+// mode, the probe's flow identifier is the same as all others' w/ the same 
+// flow (see below), and src_addr is our address towards hostname. the time at which it left 
+// is saved in snd_timestamp. returns 0 on success, -1 if the ttl can't be 
+// set, or if there's no room left in inflight.
+int send_probe(
+    int snd_sckt_fd,
+    int ttl,
+    int seq,
+    bool use_icmp_probe,
+    bool paris,
+    uint16_t flow,
+    struct in_addr src_addr,
+    uint16_t snd_src_port,
+    ICMPProbePool * probes,
+    struct addrinfo * answer,
+    ProbeTable * inflight,
+    uint32_t index,
+    struct timeval & snd_timestamp) {
+
+    // buffer to hold payload of udp packets (snd messages)
+    char snd_buff[MAX_BUFFER_SIZE];
+    int snd_buff_len = 0;
+    // what goes out : snd_buff, or the icmp probe
+    char * snd_pckt = snd_buff;
+
+    // we can use setsockopt() to set the ttl value in the outgoing udp 
+    // datagrams. the option to set is IP_TTL. the setsockopt() interface 
+    // goes as follows:
+    //  -# fd of socket to set option
+    //  -# the protocol level at which the option resides. in our case, the 
+    //     ttl field is in the ipv4 header, so IPPROTO_IP
+    //  -# option name, IP_TTL
+    //  -# the option value (void *). here we leave a int * (&ttl)
+    //  -# size of the option : sizeof(int)
+    if (setsockopt(snd_sckt_fd, IPPROTO_IP, IP_TTL, &ttl, sizeof(int)) < 0) {
+        std::cerr << "traceroute::send_probe() : [ERROR] error setting ttl: "
+            << strerror(errno) << std::endl;
+        return -1;            
+    }
+
+    // to match icmp reply to sent packets (either icmp or udp), we 
+    // set the following info on the payload:
+    //  -# sequence number
+    //  -# ttl packet left with
+    //  -# time at which packet left (struct timeval)
+    // this is kept in a struct (struct trace_record), defined above
+    struct trace_record rcrd;
+    rcrd.seq = seq;
+    rcrd.ttl = ttl;
+    gettimeofday(&(rcrd.timestamp), NULL);
+    snd_timestamp = rcrd.timestamp;
+
+    // depending on the type of packet to send, we set the contents of 
+    // snd_buff differently
+    if (use_icmp_probe) {
+
+        // the seq number of the icmp message follows seq. only it, 
+        // the trace_record (right after the icmp header) and the 
+        // checksum change from probe to probe : the checksum is 
+        // updated for those, rather than re-calculated over the 
+        // probe's entire length.
+        snd_pckt = (char *) probes->stamp(0, (uint16_t) seq, &rcrd, sizeof(rcrd));
+        snd_buff_len = probes->get_pckt_len();
+
+        // load balancers which look past the ip header see the icmp type, 
+        // code and checksum. in paris mode, the last word of the data 
+        // makes up for the seq number and trace_record, so that the 
+        // checksum only changes w/ the flow.
+        if (paris)
+            probes->pin_cksum(0, PROBE_DATA_LEN - 2, htons(PARIS_ICMP_CKSUM + flow));
+
+    } else if (!paris) {
+
+        // if an udp packet, the trace_record is all there is to it
+        memcpy(snd_buff, &rcrd, sizeof(rcrd));
+        snd_buff_len = sizeof(struct trace_record);
+
+        // set the port of the outgoing udp packet to a diff. value than 
+        // before. we alter the struct sockaddr snd_addr to accomplish 
+        // that, first by typecasting the general struct to a AF_INET 
+        // sockaddr_in. the sin_port attribute must respect network byte 
+        // ordering.
+        ((struct sockaddr_in *) answer->ai_addr)->sin_port = htons(DST_PORT + seq);
+
+    } else {
+
+        // paris mode : the dst port stays the same for a flow, so the 
+        // 5-tuple (i.e. what per-flow load balancers hash on) does too. 
+        // probes are told apart by their checksum, which the word after 
+        // the trace_record sets to seq.
+        memcpy(snd_buff, &rcrd, sizeof(rcrd));
+        snd_buff_len = sizeof(struct trace_record) + 2;
+
+        ((struct sockaddr_in *) answer->ai_addr)->sin_port = htons(DST_PORT + flow);
+
+        set_udp_cksum(
+            snd_buff, snd_buff_len, src_addr, 
+            (struct sockaddr_in *) answer->ai_addr, snd_src_port, (uint16_t) seq);
+    }
+
+    // send the probe. paris udp probes are corked (MSG_MORE), and pushed by 
+    // an empty send : a corked datagram gets its checksum from the kernel, 
+    // rather than from the nic (tx checksum offload). w/ offload, the 
+    // checksum is only filled in on the wire, so virtual links (veth, 
+    // virtio) can carry, and routers quote back, just its pseudo-header 
+    // part.
+    int snd_flags = (paris && !use_icmp_probe ? MSG_MORE : 0);
+
+    if (sendto(snd_sckt_fd, snd_pckt, snd_buff_len, snd_flags, answer->ai_addr, answer->ai_addrlen) < 0
+        || (snd_flags && sendto(snd_sckt_fd, NULL, 0, 0, answer->ai_addr, answer->ai_addrlen) < 0)) {
+
+        std::cerr << "traceroute::send_probe() : [ERROR] error sending packet: "
+            << strerror(errno) << std::endl;                
+    }
+
+    // the probe's now in flight : replies are matched to it by key
+    struct inflight_probe probe;
+    probe.key = get_probe_key(use_icmp_probe, paris, flow, snd_src_port, seq);
+    probe.ttl = ttl;
+    probe.seq = seq;
+    probe.index = index;
+    probe.snd_timestamp = snd_timestamp;
+
+    if (inflight->insert(probe) < 0) {
+        std::cerr << "traceroute::send_probe() : [ERROR] too many probes in flight." 
+            << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+// prints a reply to a probe sent at snd_timestamp, after the hop's ttl : 
+// the address of the replier (and its name, if it resolves) if it differs 
+// from the last one printed for this hop, the src address as seen by the 
+// replier, and the rtt.
+void print_hop_reply(
+    struct icmp_response & icmp_rsp,
+    struct sockaddr & last_rcv_addr,
+    struct timeval snd_timestamp,
+    int icmp_rc) {
+
+    // if for some reason the ip address of the icmp reply changes 
+    // when compared to the previous, we print a <hostname> (if 
+    // possible) (<ipv4 address>) message. we use memcmp() for that, 
+    // which compares the first n bytes of 2 const void *.
+    if (memcmp(
+        &last_rcv_addr,
+        &icmp_rsp.reply_addr, 
+        sizeof(struct sockaddr_in)) != 0) {
+
+        char reply_hostname[MAX_STRING_SIZE] = "";
+
+        // getnameinfo() has a 0 success return code
+        if (getnameinfo(
+                &icmp_rsp.reply_addr, icmp_rsp.reply_addrlen, 
+                reply_hostname, sizeof(reply_hostname),
+                NULL, 0, 0) == 0) {
+
+            std::cout << " " << inet_ntoa(((struct sockaddr_in *) &icmp_rsp.reply_addr)->sin_addr) 
+                << " (" << reply_hostname << ")";
+        } else {
+            std::cout << " " << inet_ntoa(((struct sockaddr_in *) &icmp_rsp.reply_addr)->sin_addr);                        
+        }
+
+        // keep track of the rcv_addr which was received last
+        memcpy(&last_rcv_addr, &icmp_rsp.reply_addr, sizeof(struct sockaddr_in));
+    }
+
+    // print the src ip seen by the replier
+    std::cout << " (" << inet_ntoa(icmp_rsp.req_src_addr) << ")";
+
+    // print the rtt of the snd probe > rcv icmp cycle
+    std::cout << " " << to_msec(*(tv_sub(&icmp_rsp.rcv_timestamp, &snd_timestamp))) << " msec";
+
+    if (icmp_rc >= 0)
+        std::cout << " unknown icmp code (" << icmp_rc << ")";
+}
+
+// hop-parallel mode : rather than waiting for the reply to each probe before 
+// sending the next, the probes for all ttls (NUM_RETRIES per ttl) are sent 
+// back to back. replies are then matched to their probes as they arrive, 
+// through a ProbeTable (see probe-table.h). the probe gives away the ttl : 
+// seq = (ttl - 1) * NUM_RETRIES + retry + 1. a hop is 
+// printed as soon as all its probes are answered (or timed out), and all 
+// hops before it were printed. each probe gets a timeout of its own, of 
+// timeout_ms msecs from the time it left, kept in a timing wheel (see 
+// timing-wheel.h). the trace ends once all hops up to hostname are printed : 
+// about one rtt to hostname, unless some hops stay silent.
+int trace_parallel(
+    int snd_sckt_fd,
+    int rcv_sckt_fd,
+    int snd_src_port,
+    bool use_icmp_probe,
+    bool paris,
+    struct in_addr src_addr,
+    ICMPProbePool * probes,
+    struct addrinfo * answer,
+    int timeout_ms) {
+
+    struct parallel_probe {
+        struct timeval snd_timestamp;
+        struct icmp_response icmp_rsp;
+        int icmp_rc;
+        bool replied;
+        bool timed_out;
+        uint64_t timer;
+    };
+
+    // indexed by seq - 1
+    int nr_probes = MAX_TTL * NUM_RETRIES;
+    std::vector<struct parallel_probe> sent(nr_probes);
+    ProbeTable inflight(nr_probes);
+
+    TimingWheel timeouts(nr_probes, (uint64_t) TIMEOUT_TICK * 1000000ULL);
+
+    for (int seq = 1; seq <= nr_probes; seq++) {
+
+        sent[seq - 1].replied = false;
+        sent[seq - 1].timed_out = false;
+
+        if (send_probe(
+                snd_sckt_fd, ((seq - 1) / NUM_RETRIES) + 1, seq, 
+                use_icmp_probe, paris, 0, src_addr, snd_src_port, probes, answer, 
+                &inflight, seq - 1, sent[seq - 1].snd_timestamp) < 0)
+            return -1;
+
+        sent[seq - 1].timer = timeouts.insert((uint64_t) timeout_ms * 1000000ULL, seq - 1);
+    }
+
+    // a probe whose timeout expires is given up on
+    auto on_timeout = [] (uint64_t data, void * arg) {
+        (*((std::vector<struct parallel_probe> *) arg))[data].timed_out = true;
+    };
+
+    // the ttl at which hostname answered : later hops aren't printed
+    int last_ttl = MAX_TTL;
+    // the next hop to print
+    int next_ttl = 1;
+
+    auto print_hop = [&] (int ttl) {
+
+        struct sockaddr last_rcv_addr;
+        bzero(&last_rcv_addr, sizeof(struct sockaddr_in));
+
+        // the displayed lines should start w/ the sending ttl
+        std::cout << std::setw(log(MAX_TTL)) << ttl;
+
+        for (int retry = 0; retry < NUM_RETRIES; retry++) {
+
+            struct parallel_probe & probe = sent[((ttl - 1) * NUM_RETRIES) + retry];
+
+            if (!probe.replied)
+                std::cout << " ?";
+            else
+                print_hop_reply(probe.icmp_rsp, last_rcv_addr, probe.snd_timestamp, probe.icmp_rc);
+        }
+
+        std::cout << std::endl;
+    };
+
+    auto is_hop_complete = [&] (int ttl) {
+
+        for (int retry = 0; retry < NUM_RETRIES; retry++) {
+
+            struct parallel_probe & probe = sent[((ttl - 1) * NUM_RETRIES) + retry];
+
+            if (!probe.replied && !probe.timed_out)
+                return false;
+        }
+
+        return true;
+    };
+
+    char rcv_buff[MAX_STRING_SIZE] = "";
+    struct pollfd rcv_poll;
+    rcv_poll.fd = rcv_sckt_fd;
+    rcv_poll.events = POLLIN;
+
+    while (next_ttl <= last_ttl) {
+
+        timeouts.advance(on_timeout, &sent);
+
+        if (is_hop_complete(next_ttl)) {
+            print_hop(next_ttl++);
+            continue;
+        }
+
+        // wait for replies, but no longer than a tick, so that timeouts 
+        // are noticed
+        int rc = poll(&rcv_poll, 1, TIMEOUT_TICK);
+
+        if (rc < 0) {
+
+            if (errno == EINTR)
+                continue;
+
+            std::cerr << "traceroute::trace_parallel() : [ERROR] error in poll(): " 
+                << strerror(errno) << std::endl;
+
+            return -1;
+        }
+
+        if (rc == 0)
+            continue;
+
+        struct icmp_response icmp_rsp;
+        icmp_rsp.reply_addrlen = sizeof(icmp_rsp.reply_addr);
+
+        int rcv_bytes = recvfrom(
+            rcv_sckt_fd, rcv_buff, sizeof(rcv_buff), MSG_DONTWAIT, 
+            &icmp_rsp.reply_addr, &icmp_rsp.reply_addrlen);
+
+        if (rcv_bytes < 0)
+            continue;
+
+        uint64_t rsp_key = 0;
+        struct inflight_probe * match = NULL;
+        int icmp_rc = parse_icmp_response(rcv_buff, rcv_bytes, paris, rsp_key, icmp_rsp);
+
+        // e.g. our own icmp echo probes (on loopback), replies to other 
+        // processes, or a 2nd reply to the same probe
+        if (icmp_rc == UNMATCHED_REPLY || (match = inflight.lookup(rsp_key)) == NULL)
+            continue;
+
+        gettimeofday(&icmp_rsp.rcv_timestamp, NULL);
+
+        uint32_t index = match->index;
+        int ttl = match->ttl;
+
+        // a reply whose probe has timed out (i.e. whose timer can't be 
+        // cancelled) is reported as late, as in the serial mode
+        if (!timeouts.cancel(sent[index].timer))
+            print_late_reply(*match, icmp_rsp);
+
+        inflight.remove(rsp_key);
+
+        if (sent[index].timed_out)
+            continue;
+
+        struct parallel_probe & probe = sent[index];
+        probe.icmp_rsp = icmp_rsp;
+        probe.icmp_rc = icmp_rc;
+        probe.replied = true;
+
+        // hostname (or an unreachable, which nothing past it will answer) 
+        // ends the path
+        if ((icmp_rc == HOSTNAME_HIT_REPLY || icmp_rc >= 0) && ttl < last_ttl)
+            last_ttl = ttl;
+    }
+
+    return 0;
+}
+
+// a destination of a multi-destination trace (see trace_batch())
+struct batch_trace {
+    char hostname[MAX_STRING_SIZE];
+    struct sockaddr_in dst_addr;
+    // points to dst_addr, as send_probe() wants it
+    struct addrinfo dst;
+    // our address towards dst_addr (paris mode only)
+    struct in_addr src_addr;
+    // probing backwards (towards us), after probing forwards
+    bool backward;
+    int ttl;
+    int retries_left;
+    // consecutive silent hops, while probing forwards
+    int silent;
+    // the last hop of the path : where probing forwards stopped, or the 
+    // lowest ttl at which the destination answered
+    int end_ttl;
+    bool reached;
+    // probing forwards stopped at a known (interface, prefix) pair, w/ 
+    // remaining hops known past it
+    bool fwd_stopped;
+    int remaining;
+    // the ttl at which probing backwards stopped at a known interface, 0 if 
+    // it went all the way
+    int bwd_stop_ttl;
+    // the probe in flight
+    uint64_t key;
+    uint64_t timer;
+    struct batch_hop {
+        bool probed;
+        bool replied;
+        struct in_addr addr;
+        double rtt;
+        int icmp_rc;
+    } hops[MAX_TTL + 1];
+};
+
+// reads the destinations of a multi-destination trace from filename, one 
+// hostname (or address) per line ('#' starts a comment). hostnames which 
+// don't resolve are skipped. returns the nr. of destinations added, -1 on 
+// error.
+int load_batch_targets(const char * filename, std::vector<struct batch_trace> & traces) {
+
+    std::ifstream file(filename);
+
+    if (!file.is_open()) {
+
+        std::cerr << "traceroute::load_batch_targets() : [ERROR] could not open "\
+            "target file " << filename << std::endl;
+
+        return -1;
+    }
+
+    int added = 0;
+    std::string line;
+
+    while (std::getline(file, line)) {
+
+        // trim leading and trailing whitespace
+        size_t start = line.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos)
+            continue;
+        size_t end = line.find_last_not_of(" \t\r\n");
+        line = line.substr(start, end - start + 1);
+
+        if (line[0] == '#')
+            continue;
+
+        struct addrinfo hints, * answer = NULL;
+        memset(&hints, 0, sizeof hints);
+        hints.ai_family = AF_INET;
+
+        int rc = 0;
+        if ((rc = getaddrinfo(line.c_str(), NULL, &hints, &answer)) != 0) {
+
+            std::cerr << "traceroute::load_batch_targets() : [ERROR] error while "\
+                "getting address of " << line << " (" << gai_strerror(rc) << ")" << std::endl;
+
+            continue;
+        }
+
+        struct batch_trace trace;
+        memset(&trace, 0, sizeof(trace));
+        strncpy(trace.hostname, line.c_str(), MAX_STRING_SIZE - 1);
+        memcpy(&trace.dst_addr, answer->ai_addr, sizeof(struct sockaddr_in));
+        freeaddrinfo(answer);
+
+        traces.push_back(trace);
+        added++;
+    }
+
+    return added;
+}
+
+// prints the hops found for a destination of a multi-destination trace, 
+// in ttl order. only the hops which were probed are listed.
+void print_batch_trace(struct batch_trace & trace) {
+
+    std::cout << "traceroute to " << trace.hostname 
+        << " (" << inet_ntoa(trace.dst_addr.sin_addr) << ") :";
+
+    if (trace.fwd_stopped)
+        std::cout << " forward probing stopped at ttl " << trace.end_ttl << " (stop set)" 
+            << (trace.bwd_stop_ttl > 0 ? "," : "");
+    if (trace.bwd_stop_ttl > 0)
+        std::cout << " backward probing stopped at ttl " << trace.bwd_stop_ttl << " (stop set)";
+
+    std::cout << std::endl;
+
+    for (int ttl = 1; ttl <= trace.end_ttl; ttl++) {
+
+        struct batch_trace::batch_hop & hop = trace.hops[ttl];
+
+        if (!hop.probed)
+            continue;
+
+        std::cout << std::setw(log(MAX_TTL)) << ttl;
+
+        if (!hop.replied) {
+            std::cout << " ?" << std::endl;
+            continue;
+        }
+
+        std::cout << " " << inet_ntoa(hop.addr) << " " << hop.rtt << " msec";
+
+        if (hop.icmp_rc >= 0)
+            std::cout << " unknown icmp code (" << hop.icmp_rc << ")";
+
+        std::cout << std::endl;
+    }
+}
+
+// multi-destination mode, w/ doubletree's stop sets (see stop-set.h) : the 
+// destinations in traces are traced BATCH_WINDOW at a time, each w/ a 
+// single probe in flight. a trace starts at a mid-path ttl (start_ttl) and 
+// probes forwards, until the destination answers (or an unreachable, or 
+// GAP_LIMIT silent hops in a row), or until it gets to an (interface, 
+// prefix) pair some other trace has seen already. it then probes backwards 
+// from start_ttl - 1, until ttl 1 or an interface seen already. the probes 
+// sent are compared to those of hop-by-hop traces from ttl 1 to the end of 
+// each path (as far as it's known). replies are matched to their trace 
+// through a ProbeTable, and probes time out after timeout_ms msecs (in a 
+// timing wheel). late replies are dropped.
+int trace_batch(
+    int snd_sckt_fd,
+    int rcv_sckt_fd,
+    uint16_t snd_src_port,
+    bool use_icmp_probe,
+    bool paris,
+    ICMPProbePool * probes,
+    std::vector<struct batch_trace> & traces,
+    int start_ttl,
+    int timeout_ms) {
+
+    ProbeTable inflight(BATCH_WINDOW);
+    TimingWheel timeouts(BATCH_WINDOW, (uint64_t) TIMEOUT_TICK * 1000000ULL);
+    StopSet stop_set(STOP_SET_PREFIX_LEN);
+
+    // the traces whose probe timed out, as collected by advance()
+    std::vector<uint32_t> expired;
+    auto on_timeout = [] (uint64_t data, void * arg) {
+        ((std::vector<uint32_t> *) arg)->push_back((uint32_t) data);
+    };
+
+    uint32_t next_trace = 0, nr_active = 0, nr_done = 0;
+    int seq = 0;
+    uint64_t nr_fwd = 0, nr_bwd = 0, nr_naive = 0;
+    uint32_t nr_fwd_stops = 0, nr_bwd_stops = 0;
+
+    // sends the next probe of trace i
+    auto send_next = [&] (uint32_t i) {
+
+        struct batch_trace & trace = traces[i];
+
+        // seq only has to tell apart the probes in flight. it wraps around 
+        // before DST_PORT + seq overflows the udp dst port.
+        seq = (seq % BATCH_MAX_SEQ) + 1;
+
+        struct timeval snd_timestamp;
+        if (send_probe(
+                snd_sckt_fd, trace.ttl, seq, use_icmp_probe, paris, 0, trace.src_addr, 
+                snd_src_port, probes, &trace.dst, &inflight, i, snd_timestamp) < 0)
+            return -1;
+
+        trace.key = get_probe_key(use_icmp_probe, paris, 0, snd_src_port, seq);
+        trace.timer = timeouts.insert((uint64_t) timeout_ms * 1000000ULL, i);
+
+        if (trace.backward)
+            nr_bwd++;
+        else
+            nr_fwd++;
+
+        return 0;
+    };
+
+    // moves trace i on, after a reply to its probe (icmp_rsp != NULL) or a 
+    // timeout. returns true if there's more probing to do.
+    auto step = [&] (uint32_t i, struct icmp_response * icmp_rsp, double rtt, int icmp_rc) {
+
+        struct batch_trace & trace = traces[i];
+        struct batch_trace::batch_hop & hop = trace.hops[trace.ttl];
+
+        hop.probed = true;
+
+        if (icmp_rsp == NULL) {
+
+            if (--trace.retries_left > 0)
+                return true;
+
+        } else {
+
+            hop.replied = true;
+            hop.addr = ((struct sockaddr_in *) &icmp_rsp->reply_addr)->sin_addr;
+            hop.rtt = rtt;
+            hop.icmp_rc = icmp_rc;
+        }
+
+        trace.retries_left = NUM_RETRIES;
+
+        // only routers on the way (i.e. ttl exceeded replies) go in the stop 
+        // set. the destination answers at every ttl past its own.
+        bool is_router = (hop.replied && icmp_rc == TTL_EXCEEDED_REPLY);
+
+        if (trace.backward) {
+
+            if (is_router && stop_set.has_interface(hop.addr)) {
+
+                trace.bwd_stop_ttl = trace.ttl;
+                nr_bwd_stops++;
+                return false;
+            }
+
+            if (is_router)
+                stop_set.add_interface(hop.addr);
+            else if (hop.replied)
+                trace.end_ttl = trace.ttl;
+
+            return (--trace.ttl > 0);
+        }
+
+        trace.silent = (hop.replied ? 0 : trace.silent + 1);
+
+        if (hop.replied && !is_router) {
+
+            trace.reached = true;
+
+        } else if (is_router && stop_set.lookup(hop.addr, trace.dst_addr.sin_addr, trace.remaining)) {
+
+            trace.fwd_stopped = true;
+            nr_fwd_stops++;
+
+        } else if (is_router) {
+
+            // the hops past it aren't known yet : see below
+            stop_set.add_interface(hop.addr);
+            stop_set.add(hop.addr, trace.dst_addr.sin_addr, 0);
+        }
+
+        if (!trace.reached && !trace.fwd_stopped 
+            && trace.silent < GAP_LIMIT && trace.ttl < MAX_TTL) {
+
+            trace.ttl++;
+            return true;
+        }
+
+        // done probing forwards : the pairs found along the way are updated 
+        // w/ the hops known past them
+        trace.end_ttl = trace.ttl;
+
+        for (int ttl = start_ttl; ttl <= trace.end_ttl; ttl++) {
+
+            struct batch_trace::batch_hop & fwd_hop = trace.hops[ttl];
+
+            if (fwd_hop.replied && fwd_hop.icmp_rc == TTL_EXCEEDED_REPLY) {
+                stop_set.add(
+                    fwd_hop.addr, trace.dst_addr.sin_addr, 
+                    trace.end_ttl - ttl + trace.remaining);
+            }
+        }
+
+        if (start_ttl <= 1)
+            return false;
+
+        trace.backward = true;
+        trace.ttl = start_ttl - 1;
+
+        return true;
+    };
+
+    auto finish = [&] (uint32_t i) {
+
+        struct batch_trace & trace = traces[i];
+
+        // a hop-by-hop trace would have sent (at least) a probe per hop, 
+        // up to the end of the path
+        nr_naive += trace.end_ttl + (trace.fwd_stopped ? trace.remaining : 0);
+
+        print_batch_trace(trace);
+
+        nr_active--;
+        nr_done++;
+    };
+
+    char rcv_buff[MAX_STRING_SIZE] = "";
+    struct pollfd rcv_poll;
+    rcv_poll.fd = rcv_sckt_fd;
+    rcv_poll.events = POLLIN;
+
+    while (nr_done < traces.size()) {
+
+        // keep up to BATCH_WINDOW traces going
+        while (nr_active < BATCH_WINDOW && next_trace < traces.size()) {
+
+            struct batch_trace & trace = traces[next_trace];
+
+            trace.dst.ai_family = AF_INET;
+            trace.dst.ai_addr = (struct sockaddr *) &trace.dst_addr;
+            trace.dst.ai_addrlen = sizeof(struct sockaddr_in);
+            trace.ttl = start_ttl;
+            trace.retries_left = NUM_RETRIES;
+
+            if (paris && !use_icmp_probe && get_src_addr(&trace.dst_addr, trace.src_addr) < 0)
+                return -1;
+
+            if (send_next(next_trace) < 0)
+                return -1;
+
+            next_trace++;
+            nr_active++;
+        }
+
+        expired.clear();
+        timeouts.advance(on_timeout, &expired);
+
+        for (size_t k = 0; k < expired.size(); k++) {
+
+            uint32_t i = expired[k];
+            inflight.remove(traces[i].key);
+
+            if (!step(i, NULL, 0.0, TIMEOUT_REPLY))
+                finish(i);
+            else if (send_next(i) < 0)
+                return -1;
+        }
+
+        // wait for replies, but no longer than a tick, so that timeouts 
+        // are noticed
+        int rc = poll(&rcv_poll, 1, TIMEOUT_TICK);
+
+        if (rc < 0) {
+
+            if (errno == EINTR)
+                continue;
+
+            std::cerr << "traceroute::trace_batch() : [ERROR] error in poll(): " 
+                << strerror(errno) << std::endl;
+
+            return -1;
+        }
+
+        // read all replies queued up so far
+        while (rc > 0) {
+
+            struct icmp_response icmp_rsp;
+            icmp_rsp.reply_addrlen = sizeof(icmp_rsp.reply_addr);
+
+            int rcv_bytes = recvfrom(
+                rcv_sckt_fd, rcv_buff, sizeof(rcv_buff), MSG_DONTWAIT, 
+                &icmp_rsp.reply_addr, &icmp_rsp.reply_addrlen);
+
+            if (rcv_bytes < 0)
+                break;
+
+            uint64_t rsp_key = 0;
+            struct inflight_probe * match = NULL;
+            int icmp_rc = parse_icmp_response(rcv_buff, rcv_bytes, paris, rsp_key, icmp_rsp);
+
+            // probes are removed from inflight as they time out, so late 
+            // replies don't match either
+            if (icmp_rc == UNMATCHED_REPLY || (match = inflight.lookup(rsp_key)) == NULL)
+                continue;
+
+            gettimeofday(&icmp_rsp.rcv_timestamp, NULL);
+
+            uint32_t i = match->index;
+            double rtt = to_msec(*(tv_sub(&icmp_rsp.rcv_timestamp, &match->snd_timestamp)));
+
+            timeouts.cancel(traces[i].timer);
+            inflight.remove(rsp_key);
+
+            if (!step(i, &icmp_rsp, rtt, icmp_rc))
+                finish(i);
+            else if (send_next(i) < 0)
+                return -1;
+        }
+    }
+
+    uint64_t nr_sent = nr_fwd + nr_bwd;
+
+    std::cout << "traceroute::trace_batch() : [INFO] " << traces.size() << " targets : " 
+        << nr_sent << " probes sent (" << nr_fwd << " forward, " << nr_bwd << " backward), "\
+        "vs. at least " << nr_naive << " for hop-by-hop traces from ttl 1 (" 
+        << ((int64_t) nr_naive - (int64_t) nr_sent) << " saved, " 
+        << (nr_naive > 0 ? 100.0 * ((double) nr_naive - (double) nr_sent) / nr_naive : 0.0) 
+        << "%)" << std::endl;
+
+    std::cout << "traceroute::trace_batch() : [INFO] stop set : " 
+        << stop_set.get_nr_pairs() << " (interface, /" << stop_set.get_prefix_len() 
+        << " prefix) pairs, " << stop_set.get_nr_interfaces() << " interfaces. "\
+        "forward probing stopped early in " << nr_fwd_stops << " traces, "\
+        "backward probing in " << nr_bwd_stops << std::endl;
+
+    return 0;
+}
+
+// stateless mode (see stateless-trace.h) : probes every (destination, ttl) 
+// pair of range once, in a random order, at up to rate pps (0 for no 
+// limit), then waits timeout_ms msecs for the last replies. hops go to out 
+// as their replies come in. snd_sckt_fd must be a raw (IPPROTO_RAW) socket.
+int trace_stateless(
+    int snd_sckt_fd,
+    int rcv_sckt_fd,
+    const char * range,
+    uint64_t rate,
+    int timeout_ms,
+    std::ostream & out) {
+
+    StatelessTrace trace(MAX_TTL, DST_PORT);
+
+    if (trace.set_range(range) < 0 || trace.start() < 0)
+        return -1;
+
+    std::cout << "traceroute::trace_stateless() : [INFO] tracing " << range << " (" 
+        << trace.get_space_size() << " (destination, ttl) pairs) at ";
+
+    if (rate > 0)
+        std::cout << rate << " pps" << std::endl;
+    else
+        std::cout << "full speed" << std::endl;
+
+    out << "# destination ttl hop rtt_msec icmp_type icmp_code" << std::endl;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    char rcv_buff[MAX_STRING_SIZE] = "";
+    struct pollfd rcv_poll;
+    rcv_poll.fd = rcv_sckt_fd;
+    rcv_poll.events = POLLIN;
+
+    // once every pair has been probed, we wait for the last replies until 
+    // drain_deadline
+    bool draining = false;
+    struct timespec drain_deadline;
+
+    for ( ; ; ) {
+
+        // w/ a rate limit, as many probes as it allows up to now (but no 
+        // more than STATELESS_BURST at once, so that replies don't wait too 
+        // long). w/o one, STATELESS_BURST per round.
+        uint64_t allowed = STATELESS_BURST;
+
+        if (rate > 0) {
+
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+
+            uint64_t elapsed_us = (uint64_t) (now.tv_sec - start.tv_sec) * 1000000ULL 
+                + (now.tv_nsec - start.tv_nsec) / 1000;
+            uint64_t due = (elapsed_us * rate) / 1000000ULL + 1;
+
+            allowed = (due > trace.get_nr_sent() ? due - trace.get_nr_sent() : 0);
+
+            if (allowed > STATELESS_BURST)
+                allowed = STATELESS_BURST;
+        }
+
+        for (uint64_t i = 0; i < allowed && !trace.is_done(); i++) {
+
+            int rc = trace.send(snd_sckt_fd);
+
+            if (rc < 0)
+                return -1;
+
+            // send buffer full : carry on w/ the replies
+            if (rc == 0)
+                break;
+        }
+
+        if (trace.is_done() && !draining) {
+
+            draining = true;
+            set_deadline(drain_deadline, timeout_ms);
+        }
+
+        if (draining && get_remaining_ms(drain_deadline) == 0)
+            break;
+
+        // w/o a rate limit, don't wait for replies while there's probing 
+        // left to do
+        int rc = poll(&rcv_poll, 1, (rate == 0 && !draining) ? 0 : TIMEOUT_TICK);
+
+        if (rc < 0) {
+
+            if (errno == EINTR)
+                continue;
+
+            std::cerr << "traceroute::trace_stateless() : [ERROR] error in poll(): " 
+                << strerror(errno) << std::endl;
+
+            return -1;
+        }
+
+        // read all replies queued up so far
+        while (rc > 0) {
+
+            struct sockaddr_in src;
+            socklen_t src_len = sizeof(src);
+
+            int rcv_bytes = recvfrom(
+                rcv_sckt_fd, rcv_buff, sizeof(rcv_buff), MSG_DONTWAIT, 
+                (struct sockaddr *) &src, &src_len);
+
+            if (rcv_bytes < 0)
+                break;
+
+            trace.process_reply(rcv_buff, rcv_bytes, &src, out);
+        }
+    }
+
+    out.flush();
+
+    std::cout << "traceroute::trace_stateless() : [INFO] " << trace.get_nr_sent() 
+        << " probes sent, " << trace.get_nr_hops() << " hops recorded (" 
+        << trace.get_nr_reached() << " from the destination), " 
+        << trace.get_nr_invalid() << " replies w/ invalid cookies" << std::endl;
+
+    return 0;
+}
+
+// mda mode (see multipath-trace.h) : finds the interfaces at each hop to 
+// hostname (in answer), and which lead to which, w/ paris probes (see 
+// send_probe()) of many flows : a flow is a udp dst port (DST_PORT + flow), 
+// or an icmp checksum. the probe of flow f at ttl t has seq f * MAX_TTL + t. 
+// up to MDA_WINDOW probes are in flight, for all hops at once, each w/ a 
+// timeout of timeout_ms msecs (in a timing wheel). late replies are dropped. 
+// the hops are printed once the trace is over, and written to dot (as a 
+// graph), if not NULL.
+int trace_mda(
+    int snd_sckt_fd,
+    int rcv_sckt_fd,
+    uint16_t snd_src_port,
+    bool use_icmp_probe,
+    struct in_addr src_addr,
+    ICMPProbePool * probes,
+    struct addrinfo * answer,
+    double confidence,
+    int timeout_ms,
+    std::ostream * dot) {
+
+    MultipathTrace trace(MAX_TTL, GAP_LIMIT, confidence);
+    ProbeTable inflight(MDA_WINDOW);
+    TimingWheel timeouts(MDA_WINDOW, (uint64_t) TIMEOUT_TICK * 1000000ULL);
+
+    std::cout << "traceroute::trace_mda() : [INFO] " << confidence << "% confidence : "\
+        "n(k) = " << trace.get_stopping_point(1) << ", " << trace.get_stopping_point(2) 
+        << ", " << trace.get_stopping_point(3) << ", " << trace.get_stopping_point(4) 
+        << ", ... probes rule out a (k + 1)th next hop" << std::endl;
+
+    // the timers of the probes in flight, by seq
+    std::vector<uint64_t> timers(MDA_MAX_FLOWS * MAX_TTL + MAX_TTL + 1, 0);
+
+    // the seq numbers of the probes which timed out, as collected by 
+    // advance()
+    std::vector<uint32_t> expired;
+    auto on_timeout = [] (uint64_t data, void * arg) {
+        ((std::vector<uint32_t> *) arg)->push_back((uint32_t) data);
+    };
+
+    std::vector<struct mda_probe> to_send;
+    char rcv_buff[MAX_STRING_SIZE] = "";
+    struct pollfd rcv_poll;
+    rcv_poll.fd = rcv_sckt_fd;
+    rcv_poll.events = POLLIN;
+
+    for ( ; ; ) {
+
+        expired.clear();
+        timeouts.advance(on_timeout, &expired);
+
+        for (size_t k = 0; k < expired.size(); k++) {
+
+            int seq = expired[k];
+            uint16_t flow = (uint16_t) ((seq - 1) / MAX_TTL);
+
+            inflight.remove(get_probe_key(use_icmp_probe, true, flow, snd_src_port, seq));
+            trace.on_timeout(flow, ((seq - 1) % MAX_TTL) + 1);
+        }
+
+        to_send.clear();
+        trace.schedule(to_send, MDA_WINDOW - (int) trace.get_nr_in_flight());
+
+        for (size_t k = 0; k < to_send.size(); k++) {
+
+            int seq = to_send[k].flow * MAX_TTL + to_send[k].ttl;
+
+            struct timeval snd_timestamp;
+            if (send_probe(
+                    snd_sckt_fd, to_send[k].ttl, seq, use_icmp_probe, true, to_send[k].flow, 
+                    src_addr, snd_src_port, probes, answer, &inflight, seq, snd_timestamp) < 0)
+                return -1;
+
+            timers[seq] = timeouts.insert((uint64_t) timeout_ms * 1000000ULL, seq);
+        }
+
+        // nothing in flight, nor left to send
+        if (trace.get_nr_in_flight() == 0)
+            break;
+
+        // wait for replies, but no longer than a tick, so that timeouts 
+        // are noticed
+        int rc = poll(&rcv_poll, 1, TIMEOUT_TICK);
+
+        if (rc < 0) {
+
+            if (errno == EINTR)
+                continue;
+
+            std::cerr << "traceroute::trace_mda() : [ERROR] error in poll(): " 
+                << strerror(errno) << std::endl;
+
+            return -1;
+        }
 
-#define TIMEOUT_REPLY       -3
-#define TTL_EXCEEDED_REPLY  -2
-#define HOSTNAME_HIT_REPLY  -1
+        // read all replies queued up so far
+        while (rc > 0) {
 
-#define NUM_RETRIES     1       // send up to NUM_RETRIES udp packets per ttl
-#define REPLY_TIMEOUT   1       // wait REPLY_TIMEOUT secs for an icmp reply
-#define DST_PORT        32768 + 666 // this is how Stevens sets the upd dst 
-                                    // port. i'll follow the same (note that 
-                                    // the sockaddr_in->sin_port attr. is a 
-                                    // 16 bit unsigned value, which can go up 
-                                    // till 65536)
+            struct icmp_response icmp_rsp;
+            icmp_rsp.reply_addrlen = sizeof(icmp_rsp.reply_addr);
 
-#define MAX_TTL         30          // following Stevens' lead again
+            int rcv_bytes = recvfrom(
+                rcv_sckt_fd, rcv_buff, sizeof(rcv_buff), MSG_DONTWAIT, 
+                &icmp_rsp.reply_addr, &icmp_rsp.reply_addrlen);
 
-#define SERVICE_HTTP    "http"
-// as defined in Steven's unp book, fig. 28.4
-#define MAX_BUFFER_SIZE 1500
-#define MAX_STRING_SIZE 256
+            if (rcv_bytes < 0)
+                break;
 
-#define OPTION_HOSTNAME     (char *) "hostname"
-#define OPTION_USE_PING     (char *) "use-ping"
+            uint64_t rsp_key = 0;
+            struct inflight_probe * match = NULL;
+            int icmp_rc = parse_icmp_response(rcv_buff, rcv_bytes, true, rsp_key, icmp_rsp);
 
-using namespace CommandLineProcessing;
+            if (icmp_rc == UNMATCHED_REPLY || (match = inflight.lookup(rsp_key)) == NULL)
+                continue;
 
-struct trace_record {
-    uint16_t seq;
-    uint16_t ttl;
-    struct timeval timestamp;
-};
+            gettimeofday(&icmp_rsp.rcv_timestamp, NULL);
 
-struct icmp_response {
-    // address of replier
-    sockaddr reply_addr;
-    socklen_t reply_addrlen;
-    // src address as seen by replier
-    struct in_addr req_src_addr;
-    // the trace record of the respective request
-    struct trace_record rsp_rcrd;
-    // response timestamp
-    struct timeval rcv_timestamp;
-};
+            int seq = match->index;
+            int ttl = match->ttl;
+            double rtt = to_msec(*(tv_sub(&icmp_rsp.rcv_timestamp, &match->snd_timestamp)));
 
-ArgvParser * create_argv_parser() {
+            timeouts.cancel(timers[seq]);
+            inflight.remove(rsp_key);
 
-    ArgvParser * parser = new ArgvParser();
+            // hostname (or an unreachable) ends the flow's path
+            trace.on_reply(
+                (uint16_t) ((seq - 1) / MAX_TTL), ttl, 
+                ((struct sockaddr_in *) &icmp_rsp.reply_addr)->sin_addr, 
+                (icmp_rc == HOSTNAME_HIT_REPLY || icmp_rc >= 0), rtt);
+        }
+    }
 
-    parser->setIntroductoryDescription("\n\nmy traceroute\n\n\nby adamiaonr@gmail.com");
-    parser->setHelpOption("h", "help", "help page");
+    trace.print(std::cout);
 
-    parser->defineOption(
-            OPTION_HOSTNAME,
-            "hostname to trace route to",
-            ArgvParser::OptionRequiresValue | ArgvParser::OptionRequired);
+    if (dot != NULL) {
+        trace.print_dot(*dot);
+        dot->flush();
+    }
 
-    parser->defineOption(
-            OPTION_USE_PING,
-            "use ICMP ECHO packets (instead of UDP packets) as probes",
-            ArgvParser::NoOptionAttribute);
+    std::cout << "traceroute::trace_mda() : [INFO] " << trace.get_nr_sent() 
+        << " probes sent, over " << trace.get_nr_flows() << " flows" << std::endl;
 
-    return parser;
+    return 0;
 }
 
-struct timeval * tv_sub(struct timeval * out, struct timeval * in) {
+// a hop of a continuous trace (see trace_continuous())
+struct continuous_hop {
+    HopStats stats;
+    // the last interface to reply
+    struct in_addr addr;
+    bool replied;
+};
 
-    if ((out->tv_usec -= in->tv_usec) < 0) {   /* out -= in */
+// prints a continuous mode report (see trace_continuous()) : a line per 
+// hop up to last_ttl, w/ the last interface to reply and its stats
+void print_continuous_report(
+    std::vector<struct continuous_hop> & hops,
+    int last_ttl,
+    struct in_addr dst_addr,
+    uint64_t nr_rounds,
+    bool in_place) {
 
-        --out->tv_sec;
-        out->tv_usec += 1000000;
+    // clear the screen, and go back to its top
+    if (in_place)
+        std::cout << "\033[H\033[2J";
+
+    std::cout << "traceroute::trace_continuous() : [INFO] " << inet_ntoa(dst_addr)
+        << " : " << nr_rounds << " rounds (loss and rtts over the last " 
+        << HOP_STATS_WINDOW << " probes per hop, in msec)" << std::endl;
+
+    std::ios::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+
+    std::cout << std::left << std::setw(4) << "hop" << std::setw(16) << "address" << std::right 
+        << std::setw(7) << "loss%" << std::setw(8) << "snt" << std::setw(9) << "last" 
+        << std::setw(9) << "avg" << std::setw(9) << "best" << std::setw(9) << "worst" 
+        << std::setw(9) << "stdev" << std::setw(9) << "p50" << std::setw(9) << "p95" << std::endl;
+
+    std::cout << std::fixed;
+
+    for (int ttl = 1; ttl <= last_ttl; ttl++) {
+
+        struct continuous_hop & hop = hops[ttl];
+        HopStats & stats = hop.stats;
+
+        std::cout << std::left << std::setw(4) << ttl 
+            << std::setw(16) << (hop.replied ? inet_ntoa(hop.addr) : "?") << std::right 
+            << std::setw(7) << std::setprecision(1) << stats.get_loss()
+            << std::setw(8) << stats.get_sent() << std::setprecision(2);
+
+        if (stats.get_received() == 0) {
+            std::cout << std::endl;
+            continue;
+        }
+
+        std::cout << std::setw(9) << stats.get_last() << std::setw(9) << stats.get_mean()
+            << std::setw(9) << stats.get_min() << std::setw(9) << stats.get_max()
+            << std::setw(9) << stats.get_stdev() << std::setw(9) << stats.get_percentile(0.5)
+            << std::setw(9) << stats.get_percentile(0.95) << std::endl;
     }
-    
-    out->tv_sec -= in->tv_sec;
 
-    return out;
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+    std::cout.flush();
 }
 
-int get_icmp_response(
+// continuous mode, a la mtr : every hop up to hostname (in answer) gets rate 
+// probes per second, until count rounds are sent (0 for no limit), or 
+// SIGINT / SIGTERM. a round is a probe per ttl, all sent back to back, so 
+// that the probes to all hops are in flight at once. replies are matched to 
+// their probes through a ProbeTable, and probes time out after timeout_ms 
+// msecs (in a timing wheel), as losses. each hop keeps rolling stats (see 
+// hop-stats.h), printed every CONTINUOUS_REPORT_INTERVAL msecs : in place 
+// if stdout is a terminal, one report after the other if not. the hops, 
+// the ProbeTable and the timing wheel are all sized up front : memory 
+// doesn't grow, however long it runs.
+int trace_continuous(
+    int snd_sckt_fd,
     int rcv_sckt_fd,
-    int snd_ttl,
-    int snd_seq,
-    int snd_src_port,
+    uint16_t snd_src_port,
     bool use_icmp_probe,
-    SignalHandler signal_handler,
-    struct icmp_response & icmp_rsp) {
+    bool paris,
+    struct in_addr src_addr,
+    ICMPProbePool * probes,
+    struct addrinfo * answer,
+    uint64_t rate,
+    uint64_t count,
+    int timeout_ms) {
+
+    // probes in flight at once : a round every 1 / rate sec, for timeout_ms 
+    // msecs (plus a round of slack)
+    uint64_t max_in_flight = MAX_TTL * (((rate * timeout_ms) / 1000) + 2);
+
+    // seq numbers (see below) must tell apart all the probes in flight
+    if (max_in_flight > BATCH_MAX_SEQ / 2) {
+
+        std::cerr << "traceroute::trace_continuous() : [ERROR] rate too high (" 
+            << rate << " pps per hop) for a timeout of " << timeout_ms << " msec" << std::endl;
+
+        return -1;
+    }
+
+    std::vector<struct continuous_hop> hops(MAX_TTL + 1);
+    for (int ttl = 1; ttl <= MAX_TTL; ttl++)
+        hops[ttl].replied = false;
+
+    ProbeTable inflight((uint32_t) max_in_flight);
+    TimingWheel timeouts((uint32_t) max_in_flight, (uint64_t) TIMEOUT_TICK * 1000000ULL);
+
+    // seq numbers go from 1 to BATCH_MAX_SEQ, and wrap around. the timers 
+    // of the probes in flight are kept by seq.
+    std::vector<uint64_t> timers(BATCH_MAX_SEQ + 1, TIMER_NONE);
+    int seq = 0;
+
+    // the probes which timed out, as collected by advance() : 
+    // (ttl << 16) | seq
+    std::vector<uint64_t> expired;
+    auto on_timeout = [] (uint64_t data, void * arg) {
+        ((std::vector<uint64_t> *) arg)->push_back(data);
+    };
+
+    // the ttl at which hostname answered : later hops aren't probed
+    int last_ttl = MAX_TTL;
+    struct in_addr dst_addr = ((struct sockaddr_in *) answer->ai_addr)->sin_addr;
+
+    // SIGINT (CTRL+C) and SIGTERM arrive on a signalfd, polled along w/ the 
+    // socket, so that we stop (and print a last report) right away, rather 
+    // than after poll() times out. signals are only queued for the signalfd 
+    // if they're blocked.
+    sigset_t signal_mask, old_signal_mask;
+    sigemptyset(&signal_mask);
+    sigaddset(&signal_mask, SIGINT);
+    sigaddset(&signal_mask, SIGTERM);
+
+    if (sigprocmask(SIG_BLOCK, &signal_mask, &old_signal_mask) < 0) {
+
+        std::cerr << "traceroute::trace_continuous() : [ERROR] error blocking "\
+            "signals: " << strerror(errno) << std::endl;
+
+        return -1;
+    }
+
+    int signal_fd = signalfd(-1, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (signal_fd < 0) {
+
+        std::cerr << "traceroute::trace_continuous() : [ERROR] error in signalfd(): " 
+            << strerror(errno) << std::endl;
+
+        sigprocmask(SIG_SETMASK, &old_signal_mask, NULL);
+        return -1;
+    }
+
+    bool in_place = isatty(STDOUT_FILENO);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct timespec report_deadline;
+    set_deadline(report_deadline, CONTINUOUS_REPORT_INTERVAL);
+
+    // the next round due, and the nr. of rounds sent
+    uint64_t next_round = 0, nr_rounds = 0;
 
-    int rcv_bytes = 0, return_code = 0;
     char rcv_buff[MAX_STRING_SIZE] = "";
-    struct ip * ipv4_hdr = NULL;
-    struct icmp * icmp_hdr = NULL, * inner_icmp_hdr = NULL;
-    struct udphdr * udp_hdr = NULL;
+    struct pollfd rcv_poll[2];
+    rcv_poll[0].fd = rcv_sckt_fd;
+    rcv_poll[0].events = POLLIN;
+    rcv_poll[1].fd = signal_fd;
+    rcv_poll[1].events = POLLIN;
 
-    // raise SIGALRM in 3 seconds and disarm the signal
-    signal_handler.disarm_signal();
-    alarm(REPLY_TIMEOUT);
+    int rc = 0;
 
-    for ( ; ; ) {
+    while (rc >= 0) {
 
-        if (signal_handler.is_signal())
-            return TIMEOUT_REPLY;
+        if (count == 0 || nr_rounds < count) {
 
-        // get response bytes and fill the address of replier in icmp_rsp
-        if ((rcv_bytes = recvfrom(
-                            rcv_sckt_fd, rcv_buff, sizeof(rcv_buff), 0, 
-                            &icmp_rsp.reply_addr, &icmp_rsp.reply_addrlen)) < 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
 
-            // since we're using a SIGALRM handler, recvfrom() may have been 
-            // interrupted due to it. we therefore 're-cycle' to check if this is 
-            // what really happened.
-            if (errno == EINTR) {
-                continue;
-            } else {
-                std::cerr << "traceroute::get_icmp_response() : [ERROR] error in recvfrom(): " 
-                    << strerror(errno) << std::endl;
-            }
-        }
+            uint64_t elapsed_us = (uint64_t) (now.tv_sec - start.tv_sec) * 1000000ULL 
+                + (now.tv_nsec - start.tv_nsec) / 1000;
+            uint64_t due = (elapsed_us * rate) / 1000000ULL + 1;
 
-        // read ipv4 header encapsulating the icmp reply
-        ipv4_hdr = (struct ip *) rcv_buff;
-        // 1) ipv4 header len : in ipv4, the header length isn't fixed (in 
-        //    ipv6, it is fixed as 40 byte). this is the total length of the header, 
-        //    including options. therefore we must retrieve it to know 'where' the 
-        //    icmp header starts. 
-        // 2) note the '<< 2': the length field is 4 bit long, represented in 
-        //    '4 byte blocks' units. thus, to get the length in byte units, we 
-        //     multiply it by 4, i.e. the same as left-shifting by 2 bit ('<< 2').
-        int ipv4_hdr_len = ipv4_hdr->ip_hl << 2;
-        // if the protocol field isn't ICMP, abort.
-        if (ipv4_hdr->ip_p != IPPROTO_ICMP) {
-            std::cerr << "traceroute::get_icmp_response() : [ERROR] not an ICMP "\
-                "packet. skip processing." << std::endl;
-            continue;
-        }
+            // after a stall (e.g. a suspended process), the rounds missed 
+            // are skipped, rather than sent in a burst
+            if (due > next_round + 1)
+                next_round = due - 1;
 
-        // with the ipv4 header length, get the start of the icmp header
-        icmp_hdr = (struct icmp *) (rcv_buff + ipv4_hdr_len);
-        // the icmp_len should be at least 8 byte (size of icmp header). if not, abort.
-        int icmp_len = 0;
-        if ((icmp_len = rcv_bytes - ipv4_hdr_len) < 8) {
-            std::cerr << "traceroute::get_icmp_response() : [ERROR] malformed ICMP "\
-                "packet. header too short (" << icmp_len << " byte). skip "\
-                "processing." << std::endl;  
-            continue;              
-        }
-
-        // check if type = ICMP_TIMXCEED AND code = ICMP_TIMXCEED_INTRANS
-        if (icmp_hdr->icmp_type == ICMP_TIMXCEED && icmp_hdr->icmp_code == ICMP_TIMXCEED_INTRANS) {
-
-            // 'icmp error messages contain a data section that includes a copy 
-            // of the entire ipv4 header, plus the first eight bytes of data 
-            // from the ipv4 packet that caused the error message' [wikipedia]
-
-            // we extract diff. info from the inner ipv4 packet, depending on 
-            // the probing method (probes can be icmp echo packets or udp packets)
-            //  - if udp, compare the src and dst ports of response 
-            //    w/ dst and src ports of request
-            //  - if icmp echo, compare the trace_record from inner icmp echo 
-            //    copy w/ the saved values from the respective request
-
-            if (use_icmp_probe) {
-
-                // get ip header of inner copy, and fetch the src address as 
-                // seen by the replier
-                struct ip * inner_ipv4_hdr = NULL;
-                if (ICMPUtils::get_inner_ip_hdr(rcv_buff + ipv4_hdr_len, icmp_len, inner_ipv4_hdr) < 0)
-                    continue;
-                icmp_rsp.req_src_addr = ipv4_hdr->ip_src;
-
-                // get icmp packet encapsulated within the inner ipv4 packet 
-                if (ICMPUtils::get_inner_icmp_hdr(rcv_buff + ipv4_hdr_len, icmp_len, inner_icmp_hdr) < 0)
-                    continue;
-
-                // since we don't have access to port numbers w/ icmp packets, 
-                // we validate the reply based on the payload fields
-                struct trace_record * rsp_rcrd = (struct trace_record *) inner_icmp_hdr->icmp_data;
-                if ((rsp_rcrd->seq == snd_seq) && (rsp_rcrd->ttl == snd_ttl)) {
-                    // copy the response record struct into the icmp response
-                    icmp_rsp.rsp_rcrd = *rsp_rcrd;
-                    // set the return code to a TTL_EXCEEDED_REPLY
-                    return_code = TTL_EXCEEDED_REPLY;
-                    break;
-                }
+            if (due > next_round) {
 
-            } else {
+                for (int ttl = 1; ttl <= last_ttl; ttl++) {
 
-                if (ICMPUtils::get_inner_udp_hdr(rcv_buff + ipv4_hdr_len, icmp_len, udp_hdr) < 0)
-                    continue;
+                    seq = (seq % BATCH_MAX_SEQ) + 1;
 
-                // std::cout << "got udp packet w/ src port " 
-                //  << ntohs(udp_hdr->uh_sport) << " vs. " << snd_src_port
-                //  << " dst port " << ntohs(udp_hdr->uh_dport) << " vs. " 
-                //      << DST_PORT + snd_seq << std::endl;
+                    struct timeval snd_timestamp;
+                    if (send_probe(
+                            snd_sckt_fd, ttl, seq, use_icmp_probe, paris, 0, src_addr, 
+                            snd_src_port, probes, answer, &inflight, seq, snd_timestamp) < 0) {
+                        rc = -1;
+                        break;
+                    }
 
-                // if the protocol, src and dst port checks pass, we're in the 
-                // presence of a TTL_EXCEEDED reply
-                if (udp_hdr->uh_sport == htons(snd_src_port) &&
-                    udp_hdr->uh_dport == htons(DST_PORT + snd_seq)) {
-                    return_code = TTL_EXCEEDED_REPLY;
-                    break;
+                    timers[seq] = timeouts.insert(
+                        (uint64_t) timeout_ms * 1000000ULL, ((uint64_t) ttl << 16) | seq);
                 }
+
+                if (rc < 0)
+                    break;
+
+                next_round++;
+                nr_rounds++;
             }
 
-        } else if (icmp_hdr->icmp_type == ICMP_UNREACH || icmp_hdr->icmp_type == ICMP_ECHOREPLY) {
+        } else if (inflight.size() == 0) {
 
-            if (use_icmp_probe) {
- 
-                struct trace_record * rsp_rcrd = (struct trace_record *) icmp_hdr->icmp_data;          
-                if ((rsp_rcrd->seq == snd_seq) && (rsp_rcrd->ttl == snd_ttl)) {
-                    // copy the response record struct into the icmp response
-                    icmp_rsp.rsp_rcrd = *rsp_rcrd;
-                    return_code = HOSTNAME_HIT_REPLY;
-                    break;
-                }
+            // all rounds sent, and all their probes answered (or timed out)
+            break;
+        }
 
-            } else {
+        expired.clear();
+        timeouts.advance(on_timeout, &expired);
 
-                if (ICMPUtils::get_inner_udp_hdr(rcv_buff + ipv4_hdr_len, icmp_len, udp_hdr) < 0)
-                    continue;
+        for (size_t k = 0; k < expired.size(); k++) {
 
-                // if the protocol, src and dst port checks pass, we're in the 
-                // presence of a TTL_EXCEEDED reply
-                if (udp_hdr->uh_sport == htons(snd_src_port) && udp_hdr->uh_dport == htons(DST_PORT + snd_seq)) {
+            int ttl = (int) (expired[k] >> 16);
+            int expired_seq = (int) (expired[k] & 0xFFFF);
 
-                    if (icmp_hdr->icmp_code == ICMP_UNREACH_PORT)
-                        return_code = HOSTNAME_HIT_REPLY;
-                    else
-                        return_code = icmp_hdr->icmp_code;
+            inflight.remove(get_probe_key(use_icmp_probe, paris, 0, snd_src_port, expired_seq));
+            hops[ttl].stats.add_loss();
+        }
 
-                    break;
-                }
+        if (get_remaining_ms(report_deadline) == 0) {
+
+            print_continuous_report(hops, last_ttl, dst_addr, nr_rounds, in_place);
+            set_deadline(report_deadline, CONTINUOUS_REPORT_INTERVAL);
+        }
+
+        // wait for replies (or a signal), but no longer than a tick, so that 
+        // timeouts (and rounds) are noticed
+        rc = poll(rcv_poll, 2, TIMEOUT_TICK);
+
+        if (rc < 0) {
+
+            if (errno == EINTR) {
+                rc = 0;
+                continue;
             }
+
+            std::cerr << "traceroute::trace_continuous() : [ERROR] error in poll(): " 
+                << strerror(errno) << std::endl;
+
+            break;
         }
 
-        // if this is an icmp packet but not of the indented type, post the 
-        // contents anyway...
-        std::cerr << "traceroute::get_icmp_response() : [WARNING] not an expected "\
-            << "ICMP reply. processing anyway..." << std::endl;
+        struct signalfd_siginfo signal_info;
+        if (read(signal_fd, &signal_info, sizeof(signal_info)) == sizeof(signal_info))
+            break;
+
+        // read all replies queued up so far
+        while (rc > 0) {
+
+            struct icmp_response icmp_rsp;
+            icmp_rsp.reply_addrlen = sizeof(icmp_rsp.reply_addr);
+
+            int rcv_bytes = recvfrom(
+                rcv_sckt_fd, rcv_buff, sizeof(rcv_buff), MSG_DONTWAIT, 
+                &icmp_rsp.reply_addr, &icmp_rsp.reply_addrlen);
+
+            if (rcv_bytes < 0)
+                break;
+
+            uint64_t rsp_key = 0;
+            struct inflight_probe * match = NULL;
+            int icmp_rc = parse_icmp_response(rcv_buff, rcv_bytes, paris, rsp_key, icmp_rsp);
+
+            // probes are removed from inflight as they time out, so late 
+            // replies don't match either
+            if (icmp_rc == UNMATCHED_REPLY || (match = inflight.lookup(rsp_key)) == NULL)
+                continue;
+
+            gettimeofday(&icmp_rsp.rcv_timestamp, NULL);
+
+            int ttl = match->ttl;
+            struct timeval rtt = icmp_rsp.rcv_timestamp;
+            tv_sub(&rtt, &match->snd_timestamp);
 
-        std::cout << "got " << icmp_len << " bytes from " 
-            << inet_ntoa(ipv4_hdr->ip_src)
-            << " : type = " << (uint16_t) icmp_hdr->icmp_type 
-            << ", code = " << (uint16_t) icmp_hdr->icmp_code << std::endl;    
+            timeouts.cancel(timers[match->index]);
+            inflight.remove(rsp_key);
+
+            struct continuous_hop & hop = hops[ttl];
+            hop.stats.add((int64_t) rtt.tv_sec * 1000000000LL + (int64_t) rtt.tv_usec * 1000LL);
+            hop.addr = ((struct sockaddr_in *) &icmp_rsp.reply_addr)->sin_addr;
+            hop.replied = true;
+
+            // hostname (or an unreachable, which nothing past it will 
+            // answer) ends the path
+            if ((icmp_rc == HOSTNAME_HIT_REPLY || icmp_rc >= 0) && ttl < last_ttl)
+                last_ttl = ttl;
+        }
     }
 
-    // important: don't leave the alarm running
-    alarm(0);
-    // save time of reception in icmp_rsp
-    gettimeofday(&icmp_rsp.rcv_timestamp, NULL);
+    close(signal_fd);
+    sigprocmask(SIG_SETMASK, &old_signal_mask, NULL);
 
-    return return_code;
+    if (rc < 0)
+        return -1;
+
+    print_continuous_report(hops, last_ttl, dst_addr, nr_rounds, in_place);
+
+    return 0;
 }
 
 // here's how traceroute's works:  
@@ -291,7 +1993,19 @@ int get_icmp_response(
 int main (int argc, char ** argv) {
 
     char hostname[MAX_STRING_SIZE] = "";
+    char targets_file[MAX_STRING_SIZE] = "";
+    int start_ttl = DEFAULT_START_TTL;
+    char stateless_range[MAX_STRING_SIZE] = "";
+    char output_file[MAX_STRING_SIZE] = "";
+    uint64_t rate = DEFAULT_STATELESS_RATE;
     bool use_icmp_probe = false;
+    bool parallel = false;
+    bool paris = false;
+    bool mda = false;
+    double confidence = MDA_DEFAULT_CONFIDENCE;
+    bool continuous = false;
+    uint64_t count = 0;
+    int timeout_ms = REPLY_TIMEOUT;
 
     ArgvParser * arg_parser = create_argv_parser();
     int parse_result = arg_parser->parse(argc, argv);
@@ -316,29 +2030,112 @@ int main (int argc, char ** argv) {
 
         if (arg_parser->foundOption(OPTION_USE_PING))
             use_icmp_probe = true;
+
+        if (arg_parser->foundOption(OPTION_PARALLEL))
+            parallel = true;
+
+        if (arg_parser->foundOption(OPTION_PARIS))
+            paris = true;
+
+        if (arg_parser->foundOption(OPTION_MDA))
+            mda = true;
+
+        if (arg_parser->foundOption(OPTION_CONFIDENCE))
+            confidence = atof(arg_parser->optionValue(OPTION_CONFIDENCE).c_str());
+
+        if (arg_parser->foundOption(OPTION_CONTINUOUS))
+            continuous = true;
+
+        if (arg_parser->foundOption(OPTION_COUNT))
+            count = strtoull(arg_parser->optionValue(OPTION_COUNT).c_str(), NULL, 10);
+
+        if (arg_parser->foundOption(OPTION_TIMEOUT))
+            timeout_ms = atoi(arg_parser->optionValue(OPTION_TIMEOUT).c_str());
+
+        if (arg_parser->foundOption(OPTION_TARGETS))
+            strncpy(targets_file, (char *) arg_parser->optionValue(OPTION_TARGETS).c_str(), MAX_STRING_SIZE);
+
+        if (arg_parser->foundOption(OPTION_START_TTL))
+            start_ttl = atoi(arg_parser->optionValue(OPTION_START_TTL).c_str());
+
+        if (arg_parser->foundOption(OPTION_STATELESS))
+            strncpy(stateless_range, (char *) arg_parser->optionValue(OPTION_STATELESS).c_str(), MAX_STRING_SIZE - 1);
+
+        if (arg_parser->foundOption(OPTION_RATE))
+            rate = strtoull(arg_parser->optionValue(OPTION_RATE).c_str(), NULL, 10);
+        else if (continuous)
+            rate = DEFAULT_CONTINUOUS_RATE;
+
+        if (arg_parser->foundOption(OPTION_OUTPUT))
+            strncpy(output_file, (char *) arg_parser->optionValue(OPTION_OUTPUT).c_str(), MAX_STRING_SIZE - 1);
     }
 
     delete arg_parser;
 
+    if ((hostname[0] != '\0') + (targets_file[0] != '\0') + (stateless_range[0] != '\0') != 1) {
+
+        std::cerr << "traceroute::main() : [ERROR] one of --hostname, --targets "\
+            "or --stateless must be given." << std::endl;
+
+        return -1;
+    }
+
+    if (mda && hostname[0] == '\0') {
+
+        std::cerr << "traceroute::main() : [ERROR] --mda needs --hostname." << std::endl;
+
+        return -1;
+    }
+
+    if (continuous && hostname[0] == '\0') {
+
+        std::cerr << "traceroute::main() : [ERROR] --continuous needs --hostname." << std::endl;
+
+        return -1;
+    }
+
+    if (continuous && rate == 0) {
+
+        std::cerr << "traceroute::main() : [ERROR] invalid rate (0 pps per hop)." << std::endl;
+
+        return -1;
+    }
+
+    if (confidence <= 0.0 || confidence >= 100.0) {
+
+        std::cerr << "traceroute::main() : [ERROR] invalid confidence (" 
+            << confidence << "%)." << std::endl;
+
+        return -1;
+    }
+
+    // mda probes are paris probes, of many flows
+    if (mda)
+        paris = true;
+
+    if (start_ttl < 1 || start_ttl > MAX_TTL) {
+
+        std::cerr << "traceroute::main() : [ERROR] invalid start ttl (" 
+            << start_ttl << ")." << std::endl;
+
+        return -1;
+    }
+
     int rc = 0, rcv_sckt_fd = 0, snd_sckt_fd = 0;
     // since we can either send udp or icmp packets as probes, we keep 
     // placeholders for the socket type and protocol. by default we send 
     // udp packets.
     int snd_sckt_type = SOCK_DGRAM, snd_sckt_proto = 0;
-    // buffer to hold payload of udp packets (snd messages)
-    char snd_buff[MAX_BUFFER_SIZE];
-    int snd_buff_len = 0;
-    // in case icmp echos are used as probes, we need to build an icmp packet
-    struct icmp * icmp_pckt = NULL;
+    // in case icmp echos are used as probes, we need to build an icmp packet. 
+    // it's built once, in a probe pool (see icmp-utils.h).
+    ICMPProbePool * probes = NULL;
     // also, we bind the sending socket to a particular src port, so that 
     // we can 'authenticate' icmp replies by looking into the udp header of 
     // the icmp reply payload
     uint16_t snd_src_port = 0;
     struct sockaddr last_rcv_addr;
-    // record sent in the payload of probes and read from replies
-    struct trace_record * sent_rcrd;
     // addrinfo structs for hostname-to-ipv4 translation via getaddrinfo()
-    struct addrinfo hints, * answer;
+    struct addrinfo hints, * answer = NULL;
 
     // if we're using icmp echos as probes, change the default values of 
     // the socket type and protocol
@@ -350,6 +2147,14 @@ int main (int argc, char ** argv) {
         snd_sckt_proto = IPPROTO_ICMP;
     }
 
+    // stateless probes are built ip header and all (IPPROTO_RAW implies 
+    // IP_HDRINCL)
+    if (stateless_range[0] != '\0') {
+
+        snd_sckt_type = SOCK_RAW;
+        snd_sckt_proto = IPPROTO_RAW;
+    }
+
     // create the probe socket
     if ((snd_sckt_fd = socket(AF_INET, snd_sckt_type, snd_sckt_proto)) < 0) {
 
@@ -390,66 +2195,128 @@ int main (int argc, char ** argv) {
     // necessary.
     setuid(getuid());
 
-    // given the target hostname (e.g. google.com), extract its ip address 
-    // via getaddrinfo().
-    memset(&hints, 0, sizeof hints);
-    hints.ai_family = AF_INET;          // we're interested in ipv4 
-    hints.ai_socktype = SOCK_STREAM;    // tcp (?)
-    if ((rc = getaddrinfo(hostname, SERVICE_HTTP, &hints, &answer)) != 0) {
-        // gai_error() translates a getaddrinfo() error code into 'english'
-        std::cerr << "traceroute::main() : [ERROR] error while getting address "\
-            "of " << hostname << " (" << gai_strerror(rc) << ")" << std::endl;
-    }
-    // understand what's going on here? we want to translate a raw bit 
-    // representation of an ipv4 addr to its 'dotted-decimal' representation. 
-    // to do so, we use inet_ntoa(), which takes a sockaddr_in * as arg. 
-    // we get sockaddr_in * from the struct addrinfo * provided by 
-    // getaddrinfo(). struct addrinfo has one sockaddr * attribute, which can 
-    // be typecast to sockaddr_in * in this case, since we're dealing with 
-    // AF_INET family addresses.
-    std::cout << "traceroute::main() : [INFO] " << hostname << " translated to IPv4 addr "\
-         << inet_ntoa(((struct sockaddr_in *) answer->ai_addr)->sin_addr) << std::endl;
+    // in multi-destination mode, the destinations come from targets_file
+    std::vector<struct batch_trace> traces;
+    // in stateless mode, hops are written to output_file, if given. so is 
+    // the graph, in mda mode.
+    std::ofstream output;
+
+    if (output_file[0] != '\0' && (stateless_range[0] != '\0' || mda)) {
+
+        output.open(output_file);
+
+        if (!output.is_open()) {
+
+            std::cerr << "traceroute::main() : [ERROR] could not open "\
+                "output file " << output_file << std::endl;
+
+            return -1;
+        }
+    }
+
+    if (targets_file[0] != '\0') {
+
+        if (load_batch_targets(targets_file, traces) < 0)
+            return -1;
+
+        std::cout << "traceroute::main() : [INFO] " << traces.size() 
+            << " targets read from " << targets_file << std::endl;
+
+    } else if (hostname[0] != '\0') {
+
+        // given the target hostname (e.g. google.com), extract its ip address 
+        // via getaddrinfo().
+        memset(&hints, 0, sizeof hints);
+        hints.ai_family = AF_INET;          // we're interested in ipv4 
+        hints.ai_socktype = SOCK_STREAM;    // tcp (?)
+        if ((rc = getaddrinfo(hostname, SERVICE_HTTP, &hints, &answer)) != 0) {
+            // gai_error() translates a getaddrinfo() error code into 'english'
+            std::cerr << "traceroute::main() : [ERROR] error while getting address "\
+                "of " << hostname << " (" << gai_strerror(rc) << ")" << std::endl;
+        }
+        // understand what's going on here? we want to translate a raw bit 
+        // representation of an ipv4 addr to its 'dotted-decimal' representation. 
+        // to do so, we use inet_ntoa(), which takes a sockaddr_in * as arg. 
+        // we get sockaddr_in * from the struct addrinfo * provided by 
+        // getaddrinfo(). struct addrinfo has one sockaddr * attribute, which can 
+        // be typecast to sockaddr_in * in this case, since we're dealing with 
+        // AF_INET family addresses.
+        std::cout << "traceroute::main() : [INFO] " << hostname << " translated to IPv4 addr "\
+             << inet_ntoa(((struct sockaddr_in *) answer->ai_addr)->sin_addr) << std::endl;
+    }
 
     // unlike the ping example, we nest the 'recv code' within the 'sending 
     // loop' code. this is because the parameters of the sent packets must be 
     // changed according to the recv outcome.
     int snd_seq = 0, icmp_rc = 0;         
     bool done = false;
-    // a C++11 lambda expression to convert struct timeval to msecs
-    auto to_msec = [] (struct timeval tv) { return (tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0); };
+    struct timeval snd_timestamp;
+    // every probe sent is kept until it's answered, so that late replies 
+    // (after their probe timed out) can still be told apart
+    ProbeTable inflight(MAX_TTL * NUM_RETRIES);
 
-    // set the SIGALRM signal handler
-    SignalHandler signal_handler;
+    if (timeout_ms <= 0) {
 
-    try {
+        std::cerr << "traceroute::main() : [ERROR] invalid timeout (" 
+            << timeout_ms << " msec)." << std::endl;
 
-        signal_handler.set_signal_handler(SIGALRM);
+        return -1;
+    }
 
-    } catch (SignalException& e) {
+    // a single probe, w/ the calling process pid as the identifier of the 
+    // icmp message. the icmp header (8 byte) is followed by PROBE_DATA_LEN 
+    // byte of optional payload, more than enough to accommodate a struct 
+    // trace_record.
+    if (use_icmp_probe)
+        probes = new ICMPProbePool(1, 8 + PROBE_DATA_LEN, ICMP_ECHO, 0, (uint16_t) (getpid() & 0xFFFF));
 
-        std::cerr << "traceroute::main() : [ERROR] SignalException: " 
-            << e.what() << ". SIGALRM handling won't work. aborting." << std::endl;
+    // in paris mode, udp probes set their own checksum, which covers our 
+    // address (see send_probe())
+    struct in_addr paris_src_addr;
+    paris_src_addr.s_addr = INADDR_ANY;
 
+    if (paris && !use_icmp_probe && answer != NULL 
+        && get_src_addr((struct sockaddr_in *) answer->ai_addr, paris_src_addr) < 0)
         return -1;
+
+    if (stateless_range[0] != '\0') {
+
+        rc = trace_stateless(
+            snd_sckt_fd, rcv_sckt_fd, stateless_range, rate, timeout_ms, 
+            (output.is_open() ? (std::ostream &) output : std::cout));
+        done = true;
+
+    } else if (targets_file[0] != '\0') {
+
+        rc = trace_batch(
+            snd_sckt_fd, rcv_sckt_fd, snd_src_port, use_icmp_probe, paris, probes, 
+            traces, start_ttl, timeout_ms);
+        done = true;
+
+    } else if (continuous) {
+
+        rc = trace_continuous(
+            snd_sckt_fd, rcv_sckt_fd, snd_src_port, use_icmp_probe, paris, paris_src_addr, 
+            probes, answer, rate, count, timeout_ms);
+        done = true;
+
+    } else if (mda) {
+
+        rc = trace_mda(
+            snd_sckt_fd, rcv_sckt_fd, snd_src_port, use_icmp_probe, paris_src_addr, 
+            probes, answer, confidence, timeout_ms, (output.is_open() ? &output : NULL));
+        done = true;
+
+    } else if (parallel) {
+
+        rc = trace_parallel(
+            snd_sckt_fd, rcv_sckt_fd, snd_src_port, use_icmp_probe, paris, paris_src_addr, 
+            probes, answer, timeout_ms);
+        done = true;
     }
 
     for (int ttl = 1; ttl <= MAX_TTL && !(done); ttl++) {
 
-        // we can use setsockopt() to set the ttl value in the outgoing udp 
-        // datagrams. the option to set is IP_TTL. the setsockopt() interface 
-        // goes as follows:
-        //  -# fd of socket to set option
-        //  -# the protocol level at which the option resides. in our case, the 
-        //     ttl field is in the ipv4 header, so IPPROTO_IP
-        //  -# option name, IP_TTL
-        //  -# the option value (void *). here we leave a int * (&ttl)
-        //  -# size of the option : sizeof(int)
-        if (setsockopt(snd_sckt_fd, IPPROTO_IP, IP_TTL, &ttl, sizeof(int)) < 0) {
-            std::cerr << "traceroute::main() : [ERROR] error setting ttl: "
-                << strerror(errno) << std::endl;
-            return -1;            
-        }
-
         // clear the last_rcv_addr for a new ttl
         bzero(&last_rcv_addr, sizeof(struct sockaddr_in));
 
@@ -458,71 +2325,13 @@ int main (int argc, char ** argv) {
 
         for (int retries = NUM_RETRIES; retries > 0; retries--) {
 
-            // depending on the type of packet to send, we set the contents of 
-            // snd_buff differently
-            if (use_icmp_probe) {
-
-                // this step seems important to achieve a correct checksum
-                memset(snd_buff, 0x00, 8 + ICMP_DATA_LEN);
-
-                // if an icmp echo, we first build add an icmp header (8 byte) 
-                // and then the 56 byte optional playload, more than enough 
-                // to accommodate a struct trace_record (6 byte)
-                icmp_pckt = ICMPUtils::prepare_icmp_pckt(snd_buff, ICMP_ECHO, 0);
-                // we set the identifier field of the icmp message as the 
-                // calling process pid
-                icmp_pckt->icmp_id = htons(getpid() & 0xFFFF);
-                // the icmp message is started w/ a seq number of 0, it will be 
-                // increased as needed in subsequent uses of the icmp struct
-                icmp_pckt->icmp_seq = htons((uint16_t) ++snd_seq);
-                // 8 bytes for icmp header + ICMP_DATA_LEN
-                snd_buff_len = 8 + ICMP_DATA_LEN;
-
-                // the trace_record struct should start after the icmp header, 
-                // i.e. at snd_buff + 8 byte
-                sent_rcrd = (struct trace_record *) (snd_buff + 8);
-
-                // to match icmp reply to sent packets (either icmp or udp), we 
-                // set the following info on the payload:
-                //  -# sequence number
-                //  -# ttl packet left with
-                //  -# time at which packet left (struct timeval)
-                // this is kept in a struct (struct trace_record), defined above
-                sent_rcrd->seq = snd_seq;
-                sent_rcrd->ttl = ttl;
-                gettimeofday(&(sent_rcrd->timestamp), NULL);
-
-                // icmp packets carry a 2 byte checksum, which is calculated 
-                // over its entire length
-                icmp_pckt->icmp_cksum = ICMPUtils::in_cksum((u_short *) icmp_pckt, snd_buff_len);
-
-                //print_icmp_hdr(icmp_pckt);
-
-            } else {
-
-                // if an udp packet, sent_rcrd is set at the starting address 
-                // of the snd_buff char *
-                sent_rcrd = (struct trace_record *) snd_buff;
-                sent_rcrd->seq = ++snd_seq;
-                sent_rcrd->ttl = ttl;
-                gettimeofday(&(sent_rcrd->timestamp), NULL);
-
-                snd_buff_len = sizeof(struct trace_record);
-
-                // set the port of the outgoing udp packet to a diff. value than 
-                // before. we alter the struct sockaddr snd_addr to accomplish 
-                // that, first by typecasting the general struct to a AF_INET 
-                // sockaddr_in. the sin_port attribute must respect network byte 
-                // ordering.
-                ((struct sockaddr_in *) answer->ai_addr)->sin_port = htons(DST_PORT + snd_seq);
-            }
-
-            // send the upd packet
-            if (sendto(snd_sckt_fd, snd_buff, snd_buff_len, 0, answer->ai_addr, answer->ai_addrlen) < 0) {
+            snd_seq++;
 
-                std::cerr << "traceroute::main() : [ERROR] error sending packet: "
-                    << strerror(errno) << std::endl;                
-            }
+            if (send_probe(
+                    snd_sckt_fd, ttl, snd_seq, use_icmp_probe, paris, 0, paris_src_addr, 
+                    snd_src_port, probes, answer, 
+                    &inflight, snd_seq, snd_timestamp) < 0)
+                return -1;
 
             // now we call get_icmp_response() and handle it differently 
             // according to the return code. if icmp echos are sent as probes, 
@@ -531,11 +2340,10 @@ int main (int argc, char ** argv) {
             struct icmp_response icmp_rsp;
             if ((icmp_rc = get_icmp_response(
                     rcv_sckt_fd,
-                    ttl,
-                    snd_seq,
-                    snd_src_port,
-                    use_icmp_probe, 
-                    signal_handler,
+                    &inflight,
+                    paris,
+                    get_probe_key(use_icmp_probe, paris, 0, snd_src_port, snd_seq),
+                    timeout_ms,
                     icmp_rsp)) == TIMEOUT_REPLY) {
 
                 std::cout << " ?";
@@ -543,45 +2351,10 @@ int main (int argc, char ** argv) {
             } else {
 
                 // ok, we got something... 
+                print_hop_reply(icmp_rsp, last_rcv_addr, snd_timestamp, icmp_rc);
 
-                // if for some reason the ip address of the icmp reply changes 
-                // when compared to the previous, we print a <hostname> (if 
-                // possible) (<ipv4 address>) message. we use memcmp() for that, 
-                // which compares the first n bytes of 2 const void *.
-                if (memcmp(
-                    &last_rcv_addr,
-                    &icmp_rsp.reply_addr, 
-                    sizeof(struct sockaddr_in)) != 0) {
-
-                    char reply_hostname[MAX_STRING_SIZE] = "";
-
-                    // getnameinfo() has a 0 success return code
-                    if (getnameinfo(
-                            &icmp_rsp.reply_addr, icmp_rsp.reply_addrlen, 
-                            reply_hostname, sizeof(reply_hostname),
-                            NULL, 0, 0) == 0) {
-
-                        std::cout << " " << inet_ntoa(((struct sockaddr_in *) &icmp_rsp.reply_addr)->sin_addr) 
-                            << " (" << reply_hostname << ")";
-                    } else {
-                        std::cout << " " << inet_ntoa(((struct sockaddr_in *) &icmp_rsp.reply_addr)->sin_addr);                        
-                    }
-
-                    // keep track of the rcv_addr which was received last
-                    memcpy(&last_rcv_addr, &icmp_rsp.reply_addr, sizeof(struct sockaddr_in));
-                }
-
-                // print the src ip seen by the replier
-                std::cout << " (" << inet_ntoa(icmp_rsp.req_src_addr) << ")";
-
-                // print the rtt of the snd udp > rcv icmp cycle
-                std::cout << " " << to_msec(*(tv_sub(&icmp_rsp.rcv_timestamp, &(sent_rcrd->timestamp)))) << " msec";
-
-                if (icmp_rc == HOSTNAME_HIT_REPLY) {
+                if (icmp_rc == HOSTNAME_HIT_REPLY)
                     done = true;
-                } else if (icmp_rc >= 0) {
-                    std::cout << " unknown icmp code (" << icmp_rc << ")";
-                }
             }
         }
 
@@ -590,7 +2363,14 @@ int main (int argc, char ** argv) {
 
     // all the storage returned by getaddrinfo() are allocated dynamically 
     // (i.e. w/ malloc()). so one must free it w/ freeaddrinfo()
-    freeaddrinfo(answer);
+    if (answer != NULL)
+        freeaddrinfo(answer);
 
-    return 0;
+    if (probes != NULL) {
+
+        ICMPProbePool::print_alloc_stats();
+        delete probes;
+    }
+
+    return rc;
 }
\ No newline at end of file